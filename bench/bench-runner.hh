@@ -0,0 +1,192 @@
+//
+// Minimal benchmark runner shared by benchmark programs.
+// Each benchmark is run once for warm-up and then `repeat` times. The median
+// time is reported, so results are stable against occasional outliers.
+// Results are written as JSON so that runs of different commits can be
+// compared with a script.
+//
+#ifndef NNVIEW_BENCH_BENCH_RUNNER_HH_
+#define NNVIEW_BENCH_BENCH_RUNNER_HH_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace nnview {
+namespace bench {
+
+struct BenchResult {
+  std::string name;  // e.g. "weights_parse/read/float32"
+
+  std::vector<double> times_ms;  // Time of each run
+  double median_ms = 0.0;
+  double min_ms = 0.0;
+  double max_ms = 0.0;
+
+  // Amount of work per run and its unit(e.g. "MB", "Melem"). Throughput is
+  // reported as work / median time in `<unit>/s`. Empty unit = none.
+  double work = 0.0;
+  std::string work_unit;
+
+  // Properties of the input and results(e.g. # of nodes, crossings).
+  std::vector<std::pair<std::string, double>> counters;
+};
+
+class BenchRunner {
+ public:
+  int repeat = 5;
+
+  // Run only benchmarks whose name contains `filter`. Empty = all.
+  std::string filter;
+
+  bool enabled(const std::string &name) const {
+    return filter.empty() || (name.find(filter) != std::string::npos);
+  }
+
+  //
+  // Measure `func`. Returns nullptr(and `func` is not called) when the
+  // benchmark is filtered out. Counters can be added to the returned result
+  // until the next call of `run`.
+  //
+  template <typename Func>
+  BenchResult *run(const std::string &name, double work,
+                   const std::string &work_unit, Func func) {
+    if (!enabled(name)) {
+      return nullptr;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.work = work;
+    result.work_unit = work_unit;
+
+    func();  // warm-up
+
+    for (int i = 0; i < std::max(1, repeat); i++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      func();
+      auto end = std::chrono::high_resolution_clock::now();
+      result.times_ms.push_back(
+          std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::vector<double> sorted = result.times_ms;
+    std::sort(sorted.begin(), sorted.end());
+    result.min_ms = sorted.front();
+    result.max_ms = sorted.back();
+    const size_t mid = sorted.size() / 2;
+    result.median_ms = (sorted.size() % 2)
+                           ? sorted[mid]
+                           : 0.5 * (sorted[mid - 1] + sorted[mid]);
+
+    fprintf(stderr, "%-48s %12.3f ms", name.c_str(), result.median_ms);
+    if (!work_unit.empty()) {
+      fprintf(stderr, " %12.1f %s/s", throughput(result),
+              work_unit.c_str());
+    }
+    fprintf(stderr, "\n");
+
+    results.push_back(result);
+    return &results.back();
+  }
+
+  static double throughput(const BenchResult &result) {
+    return (result.median_ms > 0.0) ? result.work / (result.median_ms * 1.0e-3)
+                                    : 0.0;
+  }
+
+  // Write all results as JSON.
+  void write_json(FILE *fp) const {
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"context\": {\n");
+    fprintf(fp, "    \"compiler\": \"%s\",\n", escape(compiler()).c_str());
+    fprintf(fp, "    \"simd\": \"%s\",\n", simd());
+#ifdef NDEBUG
+    fprintf(fp, "    \"assertions\": false,\n");
+#else
+    fprintf(fp, "    \"assertions\": true,\n");
+#endif
+    fprintf(fp, "    \"hardware_threads\": %u,\n",
+            std::thread::hardware_concurrency());
+    fprintf(fp, "    \"repeat\": %d\n", std::max(1, repeat));
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult &r = results[i];
+      fprintf(fp, "%s\n    {\n", (i == 0) ? "" : ",");
+      fprintf(fp, "      \"name\": \"%s\",\n", escape(r.name).c_str());
+      fprintf(fp, "      \"median_ms\": %.6f,\n", r.median_ms);
+      fprintf(fp, "      \"min_ms\": %.6f,\n", r.min_ms);
+      fprintf(fp, "      \"max_ms\": %.6f,\n", r.max_ms);
+      if (!r.work_unit.empty()) {
+        fprintf(fp, "      \"throughput\": %.6f,\n", throughput(r));
+        fprintf(fp, "      \"throughput_unit\": \"%s/s\",\n",
+                escape(r.work_unit).c_str());
+      }
+      fprintf(fp, "      \"counters\": {");
+      for (size_t k = 0; k < r.counters.size(); k++) {
+        fprintf(fp, "%s\"%s\": %.17g", (k == 0) ? "" : ", ",
+                escape(r.counters[k].first).c_str(), r.counters[k].second);
+      }
+      fprintf(fp, "},\n");
+      fprintf(fp, "      \"times_ms\": [");
+      for (size_t k = 0; k < r.times_ms.size(); k++) {
+        fprintf(fp, "%s%.6f", (k == 0) ? "" : ", ", r.times_ms[k]);
+      }
+      fprintf(fp, "]\n    }");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+  }
+
+  std::vector<BenchResult> results;
+
+ private:
+  static std::string escape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+      if ((c == '"') || (c == '\\')) {
+        out += '\\';
+        out += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        out += ' ';
+      } else {
+        out += c;
+      }
+    }
+    return out;
+  }
+
+  static std::string compiler() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+  }
+
+  static const char *simd() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "none";
+#endif
+  }
+};
+
+}  // namespace bench
+}  // namespace nnview
+
+#endif  // NNVIEW_BENCH_BENCH_RUNNER_HH_
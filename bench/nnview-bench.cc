@@ -0,0 +1,663 @@
+//
+// Benchmarks for nnview core routines(nnview_core).
+//
+// Usage: nnview_bench [--output FILE] [--filter NAME] [--repeat N]
+//                     [--work-dir DIR]
+//
+// --output   : Write results as JSON to FILE. default: stdout
+// --filter   : Run only benchmarks whose name contains NAME.
+// --repeat   : # of measured runs of each benchmark. default: 5
+// --work-dir : Directory for temporary weights and graph files, removed
+//              when finished. default: current directory
+//
+// Inputs are synthetic and generated with fixed seeds, so results can be
+// compared between commits. Progress is printed to stderr.
+//
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench-runner.hh"
+#include "colormap-lut.hh"
+#include "datatypes.h"
+#include "graph-csr.hh"
+#include "io/graph-loader.hh"
+#include "io/weights-loader.hh"
+#include "layout/force-layout.hh"
+#include "layout/layered-layout.hh"
+#include "log.hh"
+#include "synthetic-graph.hh"
+#include "synthetic-tensor.hh"
+#include "tensor-pyramid.hh"
+#include "tensor-stats.hh"
+
+namespace {
+
+using nnview::bench::BenchResult;
+using nnview::bench::BenchRunner;
+using nnview::bench::fail;
+using nnview::bench::join_path;
+using nnview::bench::make_random_values;
+using nnview::bench::make_tensor;
+
+// Keeps results of benchmarked code alive.
+volatile size_t g_sink = 0;
+
+size_t count_slots(const nnview::Graph &graph) {
+  size_t n = 0;
+  for (const auto &node : graph.nodes) {
+    n += node.inputs.size() + node.outputs.size();
+  }
+  return n;
+}
+
+// Write `tensor` as chainer-trt .weights file. Returns the file size.
+size_t write_weights_file(const std::string &filename,
+                          const nnview::Tensor &tensor) {
+  std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    fail("Failed to create " + filename);
+  }
+
+  nnview::bench::write_weights_header(ofs, tensor.dtype, tensor.shape);
+  ofs.write(reinterpret_cast<const char *>(tensor.data),
+            std::streamsize(tensor.data_size()));
+  if (!ofs) {
+    fail("Failed to write " + filename);
+  }
+
+  return size_t(ofs.tellp());
+}
+
+// Files created by benchmarks. Removed at exit.
+std::vector<std::string> g_temp_files;
+
+void remove_temp_files() {
+  for (const std::string &filename : g_temp_files) {
+    std::remove(filename.c_str());
+  }
+  g_temp_files.clear();
+}
+
+//
+// Write chainer-trt model.json of a chain of alternating LinearFunction and
+// ReLU layers with 1x1 weights. Returns the path of the JSON file.
+//
+std::string write_chain_model(const std::string &dir, size_t num_layers,
+                              size_t *json_size) {
+  const std::string prefix = "nnview-bench-" + std::to_string(num_layers);
+  const std::vector<float> values = make_random_values(1, 1);
+  const nnview::Tensor tensor =
+      make_tensor(nnview::DATA_TYPE_FLOAT32, 1, 1, values);
+
+  auto add_file = [&](const std::string &filename) {
+    const std::string path = join_path(dir, filename);
+    write_weights_file(path, tensor);
+    g_temp_files.push_back(path);
+    return filename;
+  };
+
+  std::string json;
+  json += "{\n  \"inputs\": [\"input\"],\n";
+  json += "  \"outputs\": [[\"" + prefix + "-" +
+          std::to_string(num_layers - 1) + "_0\", \"prob\"]],\n";
+  json += "  \"layers\": [\n";
+  json += "    {\"type\": \"input\", \"name\": \"input\", "
+          "\"output_names\": [\"input\"], \"rank\": -2, \"shape\": [1], "
+          "\"input_tensor\": \"" +
+          add_file(prefix + "-input.tensor") + "\"}";
+
+  std::string source = "input";
+  for (size_t i = 0; i < num_layers; i++) {
+    const std::string name = prefix + "-" + std::to_string(i);
+    const bool linear = (i % 2) == 0;
+
+    json += ",\n    {\"type\": \"";
+    json += linear ? "LinearFunction" : "ReLU";
+    json += "\", \"name\": \"" + name + "\", \"rank\": " + std::to_string(i);
+    json += ", \"output_names\": [\"" + name + "_0\"], \"source\": \"" +
+            source + "\"";
+    if (linear) {
+      json += ", \"n_out\": 1, \"kernel_weights_file\": \"" +
+              add_file(name + "_kernel.weights") +
+              "\", \"bias_weights_file\": \"" +
+              add_file(name + "_bias.weights") + "\"";
+    }
+    json += ", \"input_shapes\": [[1, 1]], \"input_types\": [\"float32\"]";
+    json += ", \"output_shape\": [1, 1], \"output_type\": \"float32\"";
+    json += ", \"output_tensor\": \"" + add_file(name + "_0_output.tensor") +
+            "\"}";
+
+    source = name + "_0";
+  }
+  json += "\n  ]\n}\n";
+
+  const std::string path = join_path(dir, prefix + ".json");
+  std::ofstream ofs(path, std::ios::out | std::ios::binary);
+  ofs << json;
+  if (!ofs) {
+    fail("Failed to write " + path);
+  }
+  g_temp_files.push_back(path);
+
+  (*json_size) = json.size();
+  return path;
+}
+
+// Reference: linear search used before the name index was introduced.
+bool resolve_tensor_slots_linear(nnview::Graph *graph) {
+  auto find_tensor = [graph](const std::string &name) {
+    for (size_t i = 0; i < graph->tensors.size(); i++) {
+      if (name.compare(graph->tensors[i].name) == 0) {
+        return int(i);
+      }
+    }
+    return -1;
+  };
+
+  for (auto &node : graph->nodes) {
+    for (auto &slot : node.inputs) {
+      slot.id = find_tensor(slot.name);
+      if (slot.id == -1) return false;
+    }
+    for (auto &slot : node.outputs) {
+      slot.id = find_tensor(slot.name);
+      if (slot.id == -1) return false;
+    }
+  }
+
+  return true;
+}
+
+nnview::Graph make_resolved_chain_graph(size_t num_layers) {
+  nnview::Graph graph = nnview::bench::make_chain_graph(num_layers);
+  if (!nnview::resolve_tensor_slots(&graph)) {
+    fail("resolve_tensor_slots failed");
+  }
+  return graph;
+}
+
+// Layout graph as drawn on the graph view: a box per node and per tensor.
+void make_layout_graph(const nnview::Graph &graph,
+                       nnview::LayoutGraph *layout) {
+  layout->clear();
+  for (size_t i = 0; i < graph.tensors.size(); i++) {
+    layout->add_node(128.0f, 128.0f);
+  }
+  for (const auto &node : graph.nodes) {
+    const int n = layout->add_node(128.0f, 128.0f);
+    for (const auto &slot : node.inputs) {
+      layout->add_edge(slot.id, n);
+    }
+    for (const auto &slot : node.outputs) {
+      layout->add_edge(n, slot.id);
+    }
+  }
+}
+
+//
+// Seeded random DAG of `num_nodes` boxes with a few back edges(cycles).
+// Each node consumes 1-3 of the 32 preceding nodes, so most edges span a few
+// layers and cross each other, unlike the chain graph which has no crossing.
+// Returns the # of back edges.
+//
+size_t make_random_layout_graph(size_t num_nodes, uint32_t seed,
+                                nnview::LayoutGraph *layout) {
+  uint32_t state = seed ? seed : 1u;
+  auto next = [&state](uint32_t n) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % n;
+  };
+
+  layout->clear();
+  size_t num_back_edges = 0;
+  for (size_t i = 0; i < num_nodes; i++) {
+    const int n = layout->add_node(128.0f, 128.0f);
+    if (i == 0) {
+      continue;
+    }
+
+    const uint32_t window = uint32_t(std::min(i, size_t(32)));
+    const uint32_t num_inputs = 1 + next(3);
+    for (uint32_t k = 0; k < num_inputs; k++) {
+      layout->add_edge(n - 1 - int(next(window)), n);
+    }
+
+    // 1 in 64 nodes feeds back to a preceding node.
+    if (next(64) == 0) {
+      layout->add_edge(n, n - 1 - int(next(window)));
+      num_back_edges++;
+    }
+  }
+
+  return num_back_edges;
+}
+
+// 1 and all hardware threads.
+std::vector<int> thread_counts() {
+  const int num_threads = int(std::thread::hardware_concurrency());
+  if (num_threads <= 1) {
+    return {1};
+  }
+  return {1, num_threads};
+}
+
+// Size of tensors for parsing, stats and colormapping benchmarks.
+constexpr int kTensorRows = 2048;
+constexpr int kTensorCols = 4096;
+
+const nnview::DataType kDataTypes[] = {
+    nnview::DATA_TYPE_FLOAT32, nnview::DATA_TYPE_FLOAT16,
+    nnview::DATA_TYPE_INT8};
+
+void bench_weights_parse(BenchRunner *runner, const std::string &work_dir) {
+  const std::vector<float> values =
+      make_random_values(size_t(kTensorRows) * size_t(kTensorCols), 1);
+
+  for (nnview::DataType dtype : kDataTypes) {
+    const std::string dtype_name = nnview::get_data_type_name(dtype);
+    const std::string read_name = "weights_parse/read/" + dtype_name;
+    const std::string mmap_name = "weights_parse/mmap/" + dtype_name;
+    if (!runner->enabled(read_name) && !runner->enabled(mmap_name)) {
+      continue;
+    }
+
+    const std::string path =
+        join_path(work_dir, "nnview-bench-" + dtype_name + ".weights");
+    const size_t file_size = write_weights_file(
+        path, make_tensor(dtype, kTensorRows, kTensorCols, values));
+    g_temp_files.push_back(path);
+    const double mb = double(file_size) * 1.0e-6;
+
+    runner->run(read_name, mb, "MB", [&]() {
+      nnview::Tensor tensor;
+      if (!nnview::load_weights(path, &tensor)) {
+        fail("load_weights failed: " + path);
+      }
+      g_sink = g_sink + tensor.data[tensor.data_size() - 1];
+    });
+
+    // Touch every page, so that the cost of page faults is included.
+    runner->run(mmap_name, mb, "MB", [&]() {
+      nnview::Tensor tensor;
+      if (!nnview::load_weights_mmap(path, &tensor)) {
+        fail("load_weights_mmap failed: " + path);
+      }
+      size_t sum = 0;
+      for (size_t i = 0; i < tensor.data_size(); i += 4096) {
+        sum += tensor.data[i];
+      }
+      g_sink = g_sink + sum;
+    });
+
+    remove_temp_files();
+  }
+}
+
+void bench_json_graph_parse(BenchRunner *runner,
+                            const std::string &work_dir) {
+  const size_t sizes[] = {1000, 10000};
+  for (size_t num_layers : sizes) {
+    const std::string suffix = "/layers:" + std::to_string(num_layers);
+
+    //
+    // parse : JSON -> Graph without opening weights/tensor files.
+    // headers : Also read headers of weights files(lazy loading), which
+    //           opens a file per tensor.
+    //
+    struct Variant {
+      std::string name;
+      bool streaming_json;
+      bool structure_only;
+    };
+    const Variant variants[] = {
+        {"json_graph_parse/streaming/parse" + suffix, true, true},
+        {"json_graph_parse/dom/parse" + suffix, false, true},
+        {"json_graph_parse/streaming/headers" + suffix, true, false},
+        {"json_graph_parse/dom/headers" + suffix, false, false},
+    };
+
+    bool enabled = false;
+    for (const Variant &variant : variants) {
+      enabled = enabled || runner->enabled(variant.name);
+    }
+    if (!enabled) {
+      continue;
+    }
+
+    size_t json_size = 0;
+    const std::string path =
+        write_chain_model(work_dir, num_layers, &json_size);
+
+    for (const Variant &variant : variants) {
+      nnview::GraphLoaderOption option;
+      option.lazy = true;
+      option.streaming_json = variant.streaming_json;
+      option.structure_only = variant.structure_only;
+
+      size_t num_nodes = 0;
+      size_t num_tensors = 0;
+      BenchResult *result = runner->run(
+          variant.name, double(json_size) * 1.0e-6, "MB", [&]() {
+            nnview::Graph graph;
+            if (!nnview::load_json_graph(path, &graph, option)) {
+              fail("load_json_graph failed: " + path);
+            }
+            num_nodes = graph.nodes.size();
+            num_tensors = graph.tensors.size();
+          });
+      if (result) {
+        result->counters.emplace_back("nodes", double(num_nodes));
+        result->counters.emplace_back("tensors", double(num_tensors));
+        result->counters.emplace_back(
+            "files", variant.structure_only ? 0.0 : double(num_tensors));
+      }
+    }
+
+    remove_temp_files();
+  }
+}
+
+void bench_tensor_name_resolution(BenchRunner *runner) {
+  const size_t sizes[] = {1000, 10000, 100000};
+  for (size_t num_layers : sizes) {
+    const std::string suffix = "/layers:" + std::to_string(num_layers);
+    nnview::Graph graph = nnview::bench::make_chain_graph(num_layers);
+    const size_t num_slots = count_slots(graph);
+
+    BenchResult *result = runner->run(
+        "tensor_name_resolution/index" + suffix, double(num_slots) * 1.0e-6,
+        "Mslot", [&]() {
+          if (!nnview::resolve_tensor_slots(&graph)) {
+            fail("resolve_tensor_slots failed");
+          }
+        });
+    if (result) {
+      result->counters.emplace_back("tensors", double(graph.tensors.size()));
+    }
+
+    // Linear search is O(slots x tensors). Skip the largest graph.
+    if (num_layers <= 10000) {
+      result = runner->run(
+          "tensor_name_resolution/linear" + suffix,
+          double(num_slots) * 1.0e-6, "Mslot", [&]() {
+            if (!resolve_tensor_slots_linear(&graph)) {
+              fail("resolve_tensor_slots_linear failed");
+            }
+          });
+      if (result) {
+        result->counters.emplace_back("tensors",
+                                      double(graph.tensors.size()));
+      }
+    }
+  }
+}
+
+void bench_csr_graph(BenchRunner *runner) {
+  const size_t sizes[] = {10000, 100000};
+  for (size_t num_layers : sizes) {
+    const std::string suffix = "/layers:" + std::to_string(num_layers);
+    const nnview::Graph graph = make_resolved_chain_graph(num_layers);
+    const double mnodes = double(graph.nodes.size()) * 1.0e-6;
+
+    nnview::CsrGraph csr;
+    BenchResult *result =
+        runner->run("csr_graph/build" + suffix, mnodes, "Mnode",
+                    [&]() { csr.build(graph); });
+    if (result) {
+      result->counters.emplace_back("bytes", double(csr.num_bytes()));
+    }
+
+    csr.build(graph);
+
+    // Visit all successors and consumers once.
+    runner->run("csr_graph/traverse" + suffix, mnodes, "Mnode", [&]() {
+      size_t sum = 0;
+      for (size_t n = 0; n < csr.num_nodes(); n++) {
+        for (int32_t succ : csr.successors(n)) {
+          sum += size_t(succ);
+        }
+      }
+      for (size_t t = 0; t < csr.num_tensors(); t++) {
+        for (const nnview::CsrSlotRef &ref : csr.consumers(t)) {
+          sum += size_t(ref.slot);
+        }
+      }
+      g_sink = g_sink + sum;
+    });
+  }
+}
+
+void bench_stats(BenchRunner *runner) {
+  const std::vector<float> values =
+      make_random_values(size_t(kTensorRows) * size_t(kTensorCols), 2);
+  const double melems = double(values.size()) * 1.0e-6;
+
+  runner->run("stats/compute_stats/float32", melems, "Melem", [&]() {
+    const nnview::TensorStats stats =
+        nnview::compute_stats(values.data(), values.size());
+    g_sink = g_sink + stats.count;
+  });
+
+  for (nnview::DataType dtype : kDataTypes) {
+    const std::string prefix =
+        std::string("stats/tensor/") + nnview::get_data_type_name(dtype);
+    bool enabled = false;
+    for (int threads : thread_counts()) {
+      const std::string name = prefix + "/threads:" + std::to_string(threads);
+      enabled = enabled || runner->enabled(name);
+    }
+    if (!enabled) {
+      continue;
+    }
+
+    const nnview::Tensor tensor =
+        make_tensor(dtype, kTensorRows, kTensorCols, values);
+    for (int threads : thread_counts()) {
+      BenchResult *result = runner->run(
+          prefix + "/threads:" + std::to_string(threads), melems, "Melem",
+          [&]() {
+            const nnview::TensorStats stats =
+                nnview::compute_tensor_stats(tensor, threads);
+            g_sink = g_sink + stats.count;
+          });
+      if (result) {
+        result->counters.emplace_back("threads", double(threads));
+      }
+    }
+  }
+}
+
+void bench_colormap(BenchRunner *runner) {
+  const std::vector<float> values =
+      make_random_values(size_t(kTensorRows) * size_t(kTensorCols), 3);
+  const double melems = double(values.size()) * 1.0e-6;
+
+  std::vector<uint8_t> rgba(values.size() * 4);
+  for (int i = 0; i < nnview::kNumColormaps; i++) {
+    const nnview::Colormap cmap = nnview::Colormap(i);
+    runner->run(
+        std::string("colormap/apply/") + nnview::get_colormap_name(cmap),
+        melems, "Melem", [&]() {
+          nnview::apply_colormap(values.data(), values.size(), -1.0f, 1.0f,
+                                 cmap, rgba.data());
+          g_sink = g_sink + rgba[rgba.size() - 1];
+        });
+  }
+
+  // Downsampled levels displayed before colormapping.
+  const int num_threads = int(std::thread::hardware_concurrency());
+  for (nnview::DataType dtype : kDataTypes) {
+    const std::string name = std::string("colormap/pyramid/") +
+                             nnview::get_data_type_name(dtype);
+    if (!runner->enabled(name)) {
+      continue;
+    }
+
+    const nnview::Tensor tensor =
+        make_tensor(dtype, kTensorRows, kTensorCols, values);
+    BenchResult *result = runner->run(name, melems, "Melem", [&]() {
+      nnview::TensorPyramid pyramid;
+      pyramid.build(&tensor, nnview::DOWNSAMPLE_MEAN, num_threads);
+      g_sink = g_sink + size_t(pyramid.num_levels());
+    });
+    if (result) {
+      result->counters.emplace_back("threads", double(num_threads));
+    }
+  }
+}
+
+void bench_layout(BenchRunner *runner) {
+  const int num_threads = int(std::thread::hardware_concurrency());
+
+  // Random DAG with crossings and cycles. Exercises cycle breaking and the
+  // barycenter reordering, which the chain graph skips.
+  const size_t random_sizes[] = {10000, 100000};
+  for (size_t num_nodes : random_sizes) {
+    const std::string suffix = "/random/nodes:" + std::to_string(num_nodes);
+
+    nnview::LayoutGraph layout;
+    const size_t num_back_edges =
+        make_random_layout_graph(num_nodes, 1, &layout);
+    const double mnodes = double(layout.num_nodes()) * 1.0e-6;
+
+    for (int threads : thread_counts()) {
+      nnview::LayeredLayoutOption option;
+      option.num_threads = threads;
+
+      std::vector<float> xs, ys;
+      std::vector<int> layers;
+      BenchResult *result = runner->run(
+          "layout/layered" + suffix + "/threads:" + std::to_string(threads),
+          mnodes, "Mnode",
+          [&]() { nnview::layered_layout(layout, option, &xs, &ys, &layers); });
+      if (result) {
+        result->counters.emplace_back("nodes", double(layout.num_nodes()));
+        result->counters.emplace_back("edges", double(layout.edges.size()));
+        result->counters.emplace_back("back_edges", double(num_back_edges));
+        result->counters.emplace_back("threads", double(threads));
+        result->counters.emplace_back(
+            "crossings",
+            double(nnview::count_layout_crossings(layout, layers, ys)));
+      }
+    }
+  }
+
+  const size_t sizes[] = {1000, 10000, 25000};
+  for (size_t num_layers : sizes) {
+    const std::string suffix = "/layers:" + std::to_string(num_layers);
+    const nnview::Graph graph = make_resolved_chain_graph(num_layers);
+
+    nnview::LayoutGraph layout;
+    make_layout_graph(graph, &layout);
+    const double mnodes = double(layout.num_nodes()) * 1.0e-6;
+
+    for (int threads : thread_counts()) {
+      nnview::LayeredLayoutOption option;
+      option.num_threads = threads;
+
+      std::vector<float> xs, ys;
+      std::vector<int> layers;
+      BenchResult *result = runner->run(
+          "layout/layered" + suffix + "/threads:" + std::to_string(threads),
+          mnodes, "Mnode",
+          [&]() { nnview::layered_layout(layout, option, &xs, &ys, &layers); });
+      if (result) {
+        result->counters.emplace_back("nodes", double(layout.num_nodes()));
+        result->counters.emplace_back("edges", double(layout.edges.size()));
+        result->counters.emplace_back("threads", double(threads));
+        result->counters.emplace_back(
+            "crossings",
+            double(nnview::count_layout_crossings(layout, layers, ys)));
+      }
+    }
+
+    // Fixed # of iterations of force-directed layout from the layered one.
+    // Takes seconds per run for larger graphs.
+    const std::string force_name = "layout/force" + suffix;
+    if ((num_layers > 10000) || !runner->enabled(force_name)) {
+      continue;
+    }
+
+    std::vector<float> xs, ys;
+    nnview::layered_layout(layout, nnview::LayeredLayoutOption(), &xs, &ys);
+
+    nnview::ForceLayoutOption option;
+    option.max_iterations = 20;
+    option.tolerance = 0.0f;
+    option.num_threads = num_threads;
+
+    nnview::ForceLayout force;
+    BenchResult *result = runner->run(
+        force_name, mnodes * double(option.max_iterations), "Mnode", [&]() {
+          force.reset(layout, xs, ys, option);
+          while (force.step(1.0e9)) {
+          }
+        });
+    if (result) {
+      result->counters.emplace_back("nodes", double(layout.num_nodes()));
+      result->counters.emplace_back("iterations",
+                                    double(option.max_iterations));
+      result->counters.emplace_back("threads", double(num_threads));
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BenchRunner runner;
+  std::string output_filename;
+  std::string work_dir;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if ((i + 1) >= argc) {
+      fail("Missing value of " + arg);
+    }
+    if (arg.compare("--output") == 0) {
+      output_filename = argv[++i];
+    } else if (arg.compare("--filter") == 0) {
+      runner.filter = argv[++i];
+    } else if (arg.compare("--repeat") == 0) {
+      runner.repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (arg.compare("--work-dir") == 0) {
+      work_dir = argv[++i];
+    } else {
+      fail("Unknown option: " + arg);
+    }
+  }
+
+  // Keep loader messages(e.g. a summary per loaded graph) out of the
+  // measurement.
+  nnview::set_log_level(nnview::LOG_LEVEL_WARN);
+
+  bench_weights_parse(&runner, work_dir);
+  bench_json_graph_parse(&runner, work_dir);
+  bench_tensor_name_resolution(&runner);
+  bench_csr_graph(&runner);
+  bench_stats(&runner);
+  bench_colormap(&runner);
+  bench_layout(&runner);
+
+  FILE *fp = stdout;
+  if (!output_filename.empty()) {
+    fp = fopen(output_filename.c_str(), "w");
+    if (!fp) {
+      fail("Failed to open " + output_filename);
+    }
+  }
+  runner.write_json(fp);
+  if (fp != stdout) {
+    fclose(fp);
+  }
+
+  return EXIT_SUCCESS;
+}
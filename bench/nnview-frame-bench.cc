@@ -0,0 +1,174 @@
+//
+// Frame time benchmark of the graph view(GUIContext::draw_imnodes).
+//
+// Usage: nnview_frame_bench [num_frames]
+//
+// Opens a hidden window and draws synthetic graphs with viewport culling and
+// level-of-detail enabled and disabled.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "GL/gl3w.h"
+#include "GLFW/glfw3.h"
+
+#include "imgui.h"
+#include "imgui_impl_glfw_gl3.h"
+#include "imgui_node_editor.h"
+
+#include "gui_component.hh"
+#include "io/graph-loader.hh"
+#include "synthetic-graph.hh"
+
+namespace ed = ax::NodeEditor;
+
+namespace {
+
+double elapsed_ms(const std::chrono::high_resolution_clock::time_point &start) {
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void draw_frame(GLFWwindow *window, nnview::GUIContext *ctx) {
+  glfwPollEvents();
+  ImGui_ImplGlfwGL3_NewFrame();
+
+  int display_w, display_h;
+  glfwGetFramebufferSize(window, &display_w, &display_h);
+  glViewport(0, 0, display_w, display_h);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  ImGui::SetNextWindowPos(ImVec2(0, 0));
+  ImGui::SetNextWindowSize(ImVec2(float(display_w), float(display_h)));
+  ctx->draw_imnodes();
+  ctx->end_frame();
+
+  ImGui::Render();
+  glfwSwapBuffers(window);
+}
+
+// Returns average frame time in ms.
+double measure_frames(GLFWwindow *window, nnview::GUIContext *ctx,
+                      int num_frames) {
+  // Let the node editor apply navigation and measure node sizes.
+  for (int i = 0; i < 8; i++) {
+    draw_frame(window, ctx);
+  }
+  glFinish();
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_frames; i++) {
+    draw_frame(window, ctx);
+  }
+  glFinish();
+
+  return elapsed_ms(start) / double(num_frames);
+}
+
+void bench_graph_view(GLFWwindow *window, int num_frames) {
+  printf("# graph view frame time\n");
+  printf("%10s %10s %10s %6s %6s %6s %10s %12s\n", "layers", "imnodes",
+         "links", "view", "cull", "lod", "drawn", "ms/frame");
+
+  struct Config {
+    bool cull;
+    bool lod;
+  };
+  const Config configs[] = {{true, true}, {false, true}, {true, false}};
+
+  const size_t sizes[] = {1000, 10000, 100000};
+  for (size_t num_layers : sizes) {
+    nnview::GUIContext ctx;
+    ctx._graph = nnview::bench::make_chain_graph(num_layers);
+    if (!nnview::resolve_tensor_slots(&ctx._graph)) {
+      fprintf(stderr, "resolve_tensor_slots failed\n");
+      exit(EXIT_FAILURE);
+    }
+    ctx._csr_graph.build(ctx._graph);
+
+    ctx.init();
+    ctx.init_imnode_graph();
+
+    const float lod_scale_threshold = ctx._lod_scale_threshold;
+
+    for (int zoom = 0; zoom < 2; zoom++) {
+      if (zoom) {
+        // Zoom into the middle of the graph.
+        ed::SetCurrentEditor(ctx._editor_context);
+        ed::SelectNode(ctx._imnodes[ctx._imnodes.size() / 2].id);
+        ed::NavigateToSelection(/* zoomIn */ true, /* duration */ 0.0f);
+      }
+
+      for (const Config &config : configs) {
+        ctx._cull_imnodes = config.cull;
+        ctx._lod_scale_threshold = config.lod ? lod_scale_threshold : 0.0f;
+        const double ms = measure_frames(window, &ctx, num_frames);
+        printf("%10zu %10zu %10zu %6s %6s %6s %10zu %12.3f\n", num_layers,
+               ctx._imnodes.size(), ctx._links.size(), zoom ? "zoom" : "fit",
+               config.cull ? "on" : "off", config.lod ? "on" : "off",
+               ctx._num_drawn_imnodes, ms);
+      }
+    }
+
+    ctx.finalize();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int num_frames = 60;
+  if (argc > 1) {
+    num_frames = std::max(1, std::atoi(argv[1]));
+  }
+
+  if (!glfwInit()) {
+    fprintf(stderr, "Failed to initialize GLFW\n");
+    return EXIT_FAILURE;
+  }
+
+#if defined(__APPLE__)
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#else
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+#endif
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow *window =
+      glfwCreateWindow(1600, 900, "nnview_frame_bench", nullptr, nullptr);
+  if (!window) {
+    fprintf(stderr, "Failed to create window\n");
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(window);
+
+  // Do not wait for vsync.
+  glfwSwapInterval(0);
+
+  if (gl3wInit() != 0) {
+    fprintf(stderr, "Failed to create OpenGL3 context.\n");
+    return EXIT_FAILURE;
+  }
+
+  ImGui::CreateContext();
+  ImGui_ImplGlfwGL3_Init(window, /* install_callbacks */ false);
+
+  bench_graph_view(window, num_frames);
+
+  ImGui_ImplGlfwGL3_Shutdown();
+  ImGui::DestroyContext();
+
+  glfwDestroyWindow(window);
+  glfwTerminate();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,431 @@
+//
+// Generate a synthetic chainer-trt model(model.json and .weights/.tensor
+// files) for scale testing of loading, layout and rendering.
+//
+// Usage: nnview_gen_model --output DIR [options]
+//
+// --output DIR          : Output directory. Created when it does not exist.
+// --layers N            : # of layers. LinearFunction and ReLU alternate
+//                         along each chain. default: 1000
+// --width W             : # of units. Kernel of LinearFunction is W x W and
+//                         activations are 1 x W. default: 64
+// --branching B         : Fork each chain into B chains every
+//                         `--branch-interval` layers. 1 = a single chain.
+//                         default: 1
+// --branch-interval K   : default: 16
+// --dtype T             : float32, float16, bfloat16, int8 or int4.
+//                         default: float32
+// --fill F              : random or zeros. default: random
+// --seed S              : Seed of random values. default: 1
+// --threads N           : # of threads writing files. default: all
+// --dry-run             : Print the size of the model without writing files.
+//
+// Files of each 1024 layers are stored in a subdirectory, so a model of
+// millions of layers does not put millions of files in one directory.
+// Random values are derived from the seed and the file, so the same options
+// always generate the same model.
+//
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "datatypes.h"
+#include "parallel.hh"
+#include "synthetic-tensor.hh"
+
+namespace {
+
+using nnview::bench::fail;
+using nnview::bench::join_path;
+
+// Layers per subdirectory.
+constexpr size_t kLayersPerDirectory = 1024;
+
+// Values generated and written at once.
+constexpr size_t kBlockItems = size_t(1) << 20;
+
+constexpr size_t kNoSource = ~size_t(0);  // Source is the input layer
+
+struct GenerateOption {
+  std::string output_dir;
+  size_t num_layers = 1000;
+  int width = 64;
+  size_t branching = 1;
+  size_t branch_interval = 16;
+  nnview::DataType dtype = nnview::DATA_TYPE_FLOAT32;
+  bool zeros = false;
+  uint32_t seed = 1;
+  int num_threads = -1;
+  bool dry_run = false;
+};
+
+struct Layer {
+  size_t source = kNoSource;  // Index of the source layer
+  size_t chain = 0;           // Index of the chain(branch)
+  size_t depth = 0;
+  bool linear = true;         // LinearFunction or ReLU
+  bool has_consumer = false;  // false = output of the model
+};
+
+bool make_directory(const std::string &path) {
+#if defined(_WIN32)
+  return (_mkdir(path.c_str()) == 0) || (errno == EEXIST);
+#else
+  return (mkdir(path.c_str(), 0755) == 0) || (errno == EEXIST);
+#endif
+}
+
+bool parse_data_type(const std::string &s, nnview::DataType *dtype) {
+  const nnview::DataType dtypes[] = {
+      nnview::DATA_TYPE_FLOAT32, nnview::DATA_TYPE_FLOAT16,
+      nnview::DATA_TYPE_BFLOAT16, nnview::DATA_TYPE_INT8,
+      nnview::DATA_TYPE_INT4};
+  for (nnview::DataType d : dtypes) {
+    if (s.compare(nnview::get_data_type_name(d)) == 0) {
+      (*dtype) = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+//
+// Chains grow breadth first: each chain runs `branch_interval` layers and
+// then forks into `branching` chains, until `num_layers` layers are placed.
+//
+std::vector<Layer> plan_layers(const GenerateOption &option) {
+  std::vector<Layer> layers;
+  layers.reserve(option.num_layers);
+
+  struct Head {
+    size_t source;
+    size_t chain;
+    size_t depth;
+  };
+
+  std::deque<Head> heads;
+  heads.push_back({kNoSource, 0, 0});
+  size_t num_chains = 1;
+
+  while (!heads.empty() && (layers.size() < option.num_layers)) {
+    Head head = heads.front();
+    heads.pop_front();
+
+    for (size_t i = 0; (i < option.branch_interval) &&
+                       (layers.size() < option.num_layers);
+         i++) {
+      Layer layer;
+      layer.source = head.source;
+      layer.chain = head.chain;
+      layer.depth = head.depth;
+      layer.linear = (head.depth % 2) == 0;
+      if (head.source != kNoSource) {
+        layers[head.source].has_consumer = true;
+      }
+
+      head.source = layers.size();
+      head.depth++;
+      layers.push_back(layer);
+    }
+
+    for (size_t b = 0; b < option.branching; b++) {
+      heads.push_back({head.source, (b == 0) ? head.chain : num_chains++,
+                       head.depth});
+    }
+  }
+
+  return layers;
+}
+
+std::string layer_name(const std::vector<Layer> &layers, size_t i) {
+  if (i == kNoSource) {
+    return "input";
+  }
+  return (layers[i].linear ? "LinearFunction-" : "ReLU-") + std::to_string(i);
+}
+
+// Output tensor name of the layer.
+std::string output_name(const std::vector<Layer> &layers, size_t i) {
+  return (i == kNoSource) ? "input" : (layer_name(layers, i) + "_0");
+}
+
+std::string directory_name(size_t i) {
+  return "part" + std::to_string(i / kLayersPerDirectory);
+}
+
+size_t tensor_size(nnview::DataType dtype, const std::vector<int> &shape) {
+  nnview::Tensor tensor;
+  tensor.dtype = dtype;
+  tensor.shape = shape;
+  return tensor.data_size();
+}
+
+// Seed of random values of a file. Never 0(xorshift state).
+uint32_t file_seed(uint32_t seed, size_t layer, uint32_t kind) {
+  uint64_t h = (uint64_t(seed) << 32) ^ (uint64_t(layer) * 4 + kind);
+  // splitmix64 finalizer
+  h += 0x9e3779b97f4a7c15ull;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  const uint32_t s = uint32_t(h);
+  return s ? s : 1u;
+}
+
+// Scratch buffers of a writer thread.
+struct WriteBuffer {
+  std::vector<float> values;
+  std::vector<uint8_t> bytes;
+};
+
+void write_tensor_file(const std::string &filename, nnview::DataType dtype,
+                       const std::vector<int> &shape, bool zeros,
+                       uint32_t seed, WriteBuffer *buf) {
+  std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    fail("Failed to create " + filename);
+  }
+
+  nnview::bench::write_weights_header(ofs, dtype, shape);
+
+  size_t num_items = 1;
+  for (int d : shape) {
+    num_items *= size_t(d);
+  }
+
+  // Most files are small. Do not touch the whole block for them.
+  const size_t block_items = std::min(kBlockItems, num_items);
+  const size_t block_bytes = tensor_size(dtype, {int(block_items)});
+  if (buf->values.size() < block_items) {
+    buf->values.resize(block_items);
+  }
+  if (buf->bytes.size() < block_bytes) {
+    buf->bytes.resize(block_bytes);
+  }
+  if (zeros) {
+    std::fill(buf->bytes.begin(), buf->bytes.begin() + long(block_bytes), 0);
+  }
+
+  uint32_t state = seed;
+  for (size_t i = 0; i < num_items; i += kBlockItems) {
+    // kBlockItems is even, so int4 values are packed across blocks.
+    const size_t n = std::min(kBlockItems, num_items - i);
+    const size_t num_bytes = tensor_size(dtype, {int(n)});
+    if (!zeros) {
+      nnview::bench::fill_random_values(buf->values.data(), n, &state);
+      nnview::bench::encode_values(dtype, buf->values.data(), n,
+                                   buf->bytes.data());
+    }
+    ofs.write(reinterpret_cast<const char *>(buf->bytes.data()),
+              std::streamsize(num_bytes));
+  }
+
+  if (!ofs) {
+    fail("Failed to write " + filename);
+  }
+}
+
+void write_model_json(const GenerateOption &option,
+                      const std::vector<Layer> &layers) {
+  const std::string filename = join_path(option.output_dir, "model.json");
+  std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+  if (!ofs) {
+    fail("Failed to create " + filename);
+  }
+
+  const std::string w = std::to_string(option.width);
+  const std::string dtype = nnview::get_data_type_name(option.dtype);
+
+  ofs << "{\n  \"inputs\": [\"input\"],\n  \"outputs\": [";
+  size_t num_outputs = 0;
+  for (size_t i = 0; i < layers.size(); i++) {
+    if (!layers[i].has_consumer) {
+      ofs << (num_outputs ? ", " : "") << "[\"" << output_name(layers, i)
+          << "\", \"out" << num_outputs << "\"]";
+      num_outputs++;
+    }
+  }
+  ofs << "],\n  \"layers\": [\n";
+
+  ofs << "    {\"type\": \"input\", \"name\": \"input\", "
+         "\"output_names\": [\"input\"], \"rank\": -2, \"shape\": ["
+      << w << "], \"input_tensor\": \"input.tensor\"}";
+
+  for (size_t i = 0; i < layers.size(); i++) {
+    const Layer &layer = layers[i];
+    const std::string name = layer_name(layers, i);
+    const std::string path = directory_name(i) + "/" + name;
+
+    ofs << ",\n    {\"type\": \""
+        << (layer.linear ? "LinearFunction" : "ReLU") << "\", \"name\": \""
+        << name << "\", \"rank\": " << layer.depth
+        << ", \"group\": \"stage" << (layer.depth / option.branch_interval)
+        << "/branch" << layer.chain << "\", \"output_names\": [\"" << name
+        << "_0\"], \"source\": \"" << output_name(layers, layer.source)
+        << "\"";
+    if (layer.linear) {
+      ofs << ", \"n_out\": " << w << ", \"kernel_weights_file\": \"" << path
+          << "_kernel.weights\", \"bias_weights_file\": \"" << path
+          << "_bias.weights\", \"input_shapes\": [[1, " << w << "], [" << w
+          << ", " << w << "], [" << w << "]], \"input_types\": [\"" << dtype
+          << "\", \"" << dtype << "\", \"" << dtype << "\"]";
+    } else {
+      ofs << ", \"input_shapes\": [[1, " << w << "]], \"input_types\": [\""
+          << dtype << "\"]";
+    }
+    ofs << ", \"output_shape\": [1, " << w << "], \"output_type\": \"" << dtype
+        << "\", \"output_tensor\": \"" << path << "_0_output.tensor\"}";
+  }
+  ofs << "\n  ]\n}\n";
+
+  if (!ofs) {
+    fail("Failed to write " + filename);
+  }
+}
+
+void generate(const GenerateOption &option) {
+  const std::vector<Layer> layers = plan_layers(option);
+
+  // Size of the model.
+  const int w = option.width;
+  const size_t activation_bytes = tensor_size(option.dtype, {1, w});
+  const size_t linear_bytes = tensor_size(option.dtype, {w, w}) +
+                              tensor_size(option.dtype, {w}) +
+                              activation_bytes;
+  size_t num_files = 2;  // model.json and input.tensor
+  size_t num_bytes = activation_bytes;
+  size_t num_chains = 0;
+  size_t max_depth = 0;
+  for (const Layer &layer : layers) {
+    num_files += layer.linear ? 3 : 1;
+    num_bytes += layer.linear ? linear_bytes : activation_bytes;
+    num_chains = std::max(num_chains, layer.chain + 1);
+    max_depth = std::max(max_depth, layer.depth);
+  }
+
+  fprintf(stderr,
+          "layers: %zu, chains: %zu, depth: %zu, dtype: %s, files: %zu, "
+          "tensor data: %.3f GB\n",
+          layers.size(), num_chains, max_depth + 1,
+          nnview::get_data_type_name(option.dtype), num_files,
+          double(num_bytes) * 1.0e-9);
+
+  if (option.dry_run) {
+    return;
+  }
+
+  if (!make_directory(option.output_dir)) {
+    fail("Failed to create directory " + option.output_dir);
+  }
+  for (size_t i = 0; i < layers.size(); i += kLayersPerDirectory) {
+    const std::string dir = join_path(option.output_dir, directory_name(i));
+    if (!make_directory(dir)) {
+      fail("Failed to create directory " + dir);
+    }
+  }
+
+  write_model_json(option, layers);
+
+  const int num_threads = nnview::get_num_threads(option.num_threads);
+  std::vector<WriteBuffer> buffers(static_cast<size_t>(num_threads));
+
+  write_tensor_file(join_path(option.output_dir, "input.tensor"),
+                    option.dtype, {1, w}, option.zeros,
+                    file_seed(option.seed, kNoSource, 0), &buffers[0]);
+
+  std::atomic<size_t> num_done(0);
+  const size_t progress_step = std::max(size_t(1), layers.size() / 20);
+  nnview::parallel_for(
+      layers.size(), num_threads, [&](size_t i, int thread_id) {
+        WriteBuffer *buf = &buffers[size_t(thread_id)];
+        const std::string path =
+            join_path(option.output_dir,
+                      directory_name(i) + "/" + layer_name(layers, i));
+
+        if (layers[i].linear) {
+          write_tensor_file(path + "_kernel.weights", option.dtype, {w, w},
+                            option.zeros, file_seed(option.seed, i, 1), buf);
+          write_tensor_file(path + "_bias.weights", option.dtype, {w},
+                            option.zeros, file_seed(option.seed, i, 2), buf);
+        }
+        write_tensor_file(path + "_0_output.tensor", option.dtype, {1, w},
+                          option.zeros, file_seed(option.seed, i, 3), buf);
+
+        const size_t done = ++num_done;
+        if ((done % progress_step) == 0) {
+          fprintf(stderr, "  %zu / %zu layers\n", done, layers.size());
+        }
+      });
+
+  fprintf(stderr, "Wrote %s\n",
+          join_path(option.output_dir, "model.json").c_str());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  GenerateOption option;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg.compare("--dry-run") == 0) {
+      option.dry_run = true;
+      continue;
+    }
+
+    if ((i + 1) >= argc) {
+      fail("Missing value of " + arg);
+    }
+    const std::string value = argv[++i];
+
+    if (arg.compare("--output") == 0) {
+      option.output_dir = value;
+    } else if (arg.compare("--layers") == 0) {
+      option.num_layers = size_t(std::max(1LL, std::atoll(value.c_str())));
+    } else if (arg.compare("--width") == 0) {
+      option.width = std::max(1, std::atoi(value.c_str()));
+    } else if (arg.compare("--branching") == 0) {
+      option.branching = size_t(std::max(1, std::atoi(value.c_str())));
+    } else if (arg.compare("--branch-interval") == 0) {
+      option.branch_interval = size_t(std::max(1, std::atoi(value.c_str())));
+    } else if (arg.compare("--dtype") == 0) {
+      if (!parse_data_type(value, &option.dtype)) {
+        fail("Unknown dtype: " + value);
+      }
+    } else if (arg.compare("--fill") == 0) {
+      if ((value.compare("random") != 0) && (value.compare("zeros") != 0)) {
+        fail("--fill must be random or zeros: " + value);
+      }
+      option.zeros = (value.compare("zeros") == 0);
+    } else if (arg.compare("--seed") == 0) {
+      option.seed = uint32_t(std::strtoul(value.c_str(), nullptr, 10));
+    } else if (arg.compare("--threads") == 0) {
+      option.num_threads = std::atoi(value.c_str());
+    } else {
+      fail("Unknown option: " + arg);
+    }
+  }
+
+  if (option.output_dir.empty() && !option.dry_run) {
+    fail("Usage: nnview_gen_model --output DIR [--layers N] [--width W] "
+         "[--branching B] [--branch-interval K] [--dtype T] "
+         "[--fill random|zeros] [--seed S] [--threads N] [--dry-run]");
+  }
+
+  generate(option);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,361 @@
+//
+// Checks that the streaming(SAX) and DOM(json11) JSON loaders build the same
+// Graph.
+//
+// Usage: nnview_json_check [--work-dir DIR] [model.json ...]
+//
+// --work-dir : Directory for the JSON files of built-in cases, removed when
+//              finished. default: current directory
+//
+// Each model.json given(e.g. models/mnist/model.json, or a model written by
+// `nnview_gen_model --branching 2`) is loaded with both parsers and the
+// Graphs are compared field by field, including tensor payloads.
+// Built-in cases are always checked. They do not refer to weights files and
+// are loaded with `GraphLoaderOption::structure_only`.
+//
+// - branching : Seeded graph whose layers consume outputs of random earlier
+//               layers, with group paths.
+// - chunks    : Escape sequences, surrogate pairs and multibyte UTF-8 split
+//               at every byte of the 64K chunk boundary of the streaming
+//               parser.
+// - fields    : Duplicated keys, values other than strings and nested
+//               containers in layers.
+//
+// Mismatches are printed to stderr. Exits with failure when any is found.
+//
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "datatypes.h"
+#include "io/graph-loader.hh"
+#include "log.hh"
+#include "synthetic-tensor.hh"
+
+namespace {
+
+using nnview::bench::fail;
+using nnview::bench::join_path;
+
+// Chunk size of the streaming parser(see io/json-sax.cc).
+constexpr size_t kJsonChunkSize = 64 * 1024;
+
+// Mismatches printed per model.
+constexpr size_t kMaxPrintedMismatches = 20;
+
+class GraphComparer {
+ public:
+  explicit GraphComparer(const std::string &model) : _model(model) {}
+
+  size_t num_mismatches() const { return _num_mismatches; }
+
+  // `a` = streaming, `b` = DOM
+  void compare(const nnview::Graph &a, const nnview::Graph &b) {
+    compare_slots("inputs", a.inputs, b.inputs);
+    compare_slots("outputs", a.outputs, b.outputs);
+
+    if (check("nodes.size", a.nodes.size(), b.nodes.size())) {
+      for (size_t i = 0; i < a.nodes.size(); i++) {
+        const std::string path = "nodes[" + std::to_string(i) + "]";
+        const nnview::Node &na = a.nodes[i];
+        const nnview::Node &nb = b.nodes[i];
+        // `type` is not set by the loader.
+        check(path + ".id", na.id, nb.id);
+        check(path + ".depth", na.depth, nb.depth);
+        check(path + ".name", na.name, nb.name);
+        check(path + ".group", na.group, nb.group);
+        compare_slots(path + ".inputs", na.inputs, nb.inputs);
+        compare_slots(path + ".outputs", na.outputs, nb.outputs);
+      }
+    }
+
+    if (check("tensors.size", a.tensors.size(), b.tensors.size())) {
+      for (size_t i = 0; i < a.tensors.size(); i++) {
+        const std::string path = "tensors[" + std::to_string(i) + "]";
+        const nnview::Tensor &ta = a.tensors[i];
+        const nnview::Tensor &tb = b.tensors[i];
+        check(path + ".name", ta.name, tb.name);
+        check(path + ".dtype", int(ta.dtype), int(tb.dtype));
+        check(path + ".shape", ShapeString(ta.shape), ShapeString(tb.shape));
+        check(path + ".filename", ta.filename, tb.filename);
+        check(path + ".offset", ta.offset, tb.offset);
+        if (check(path + ".is_loaded", ta.is_loaded(), tb.is_loaded()) &&
+            ta.is_loaded() && (ta.data_size() == tb.data_size())) {
+          check(path + ".data",
+                std::memcmp(ta.data, tb.data, ta.data_size()) == 0, true);
+        }
+      }
+    }
+  }
+
+ private:
+  static std::string ShapeString(const std::vector<int> &shape) {
+    std::string s = "[";
+    for (size_t i = 0; i < shape.size(); i++) {
+      s += (i ? ", " : "") + std::to_string(shape[i]);
+    }
+    return s + "]";
+  }
+
+  void compare_slots(const std::string &path,
+                     const std::vector<nnview::Slot> &a,
+                     const std::vector<nnview::Slot> &b) {
+    if (!check(path + ".size", a.size(), b.size())) {
+      return;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+      const std::string slot_path = path + "[" + std::to_string(i) + "]";
+      check(slot_path + ".name", a[i].name, b[i].name);
+      check(slot_path + ".slot_name", a[i].slot_name, b[i].slot_name);
+      check(slot_path + ".id", a[i].id, b[i].id);
+    }
+  }
+
+  // Returns true when `a` equals `b`.
+  template <typename T>
+  bool check(const std::string &path, const T &a, const T &b) {
+    if (a == b) {
+      return true;
+    }
+
+    if (_num_mismatches < kMaxPrintedMismatches) {
+      std::ostringstream ss;
+      ss << _model << " : " << path << " : streaming = " << a
+         << ", dom = " << b;
+      fprintf(stderr, "%s\n", ss.str().c_str());
+    }
+    _num_mismatches++;
+    return false;
+  }
+
+  std::string _model;
+  size_t _num_mismatches = 0;
+};
+
+// Load `filename` with both parsers and compare. Returns # of mismatches.
+size_t check_model(const std::string &filename,
+                   nnview::GraphLoaderOption option) {
+  nnview::Graph graphs[2];
+  for (int k = 0; k < 2; k++) {
+    option.streaming_json = (k == 0);
+    if (!nnview::load_json_graph(filename, &graphs[k], option)) {
+      fail(std::string("load_json_graph failed(") +
+           (option.streaming_json ? "streaming" : "dom") + ") : " + filename);
+    }
+  }
+
+  GraphComparer comparer(filename);
+  comparer.compare(graphs[0], graphs[1]);
+
+  printf("%s : %zu nodes, %zu tensors, %zu mismatches\n", filename.c_str(),
+         graphs[0].nodes.size(), graphs[0].tensors.size(),
+         comparer.num_mismatches());
+  return comparer.num_mismatches();
+}
+
+void write_file(const std::string &filename, const std::string &content) {
+  std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+  ofs << content;
+  if (!ofs) {
+    fail("Failed to write " + filename);
+  }
+}
+
+// JSON of a ReLU layer which outputs `<name>_0`.
+std::string relu_layer(const std::string &name, const std::string &group,
+                       const std::string &source) {
+  return ",\n    {\"type\": \"ReLU\", \"name\": \"" + name +
+         "\", \"group\": \"" + group + "\", \"output_names\": [\"" + name +
+         "_0\"], \"source\": \"" + source + "\", \"output_tensor\": \"" +
+         name + "_0.tensor\"}";
+}
+
+std::string input_layer() {
+  return "    {\"type\": \"input\", \"name\": \"input\", \"output_names\": "
+         "[\"input\"], \"rank\": -2, \"shape\": [1], \"input_tensor\": "
+         "\"input.tensor\"}";
+}
+
+//
+// Layers consume the outputs of random earlier layers(within 64 layers), so
+// tensors have multiple consumers. LinearFunction and ReLU alternate.
+//
+std::string make_branching_json(size_t num_layers, uint32_t seed) {
+  uint32_t state = seed ? seed : 1u;
+  auto next = [&state](uint32_t n) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % n;
+  };
+
+  std::string layers = input_layer();
+  std::vector<std::string> outputs = {"input"};
+  for (size_t i = 0; i < num_layers; i++) {
+    const uint32_t window = uint32_t(std::min(outputs.size(), size_t(64)));
+    const std::string source =
+        outputs[outputs.size() - 1 - size_t(next(window))];
+    const std::string name = "layer-" + std::to_string(i);
+    const std::string group = "block" + std::to_string(i / 64) + "/unit" +
+                              std::to_string((i / 8) % 8);
+
+    if (i % 2) {
+      layers += relu_layer(name, group, source);
+    } else {
+      layers += ",\n    {\"type\": \"LinearFunction\", \"name\": \"" + name +
+                "\", \"group\": \"" + group + "\", \"rank\": " +
+                std::to_string(i) + ", \"output_names\": [\"" + name +
+                "_0\"], \"source\": \"" + source +
+                "\", \"n_out\": 16, \"kernel_weights_file\": \"" + name +
+                "_kernel.weights\", \"bias_weights_file\": \"" + name +
+                "_bias.weights\", \"input_shapes\": [[1, 16]], "
+                "\"output_shape\": [1, 16], \"output_tensor\": \"" +
+                name + "_0.tensor\"}";
+    }
+    outputs.push_back(name + "_0");
+  }
+
+  return "{\n  \"inputs\": [\"input\"],\n  \"outputs\": [[\"" +
+         outputs.back() + "\", \"prob\"]],\n  \"layers\": [\n" + layers +
+         "\n  ]\n}\n";
+}
+
+//
+// Chain of ReLU layers. The name of a layer ends with a token which is split
+// `split` bytes before a chunk boundary, for each token and each split
+// inside it. The group path and the slots of the layer also contain the
+// token at other offsets.
+//
+std::string make_chunk_boundary_json() {
+  // As written in JSON.
+  const char *tokens[] = {
+      "\\\"",  "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+      "\\u0041", "\\u00e9", "\\u20ac",
+      "\\ud83d\\ude00",                      // Surrogate pair
+      "\xc3\xa9",                            // Raw UTF-8, 2 bytes
+      "\xe2\x82\xac",                        // 3 bytes
+      "\xf0\x9f\x98\x80",                    // 4 bytes
+  };
+
+  std::string json =
+      "{\n  \"inputs\": [\"input\"],\n  \"outputs\": [[\"tail_0\", "
+      "\"prob\"]],\n  \"layers\": [\n" +
+      input_layer();
+
+  std::string source = "input";
+  size_t n = 0;
+  for (const char *token : tokens) {
+    const size_t len = strlen(token);
+    for (size_t split = 1; split < len; split++) {
+      const std::string prefix = ",\n    {\"type\": \"ReLU\", \"name\": \"";
+      json += prefix;
+
+      // Pad the name so that the token starts `split` bytes before the next
+      // chunk boundary.
+      std::string name = "split" + std::to_string(n++) + "-";
+      const size_t boundary =
+          (json.size() + name.size() + split + kJsonChunkSize - 1) /
+          kJsonChunkSize * kJsonChunkSize;
+      name += std::string(boundary - split - json.size() - name.size(), 'x');
+      name += token;
+
+      // Written by `relu_layer` without its prefix.
+      json += relu_layer(name, "g/" + std::string(token), source)
+                  .substr(prefix.size());
+      source = name + "_0";
+    }
+  }
+  json += relu_layer("tail", "g", source);
+  json += "\n  ]\n}\n";
+
+  return json;
+}
+
+//
+// Layers whose keys are duplicated, have values other than strings, or
+// contain nested containers, and elements of `layers` which are not
+// objects. json11 keeps the last value of a duplicated key.
+//
+std::string make_layer_fields_json() {
+  return "{\n  \"inputs\": [\"input\"],\n  \"outputs\": [[\"c_0\"]],\n"
+         "  \"layers\": [\n" +
+         input_layer() +
+         ",\n    1, \"layer\", null, [{\"type\": \"ReLU\", \"name\": "
+         "\"hidden\"}],"
+         "\n    {\"type\": \"ReLU\", \"name\": 1, \"name\": \"a\", "
+         "\"group\": {\"name\": \"inner\"}, \"output_names\": \"a_0\", "
+         "\"output_names\": [[\"n\"], \"a_0\", 3, {\"k\": \"v\"}], "
+         "\"source\": \"input\", \"output_tensor\": \"a_0.tensor\", "
+         "\"extra\": {\"name\": \"x\", \"output_names\": [\"y\"], "
+         "\"type\": [\"LinearFunction\"]}},"
+         "\n    {\"type\": \"LinearFunction\", \"name\": \"b\", "
+         "\"source\": \"a_0\", \"kernel_weights_file\": [\"k.weights\"], "
+         "\"bias_weights_file\": \"b.weights\", \"output_names\": "
+         "[\"b_0\"], \"output_tensor\": \"b_0.tensor\", \"rank\": 2.5, "
+         "\"shape\": [[1, 2], [3]], \"flag\": true},"
+         "\n    {\"type\": \"Unknown\", \"name\": \"u\", \"source\": "
+         "\"b_0\", \"output_names\": [\"u_0\"], \"output_tensor\": "
+         "\"u_0.tensor\"},"
+         "\n    {\"type\": \"ReLU\", \"name\": \"c\", \"source\": \"x\", "
+         "\"source\": null, \"group\": \"g\", \"group\": \"h\", "
+         "\"output_names\": [\"c_0\"], \"output_names\": {}, "
+         "\"output_names\": [\"c_0\"], \"output_tensor\": \"c_0.tensor\"}"
+         "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string work_dir;
+  std::vector<std::string> models;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if ((arg.compare("--work-dir") == 0) && ((i + 1) < argc)) {
+      work_dir = argv[++i];
+    } else if ((arg.size() > 1) && (arg[0] == '-')) {
+      fail("Usage: nnview_json_check [--work-dir DIR] [model.json ...]");
+    } else {
+      models.push_back(arg);
+    }
+  }
+
+  nnview::set_log_level(nnview::LOG_LEVEL_WARN);
+
+  size_t num_mismatches = 0;
+  for (const std::string &model : models) {
+    num_mismatches += check_model(model, nnview::GraphLoaderOption());
+  }
+
+  // Built-in cases.
+  {
+    nnview::GraphLoaderOption option;
+    option.structure_only = true;
+
+    const std::pair<std::string, std::string> cases[] = {
+        {"nnview-json-check-branching.json", make_branching_json(5000, 1)},
+        {"nnview-json-check-chunks.json", make_chunk_boundary_json()},
+        {"nnview-json-check-fields.json", make_layer_fields_json()},
+    };
+    for (const auto &c : cases) {
+      const std::string path = join_path(work_dir, c.first);
+      write_file(path, c.second);
+      num_mismatches += check_model(path, option);
+      std::remove(path.c_str());
+    }
+  }
+
+  if (num_mismatches > 0) {
+    fprintf(stderr, "%zu mismatches\n", num_mismatches);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+//
+// Synthetic graphs shared by benchmark programs.
+//
+#ifndef NNVIEW_BENCH_SYNTHETIC_GRAPH_HH_
+#define NNVIEW_BENCH_SYNTHETIC_GRAPH_HH_
+
+#include <string>
+
+#include "datatypes.h"
+
+namespace nnview {
+namespace bench {
+
+//
+// Synthetic chain of `num_layers` LinearFunction-like nodes.
+// Each node has 3 inputs(source, W, b) and 1 output tensor.
+//
+inline nnview::Graph make_chain_graph(size_t num_layers) {
+  nnview::Graph graph;
+
+  nnview::Tensor input;
+  input.name = "input";
+  graph.tensors.push_back(input);
+
+  std::string source = "input";
+  for (size_t i = 0; i < num_layers; i++) {
+    const std::string prefix = "Linear-" + std::to_string(i);
+
+    nnview::Node node;
+    node.type = nnview::LAYER_LINEAR_FUNCTION;
+    node.id = int(i);
+    node.depth = int(i);
+    node.name = prefix;
+    node.inputs.push_back(nnview::Slot(source, "input", -1));
+    node.inputs.push_back(nnview::Slot(prefix + "_kernel.weights", "W", -1));
+    node.inputs.push_back(nnview::Slot(prefix + "_bias.weights", "b", -1));
+    node.outputs.push_back(nnview::Slot(prefix + "_0", "output", -1));
+
+    for (const auto &slot : node.inputs) {
+      if (slot.slot_name.compare("input") != 0) {
+        nnview::Tensor tensor;
+        tensor.name = slot.name;
+        graph.tensors.push_back(tensor);
+      }
+    }
+
+    nnview::Tensor output;
+    output.name = node.outputs[0].name;
+    graph.tensors.push_back(output);
+
+    source = node.outputs[0].name;
+    graph.nodes.push_back(node);
+  }
+
+  return graph;
+}
+
+}  // namespace bench
+}  // namespace nnview
+
+#endif  // NNVIEW_BENCH_SYNTHETIC_GRAPH_HH_
@@ -0,0 +1,155 @@
+//
+// Synthetic tensor data, .weights file writer and file helpers shared by
+// benchmark and scale testing programs.
+//
+#ifndef NNVIEW_BENCH_SYNTHETIC_TENSOR_HH_
+#define NNVIEW_BENCH_SYNTHETIC_TENSOR_HH_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+namespace nnview {
+namespace bench {
+
+// Print `msg` and exit.
+[[noreturn]] inline void fail(const std::string &msg) {
+  fprintf(stderr, "%s\n", msg.c_str());
+  exit(EXIT_FAILURE);
+}
+
+inline std::string join_path(const std::string &dir,
+                             const std::string &filename) {
+  if (dir.empty() || (dir.back() == '/') || (dir.back() == '\\')) {
+    return dir + filename;
+  }
+  return dir + "/" + filename;
+}
+
+//
+// Fill `dst` with uniform values in [-1, 1) from xorshift32 `state`(must not
+// be 0). Gives the same sequence on all platforms.
+//
+inline void fill_random_values(float *dst, size_t n, uint32_t *state) {
+  uint32_t x = *state;
+  for (size_t i = 0; i < n; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dst[i] = float(x >> 8) * (2.0f / 16777216.0f) - 1.0f;
+  }
+  (*state) = x;
+}
+
+inline std::vector<float> make_random_values(size_t n, uint32_t seed) {
+  std::vector<float> values(n);
+  uint32_t state = seed ? seed : 1u;
+  fill_random_values(values.data(), n, &state);
+  return values;
+}
+
+// float to IEEE754 half. Values below the normal range of half are flushed
+// to zero. Values must be finite and below 65520.
+inline uint16_t float_to_half(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(float));
+  const uint32_t sign = (bits >> 16) & 0x8000u;
+  const int exp = int((bits >> 23) & 0xffu) - 127 + 15;
+  if (exp <= 0) {
+    return uint16_t(sign);
+  }
+  return uint16_t(sign | (uint32_t(exp) << 10) | ((bits >> 13) & 0x3ffu));
+}
+
+//
+// Encode `n` values in [-1, 1] to `dtype` and write them to `dst`
+// (Tensor::data_size() bytes for `n` items). Integer types are scaled to
+// their full range. For DATA_TYPE_INT4, `n` must be even unless this is the
+// last block of the tensor.
+//
+inline void encode_values(DataType dtype, const float *values, size_t n,
+                          uint8_t *dst) {
+  for (size_t i = 0; i < n; i++) {
+    const float v = values[i];
+    switch (dtype) {
+      case DATA_TYPE_FLOAT32:
+        memcpy(dst + i * 4, &v, 4);
+        break;
+      case DATA_TYPE_FLOAT16: {
+        const uint16_t h = float_to_half(v);
+        memcpy(dst + i * 2, &h, 2);
+        break;
+      }
+      case DATA_TYPE_BFLOAT16: {
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        const uint16_t b = uint16_t(bits >> 16);
+        memcpy(dst + i * 2, &b, 2);
+        break;
+      }
+      case DATA_TYPE_INT8:
+        dst[i] = uint8_t(int8_t(v * 127.0f));
+        break;
+      case DATA_TYPE_INT4: {
+        const uint8_t nibble = uint8_t(int(v * 7.0f) & 0xf);
+        dst[i / 2] =
+            (i & 1) ? uint8_t(dst[i / 2] | (nibble << 4)) : nibble;
+        break;
+      }
+    }
+  }
+}
+
+// 2D tensor of `dtype` holding `values`(rows x cols).
+inline Tensor make_tensor(DataType dtype, int rows, int cols,
+                          const std::vector<float> &values) {
+  Tensor tensor;
+  tensor.dtype = dtype;
+  tensor.shape = {rows, cols};
+
+  auto buf = std::make_shared<std::vector<uint8_t>>(tensor.data_size());
+  encode_values(dtype, values.data(), tensor.num_items(), buf->data());
+
+  tensor.data = buf->data();
+  tensor.storage = buf;
+  return tensor;
+}
+
+//
+// Write the header of chainer-trt .weights file. The first line is the item
+// size("4" for float32, "2" for float16) as chainer-trt writes it. Other
+// types are nnview extensions written as the type name(e.g. "bfloat16"),
+// which chainer-trt does not read.
+//
+inline void write_weights_header(std::ostream &os, DataType dtype,
+                                 const std::vector<int> &shape) {
+  switch (dtype) {
+    case DATA_TYPE_FLOAT32:
+      os << "4\n";
+      break;
+    case DATA_TYPE_FLOAT16:
+      os << "2\n";
+      break;
+    case DATA_TYPE_BFLOAT16:
+    case DATA_TYPE_INT8:
+    case DATA_TYPE_INT4:
+      os << get_data_type_name(dtype) << "\n";
+      break;
+  }
+  for (size_t i = 0; i < shape.size(); i++) {
+    os << (i ? "," : "") << shape[i];
+  }
+  os << "\n";
+}
+
+}  // namespace bench
+}  // namespace nnview
+
+#endif  // NNVIEW_BENCH_SYNTHETIC_TENSOR_HH_
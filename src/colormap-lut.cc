@@ -0,0 +1,171 @@
+#include "colormap-lut.hh"
+#include "colormap.hh"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nnview {
+
+namespace {
+
+struct ColormapTable {
+  alignas(16) uint8_t rgba[kColormapLUTSize * 4];
+};
+
+constexpr vec3 EvalColormap(Colormap cmap, float t) {
+  switch (cmap) {
+    case COLORMAP_VIRIDIS:
+      return viridis(t);
+    case COLORMAP_PLASMA:
+      return plasma(t);
+    case COLORMAP_MAGMA:
+      return magma(t);
+    case COLORMAP_INFERNO:
+      return inferno(t);
+    case COLORMAP_JET:
+      return jet(t);
+  }
+  return viridis(t);
+}
+
+constexpr uint8_t ToByte(float x) {
+  return (x <= 0.0f) ? uint8_t(0)
+                     : (x >= 1.0f) ? uint8_t(255)
+                                   : uint8_t(int(x * 255.0f + 0.5f));
+}
+
+constexpr ColormapTable MakeTable(Colormap cmap) {
+  ColormapTable table{};
+  for (size_t i = 0; i < kColormapLUTSize; i++) {
+    const float t = float(i) / float(kColormapLUTSize - 1);
+    const vec3 rgb = EvalColormap(cmap, t);
+    table.rgba[4 * i + 0] = ToByte(rgb.x);
+    table.rgba[4 * i + 1] = ToByte(rgb.y);
+    table.rgba[4 * i + 2] = ToByte(rgb.z);
+    table.rgba[4 * i + 3] = 255;
+  }
+  return table;
+}
+
+constexpr ColormapTable kColormapTables[kNumColormaps] = {
+    MakeTable(COLORMAP_VIRIDIS), MakeTable(COLORMAP_PLASMA),
+    MakeTable(COLORMAP_MAGMA), MakeTable(COLORMAP_INFERNO),
+    MakeTable(COLORMAP_JET)};
+
+}  // namespace
+
+const char *get_colormap_name(Colormap cmap) {
+  switch (cmap) {
+    case COLORMAP_VIRIDIS:
+      return "viridis";
+    case COLORMAP_PLASMA:
+      return "plasma";
+    case COLORMAP_MAGMA:
+      return "magma";
+    case COLORMAP_INFERNO:
+      return "inferno";
+    case COLORMAP_JET:
+      return "jet";
+  }
+  return "unknown";
+}
+
+const uint8_t *get_colormap_lut(Colormap cmap) {
+  const int idx = int(cmap);
+  if ((idx < 0) || (idx >= kNumColormaps)) {
+    return kColormapTables[COLORMAP_VIRIDIS].rgba;
+  }
+  return kColormapTables[idx].rgba;
+}
+
+void apply_colormap(const float *values, size_t n, float min_value,
+                    float max_value, Colormap cmap, uint8_t *dst) {
+  const uint8_t *lut = get_colormap_lut(cmap);
+
+  const float range = max_value - min_value;
+  // Map to [0, kColormapLUTSize - 1]. Constant tensor uses the first entry.
+  const float max_index = float(kColormapLUTSize - 1);
+  const float scale = (range > 0.0f) ? (max_index / range) : 0.0f;
+
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  {
+    const __m256 vmin = _mm256_set1_ps(min_value);
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vhalf = _mm256_set1_ps(0.5f);
+    const __m256 vzero = _mm256_setzero_ps();
+    const __m256 vmax_index = _mm256_set1_ps(max_index);
+    const int *lut32 = reinterpret_cast<const int *>(
+        reinterpret_cast<const void *>(lut));
+
+    for (; (i + 8) <= n; i += 8) {
+      __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(values + i), vmin),
+                               vscale);
+      // max_ps returns the 2nd operand when the 1st is NaN.
+      t = _mm256_min_ps(_mm256_max_ps(t, vzero), vmax_index);
+      const __m256i idx = _mm256_cvttps_epi32(_mm256_add_ps(t, vhalf));
+      const __m256i rgba = _mm256_i32gather_epi32(lut32, idx, 4);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(
+                              reinterpret_cast<void *>(dst + 4 * i)),
+                          rgba);
+    }
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  {
+    const __m128 vmin = _mm_set1_ps(min_value);
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 vhalf = _mm_set1_ps(0.5f);
+    const __m128 vzero = _mm_setzero_ps();
+    const __m128 vmax_index = _mm_set1_ps(max_index);
+    int32_t idx[4];
+
+    for (; (i + 4) <= n; i += 4) {
+      __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(values + i), vmin), vscale);
+      // max_ps returns the 2nd operand when the 1st is NaN.
+      t = _mm_min_ps(_mm_max_ps(t, vzero), vmax_index);
+      const __m128i vidx = _mm_cvttps_epi32(_mm_add_ps(t, vhalf));
+      std::memcpy(idx, &vidx, sizeof(vidx));
+      for (size_t k = 0; k < 4; k++) {
+        std::memcpy(dst + 4 * (i + k), lut + 4 * size_t(idx[k]), 4);
+      }
+    }
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  {
+    const float32x4_t vmin = vdupq_n_f32(min_value);
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    const float32x4_t vhalf = vdupq_n_f32(0.5f);
+    const float32x4_t vzero = vdupq_n_f32(0.0f);
+    const float32x4_t vmax_index = vdupq_n_f32(max_index);
+    uint32_t idx[4];
+
+    for (; (i + 4) <= n; i += 4) {
+      float32x4_t t = vmulq_f32(vsubq_f32(vld1q_f32(values + i), vmin), vscale);
+      // maxnm returns the number when one operand is NaN.
+      t = vminq_f32(vmaxnmq_f32(t, vzero), vmax_index);
+      vst1q_u32(idx, vcvtq_u32_f32(vaddq_f32(t, vhalf)));
+      for (size_t k = 0; k < 4; k++) {
+        std::memcpy(dst + 4 * (i + k), lut + 4 * size_t(idx[k]), 4);
+      }
+    }
+  }
+#endif
+
+  for (; i < n; i++) {
+    float t = (values[i] - min_value) * scale;
+    // `!(t > 0)` is also true for NaN.
+    t = (t > 0.0f) ? ((t < max_index) ? t : max_index) : 0.0f;
+    const size_t idx = size_t(t + 0.5f);
+    std::memcpy(dst + 4 * i, lut + 4 * idx, 4);
+  }
+}
+
+}  // namespace nnview
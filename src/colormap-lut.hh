@@ -0,0 +1,42 @@
+#ifndef NNVIEW_COLORMAP_LUT_HH_
+#define NNVIEW_COLORMAP_LUT_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// Precomputed colormap lookup tables.
+// Tables are generated at compile time from the polynomial fits in
+// colormap.hh, so colormapping a value is a quantize + table lookup.
+//
+namespace nnview {
+
+enum Colormap {
+  COLORMAP_VIRIDIS = 0,
+  COLORMAP_PLASMA,
+  COLORMAP_MAGMA,
+  COLORMAP_INFERNO,
+  COLORMAP_JET,
+};
+
+constexpr int kNumColormaps = 5;
+
+// # of entries in a LUT.
+constexpr size_t kColormapLUTSize = 256;
+
+const char *get_colormap_name(Colormap cmap);
+
+// Returns `kColormapLUTSize` RGBA8 entries(4 bytes per entry).
+const uint8_t *get_colormap_lut(Colormap cmap);
+
+//
+// Map `n` values in [min_value, max_value] to RGBA8 colors and write them to
+// `dst`(n * 4 bytes).
+// Values outside of the range are clamped. NaN is mapped to the first entry.
+//
+void apply_colormap(const float *values, size_t n, float min_value,
+                    float max_value, Colormap cmap, uint8_t *dst);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_COLORMAP_LUT_HH_
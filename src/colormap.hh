@@ -7,25 +7,21 @@ namespace nnview {
 
 struct vec3 {
   vec3() {}
-  vec3(float xx, float yy, float zz) {
-    x = xx;
-    y = yy;
-    z = zz;
-  }
+  constexpr vec3(float xx, float yy, float zz) : x(xx), y(yy), z(zz) {}
   vec3(const float *p) {
     x = p[0];
     y = p[1];
     z = p[2];
   }
 
-  vec3 operator*(float f) const { return vec3(x * f, y * f, z * f); }
-  vec3 operator-(const vec3 &f2) const {
+  constexpr vec3 operator*(float f) const { return vec3(x * f, y * f, z * f); }
+  constexpr vec3 operator-(const vec3 &f2) const {
     return vec3(x - f2.x, y - f2.y, z - f2.z);
   }
-  vec3 operator*(const vec3 &f2) const {
+  constexpr vec3 operator*(const vec3 &f2) const {
     return vec3(x * f2.x, y * f2.y, z * f2.z);
   }
-  vec3 operator+(const vec3 &f2) const {
+  constexpr vec3 operator+(const vec3 &f2) const {
     return vec3(x + f2.x, y + f2.y, z + f2.z);
   }
   vec3 &operator+=(const vec3 &f2) {
@@ -58,7 +54,7 @@ struct vec3 {
   // float pad;  // for alignment
 };
 
-inline vec3 operator*(float f, const vec3 &v) {
+constexpr vec3 operator*(float f, const vec3 &v) {
   return vec3(v.x * f, v.y * f, v.z * f);
 }
 
@@ -80,8 +76,11 @@ inline vec3 operator*(float f, const vec3 &v) {
 //
 // data fitted from https://github.com/BIDS/colormap/blob/master/colormaps.py
 // (which is licensed CC0)
+//
+// NOTE: Functions are `constexpr` so that colormap LUTs(colormap-lut.cc) can
+// be generated at compile time. Use LUT for per-pixel colormapping.
 
-static vec3 viridis(float t) {
+constexpr vec3 viridis(float t) {
 
     const vec3 c0 = vec3(0.2777273272234177f, 0.005407344544966578f, 0.3340998053353061f);
     const vec3 c1 = vec3(0.1050930431085774f, 1.404613529898575f, 1.384590162594685f);
@@ -95,8 +94,7 @@ static vec3 viridis(float t) {
 
 }
 
-#if 0
-static vec3 plasma(float t) {
+constexpr vec3 plasma(float t) {
 
     const vec3 c0 = vec3(0.05873234392399702f, 0.02333670892565664f, 0.5433401826748754f);
     const vec3 c1 = vec3(2.176514634195958f, 0.2383834171260182f, 0.7539604599784036f);
@@ -110,7 +108,7 @@ static vec3 plasma(float t) {
 
 }
 
-static vec3 magma(float t) {
+constexpr vec3 magma(float t) {
 
     const vec3 c0 = vec3(-0.002136485053939582f, -0.000749655052795221f, -0.005386127855323933f);
     const vec3 c1 = vec3(0.2516605407371642f, 0.6775232436837668f, 2.494026599312351f);
@@ -124,7 +122,7 @@ static vec3 magma(float t) {
 
 }
 
-static vec3 inferno(float t) {
+constexpr vec3 inferno(float t) {
 
     const vec3 c0 = vec3(0.0002189403691192265f, 0.001651004631001012f, -0.01948089843709184f);
     const vec3 c1 = vec3(0.1065134194856116f, 0.5639564367884091f, 3.932712388889277f);
@@ -139,11 +137,11 @@ static vec3 inferno(float t) {
 // --------------------------------------------------------------------==
 
 // https://stackoverflow.com/questions/7706339/grayscale-to-red-green-blue-matlab-jet-color-scale
-static float interpolate( float val, float y0, float x0, float y1, float x1 ) {
+constexpr float interpolate( float val, float y0, float x0, float y1, float x1 ) {
     return (val-x0)*(y1-y0)/(x1-x0) + y0;
 }
 
-static float base( float val ) {
+constexpr float base( float val ) {
     if ( val <= -0.75f ) return 0.0f;
     else if ( val <= -0.25f ) return interpolate( val, 0.0f, -0.75f, 1.0f, -0.25f );
     else if ( val <= 0.25f ) return 1.0f;
@@ -151,26 +149,21 @@ static float base( float val ) {
     else return 0.0f;
 }
 
-static float red( float gray ) {
+constexpr float red( float gray ) {
     return base( gray - 0.5f );
 }
-static float green( float gray ) {
+constexpr float green( float gray ) {
     return base( gray );
 }
-static float blue( float gray ) {
+constexpr float blue( float gray ) {
     return base( gray + 0.5f );
 }
 
-static vec3 jet(float t) {
-  vec3 col;
+constexpr vec3 jet(float t) {
   // [0, 1] to [-1, 1]
-  col[0] = red(2.0f * t - 1.0f);
-  col[1] = green(2.0f * t - 1.0f);
-  col[2] = blue(2.0f * t - 1.0f);
-
-  return col;
+  return vec3(red(2.0f * t - 1.0f), green(2.0f * t - 1.0f),
+              blue(2.0f * t - 1.0f));
 }
-#endif
 
 } // namespace nnview
 
@@ -1,6 +1,9 @@
 #ifndef NNVIEW_DATATYPES_H_
 #define NNVIEW_DATATYPES_H_
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -24,14 +27,76 @@ enum LayerType
   LAYER_TENSOR,
 };
 
+// Element type of Tensor payload. Data is kept in its native width.
+enum DataType
+{
+  DATA_TYPE_FLOAT32,
+  DATA_TYPE_FLOAT16,
+  DATA_TYPE_BFLOAT16,
+  DATA_TYPE_INT8,
+  DATA_TYPE_INT4, // Signed. 2 values per byte, lower 4 bits first.
+};
+
+inline const char *get_data_type_name(DataType dtype) {
+  switch (dtype) {
+    case DATA_TYPE_FLOAT32: return "float32";
+    case DATA_TYPE_FLOAT16: return "float16";
+    case DATA_TYPE_BFLOAT16: return "bfloat16";
+    case DATA_TYPE_INT8: return "int8";
+    case DATA_TYPE_INT4: return "int4";
+  }
+  return "unknown";
+}
+
+// IEEE754 half to float. Handles denormal, Inf and NaN.
+inline float half_to_float(uint16_t h) {
+  const uint32_t shifted_exp = 0x7c00u << 13;
+  uint32_t u = uint32_t(h & 0x7fffu) << 13;
+  const uint32_t exp = shifted_exp & u;
+  u += (127u - 15u) << 23;
+
+  float f;
+  if (exp == shifted_exp) {
+    u += (128u - 16u) << 23; // Inf/NaN
+    memcpy(&f, &u, sizeof(float));
+  } else if (exp == 0) {
+    // Denormal
+    u += 1u << 23;
+    const uint32_t magic_bits = 113u << 23;
+    float magic;
+    memcpy(&magic, &magic_bits, sizeof(float));
+    memcpy(&f, &u, sizeof(float));
+    f -= magic;
+  } else {
+    memcpy(&f, &u, sizeof(float));
+  }
+
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(float));
+  bits |= uint32_t(h & 0x8000u) << 16;
+  memcpy(&f, &bits, sizeof(float));
+  return f;
+}
+
+inline float bfloat16_to_float(uint16_t b) {
+  const uint32_t bits = uint32_t(b) << 16;
+  float f;
+  memcpy(&f, &bits, sizeof(float));
+  return f;
+}
+
 class Node
 {
  public:
   LayerType type;
   int id = 0; // Unique node id
-  int depth = 0; // Depth from the input node. Use this value for initial node layout.
+  int depth = 0; // Longest path from source nodes. See compute_node_depths().
   std::string name;
 
+  // Explicit group path(e.g. "encoder/block3"). Empty = derive from `name`.
+  // See graph-hierarchy.hh.
+  std::string group;
+
   std::vector<Slot> inputs;
   std::vector<Slot> outputs;
 };
@@ -42,9 +107,71 @@ class Tensor
   Tensor() {}
 
   std::string name;
-  std::string datatype = "float32"; // TODO(LTE): Support more data types.
+  DataType dtype = DATA_TYPE_FLOAT32;
   std::vector<int> shape;
-  std::vector<float> data;
+
+  // Location of the payload in weights/tensor file.
+  std::string filename;
+  size_t offset = 0;
+
+  // Payload. Either a heap buffer or a view into memory-mapped file.
+  // `storage` owns the memory and is shared between copies of the Tensor, so
+  // copying Tensor never copies the payload.
+  // NOTE: `data` may not be aligned to the size of `dtype`.
+  std::shared_ptr<const void> storage;
+  const uint8_t *data = nullptr;
+
+  size_t num_items() const {
+    size_t n = 1;
+    for (size_t i = 0; i < shape.size(); i++) {
+      n *= size_t(shape[i]);
+    }
+    return shape.empty() ? 0 : n;
+  }
+
+  // false when only metadata is loaded(lazy loading).
+  bool is_loaded() const { return data != nullptr; }
+
+  // Size of payload in bytes.
+  size_t data_size() const {
+    const size_t n = num_items();
+    switch (dtype) {
+      case DATA_TYPE_FLOAT32: return n * 4;
+      case DATA_TYPE_FLOAT16:
+      case DATA_TYPE_BFLOAT16: return n * 2;
+      case DATA_TYPE_INT8: return n;
+      case DATA_TYPE_INT4: return (n + 1) / 2;
+    }
+    return 0;
+  }
+
+  // Decode a single value. Use `decode_tensor_values`(tensor-decode.hh) for
+  // bulk conversion.
+  float value(size_t i) const {
+    switch (dtype) {
+      case DATA_TYPE_FLOAT32: {
+        float f;
+        memcpy(&f, data + i * sizeof(float), sizeof(float));
+        return f;
+      }
+      case DATA_TYPE_FLOAT16:
+      case DATA_TYPE_BFLOAT16: {
+        uint16_t h;
+        memcpy(&h, data + i * sizeof(uint16_t), sizeof(uint16_t));
+        return (dtype == DATA_TYPE_FLOAT16) ? half_to_float(h)
+                                            : bfloat16_to_float(h);
+      }
+      case DATA_TYPE_INT8:
+        return float(int8_t(data[i]));
+      case DATA_TYPE_INT4: {
+        const uint8_t b = data[i / 2];
+        const uint8_t nibble = (i & 1) ? uint8_t(b >> 4) : uint8_t(b & 0xf);
+        // Sign extend 4bit value.
+        return float(int(nibble ^ 0x8) - 8);
+      }
+    }
+    return 0.0f;
+  }
 };
 
 class Graph
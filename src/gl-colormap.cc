@@ -0,0 +1,273 @@
+#include "gl-colormap.hh"
+#include "log.hh"
+#include "trace.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace nnview {
+
+namespace {
+
+#if defined(__APPLE__)
+// OpenGL 3.2 core profile
+const char kGLSLVersion[] = "#version 150\n";
+#else
+// OpenGL 3.0
+const char kGLSLVersion[] = "#version 130\n";
+#endif
+
+// Full screen quad drawn with 4 vertices of GL_TRIANGLE_STRIP.
+// No vertex attributes are required.
+const char kVertexShader[] = R"(
+out vec2 v_uv;
+
+void main() {
+  vec2 p = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+  v_uv = p;
+  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char kFragmentShader[] = R"(
+uniform sampler2D u_values;
+uniform sampler2D u_lut;
+uniform vec2 u_range;  // (min, 1 / (max - min))
+uniform float u_lut_row;
+
+in vec2 v_uv;
+out vec4 frag_color;
+
+void main() {
+  float x = texture(u_values, v_uv).r;
+  float t = (x - u_range.x) * u_range.y;
+  if (isnan(t)) {
+    t = 0.0;
+  }
+  t = clamp(t, 0.0, 1.0);
+
+  // Sample at the center of LUT texels.
+  float u = (t * float(LUT_SIZE - 1) + 0.5) / float(LUT_SIZE);
+  frag_color = texture(u_lut, vec2(u, u_lut_row));
+}
+)";
+
+GLuint CompileShader(GLenum type, const char *source, std::string *err) {
+  const std::string header = std::string(kGLSLVersion) + "#define LUT_SIZE " +
+                             std::to_string(kColormapLUTSize) + "\n";
+  const GLchar *sources[2] = {header.c_str(), source};
+
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 2, sources, nullptr);
+  glCompileShader(shader);
+
+  GLint status = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    GLchar log[1024];
+    GLsizei len = 0;
+    glGetShaderInfoLog(shader, GLsizei(sizeof(log)), &len, log);
+    if (err) {
+      (*err) += "Failed to compile shader: " +
+                std::string(log, size_t(std::max(0, len))) + "\n";
+    }
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+void SetTextureParameters(GLint filter) {
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+}  // namespace
+
+bool ColormapRenderer::init(std::string *err) {
+  GLuint vs = CompileShader(GL_VERTEX_SHADER, kVertexShader, err);
+  GLuint fs = CompileShader(GL_FRAGMENT_SHADER, kFragmentShader, err);
+  if ((vs == 0) || (fs == 0)) {
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return false;
+  }
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vs);
+  glAttachShader(program, fs);
+  glLinkProgram(program);
+  glDeleteShader(vs);
+  glDeleteShader(fs);
+
+  GLint status = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    GLchar log[1024];
+    GLsizei len = 0;
+    glGetProgramInfoLog(program, GLsizei(sizeof(log)), &len, log);
+    if (err) {
+      (*err) += "Failed to link shader: " +
+                std::string(log, size_t(std::max(0, len))) + "\n";
+    }
+    glDeleteProgram(program);
+    return false;
+  }
+
+  _program = program;
+  _u_values = glGetUniformLocation(_program, "u_values");
+  _u_lut = glGetUniformLocation(_program, "u_lut");
+  _u_range = glGetUniformLocation(_program, "u_range");
+  _u_lut_row = glGetUniformLocation(_program, "u_lut_row");
+
+  // Core profile requires VAO bound for drawing.
+  glGenVertexArrays(1, &_vao);
+  glGenFramebuffers(1, &_fbo);
+
+  // All colormaps in one texture. One row per colormap.
+  std::vector<uint8_t> lut(kColormapLUTSize * size_t(kNumColormaps) * 4);
+  for (int i = 0; i < kNumColormaps; i++) {
+    std::copy_n(get_colormap_lut(Colormap(i)), kColormapLUTSize * 4,
+                lut.begin() + std::ptrdiff_t(kColormapLUTSize * 4 * size_t(i)));
+  }
+
+  GLint last_texture = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+
+  glGenTextures(1, &_lut_texture);
+  glBindTexture(GL_TEXTURE_2D, _lut_texture);
+  SetTextureParameters(GL_LINEAR);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(kColormapLUTSize),
+               kNumColormaps, 0, GL_RGBA, GL_UNSIGNED_BYTE, lut.data());
+
+  glBindTexture(GL_TEXTURE_2D, GLuint(last_texture));
+
+  return true;
+}
+
+void ColormapRenderer::finalize() {
+  if (_lut_texture) {
+    glDeleteTextures(1, &_lut_texture);
+    _lut_texture = 0;
+  }
+  if (_fbo) {
+    glDeleteFramebuffers(1, &_fbo);
+    _fbo = 0;
+  }
+  if (_vao) {
+    glDeleteVertexArrays(1, &_vao);
+    _vao = 0;
+  }
+  if (_program) {
+    glDeleteProgram(_program);
+    _program = 0;
+  }
+}
+
+GLuint ColormapRenderer::create_color_texture(int width, int height) const {
+  GLint last_texture = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+
+  GLuint texid = 0;
+  glGenTextures(1, &texid);
+  glBindTexture(GL_TEXTURE_2D, texid);
+  SetTextureParameters(GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  glBindTexture(GL_TEXTURE_2D, GLuint(last_texture));
+
+  return texid;
+}
+
+bool ColormapRenderer::render(GLuint value_tex, GLuint color_tex, int width,
+                              int height, float min_value, float max_value,
+                              Colormap cmap) const {
+  if (!is_valid() || (value_tex == 0) || (color_tex == 0)) {
+    return false;
+  }
+
+  NNVIEW_TRACE_SCOPE("colormap_tile_gpu");
+
+  // Backup GL state. The pass runs while ImGui frame is being built.
+  GLint last_fbo = 0, last_program = 0, last_vao = 0, last_active_texture = 0;
+  GLint last_texture0 = 0, last_texture1 = 0;
+  GLint last_viewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_fbo);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vao);
+  glGetIntegerv(GL_ACTIVE_TEXTURE, &last_active_texture);
+  glGetIntegerv(GL_VIEWPORT, last_viewport);
+  glActiveTexture(GL_TEXTURE0);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture0);
+  glActiveTexture(GL_TEXTURE1);
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture1);
+  const GLboolean last_blend = glIsEnabled(GL_BLEND);
+  const GLboolean last_depth_test = glIsEnabled(GL_DEPTH_TEST);
+  const GLboolean last_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         color_tex, 0);
+
+  bool ret = false;
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+    glViewport(0, 0, width, height);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_SCISSOR_TEST);
+
+    const float range = max_value - min_value;
+    // Constant tensor uses the first LUT entry.
+    const float inv_range = (range > 0.0f) ? (1.0f / range) : 0.0f;
+
+    glUseProgram(_program);
+    glUniform1i(_u_values, 0);
+    glUniform1i(_u_lut, 1);
+    glUniform2f(_u_range, min_value, inv_range);
+    glUniform1f(_u_lut_row, (float(cmap) + 0.5f) / float(kNumColormaps));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, value_tex);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, _lut_texture);
+
+    glBindVertexArray(_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    ret = true;
+  } else {
+    NNVIEW_LOG_WARN(GL) << "Colormap framebuffer is not complete.";
+  }
+
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         0, 0);
+
+  // Restore GL state.
+  glBindTexture(GL_TEXTURE_2D, GLuint(last_texture1));
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, GLuint(last_texture0));
+  glActiveTexture(GLenum(last_active_texture));
+  glBindVertexArray(GLuint(last_vao));
+  glUseProgram(GLuint(last_program));
+  glBindFramebuffer(GL_FRAMEBUFFER, GLuint(last_fbo));
+  glViewport(last_viewport[0], last_viewport[1], last_viewport[2],
+             last_viewport[3]);
+  if (last_blend) {
+    glEnable(GL_BLEND);
+  }
+  if (last_depth_test) {
+    glEnable(GL_DEPTH_TEST);
+  }
+  if (last_scissor_test) {
+    glEnable(GL_SCISSOR_TEST);
+  }
+
+  return ret;
+}
+
+}  // namespace nnview
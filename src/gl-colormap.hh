@@ -0,0 +1,63 @@
+#ifndef NNVIEW_GL_COLORMAP_HH_
+#define NNVIEW_GL_COLORMAP_HH_
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#endif
+
+#include "GL/gl3w.h"
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
+
+#include <string>
+
+#include "colormap-lut.hh"
+
+//
+// GPU colormapping of tensor values.
+//
+// Tensor values are uploaded once as a single channel float texture
+// (R32F, or R16F for float16 tensors. See gl-tensor-tiles.hh), and
+// normalization + colormap is applied by a fragment shader which renders into
+// RGBA8 texture through FBO.
+// Changing the value range or the colormap only re-runs the shader pass.
+//
+namespace nnview {
+
+class ColormapRenderer {
+ public:
+  // Compile the shader and create the LUT texture.
+  // Requires current OpenGL context.
+  bool init(std::string *err);
+
+  // Release GL resources.
+  void finalize();
+
+  bool is_valid() const { return _program != 0; }
+
+  // Create RGBA8 texture used as the render target of `render`.
+  GLuint create_color_texture(int width, int height) const;
+
+  // Map values in [min_value, max_value] of `value_tex` with `cmap` and write
+  // the result to `color_tex`. Both textures must be `width` x `height`.
+  bool render(GLuint value_tex, GLuint color_tex, int width, int height,
+              float min_value, float max_value, Colormap cmap) const;
+
+ private:
+  GLuint _program = 0;
+  GLuint _vao = 0;
+  GLuint _fbo = 0;
+  GLuint _lut_texture = 0;  // kColormapLUTSize x kNumColormaps RGBA8
+
+  GLint _u_values = -1;
+  GLint _u_lut = -1;
+  GLint _u_range = -1;
+  GLint _u_lut_row = -1;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_GL_COLORMAP_HH_
@@ -0,0 +1,223 @@
+#include "gl-tensor-tiles.hh"
+#include "trace.hh"
+
+#include <algorithm>
+#include <utility>
+
+namespace nnview {
+
+namespace {
+
+// 64bit FNV-1a over a 32bit value.
+uint64_t HashCombine(uint64_t h, int value) {
+  const uint32_t v = uint32_t(value);
+  for (int i = 0; i < 4; i++) {
+    h ^= (v >> (i * 8)) & 0xffu;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+bool IsAligned(const void *p, size_t alignment) {
+  return (reinterpret_cast<uintptr_t>(p) % alignment) == 0;
+}
+
+void SetTextureParameters() {
+  // No bilinear filtering.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+}  // namespace
+
+size_t TensorTileCache::TileKeyHash::operator()(const TileKey &key) const {
+  uint64_t h = 0xcbf29ce484222325ull;
+  h = HashCombine(h, key.tensor_id);
+  h = HashCombine(h, key.level);
+  h = HashCombine(h, key.tx);
+  h = HashCombine(h, key.ty);
+  return size_t(h);
+}
+
+GLuint TensorTileCache::get_tile(const ColormapRenderer &renderer,
+                                 int tensor_id, const TensorPyramid &pyramid,
+                                 int level, int tx, int ty, float min_value,
+                                 float max_value, Colormap cmap) {
+  if (pyramid.empty() || (level < 0) || (level >= pyramid.num_levels())) {
+    return 0;
+  }
+
+  const TileKey key{tensor_id, level, tx, ty};
+
+  auto it = _tiles.find(key);
+  const bool is_new = (it == _tiles.end());
+
+  bool needs_update = true;
+  if (!is_new) {
+    const Tile &tile = it->second;
+    needs_update = !tile.rendered || (tile.rendered_min != min_value) ||
+                   (tile.rendered_max != max_value) ||
+                   (tile.rendered_colormap != cmap);
+  }
+
+  // Creating a tile or colormapping on CPU reads the tensor region.
+  // Re-rendering on GPU is cheap and not limited.
+  const bool costly = is_new || (needs_update && !it->second.value_texid);
+  if (costly) {
+    if (_num_uploads >= max_uploads_per_frame) {
+      return is_new ? 0 : it->second.texid;
+    }
+    _num_uploads++;
+  } else if (!needs_update) {
+    it->second.last_used_frame = _frame;
+    return it->second.texid;
+  }
+
+  NNVIEW_TRACE_SCOPE("update_tensor_tile");
+
+  const int x = tx * kTensorTileSize;
+  const int y = ty * kTensorTileSize;
+
+  GLint last_texture = 0;
+  GLint last_alignment = 0;
+  GLint last_row_length = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &last_alignment);
+  glGetIntegerv(GL_UNPACK_ROW_LENGTH, &last_row_length);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (is_new) {
+    NNVIEW_TRACE_SCOPE("upload_tensor_tile");
+
+    Tile tile;
+    tile.tensor_id = tensor_id;
+    tile.width = std::min(kTensorTileSize, pyramid.width(level) - x);
+    tile.height = std::min(kTensorTileSize, pyramid.height(level) - y);
+
+    if (renderer.is_valid()) {
+      glGenTextures(1, &tile.value_texid);
+      glBindTexture(GL_TEXTURE_2D, tile.value_texid);
+      SetTextureParameters();
+
+      const Tensor *tensor = pyramid.tensor();
+      const size_t offset = size_t(y) * size_t(pyramid.width(0)) + size_t(x);
+      if ((level == 0) && (tensor->dtype == DATA_TYPE_FLOAT32) &&
+          IsAligned(tensor->data, 4)) {
+        // Upload from the payload as is.
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, pyramid.width(0));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, tile.width, tile.height, 0,
+                     GL_RED, GL_FLOAT, tensor->data + offset * 4);
+      } else if ((level == 0) && (tensor->dtype == DATA_TYPE_FLOAT16) &&
+                 IsAligned(tensor->data, 2)) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, pyramid.width(0));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, tile.width, tile.height, 0,
+                     GL_RED, GL_HALF_FLOAT, tensor->data + offset * 2);
+      } else {
+        _values.resize(size_t(tile.width) * size_t(tile.height));
+        pyramid.read_region(level, x, y, tile.width, tile.height,
+                            _values.data());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, tile.width, tile.height, 0,
+                     GL_RED, GL_FLOAT, _values.data());
+      }
+
+      tile.texid = renderer.create_color_texture(tile.width, tile.height);
+    } else {
+      glGenTextures(1, &tile.texid);
+    }
+
+    it = _tiles.emplace(key, std::move(tile)).first;
+  }
+
+  Tile &tile = it->second;
+  tile.last_used_frame = _frame;
+
+  if (tile.value_texid) {
+    // Only a shader pass.
+    renderer.render(tile.value_texid, tile.texid, tile.width, tile.height,
+                    min_value, max_value, cmap);
+  } else {
+    // Colormap on CPU.
+    NNVIEW_TRACE_SCOPE("colormap_tile_cpu");
+
+    const size_t n = size_t(tile.width) * size_t(tile.height);
+    _values.resize(n);
+    _rgba.resize(n * 4);
+    pyramid.read_region(level, x, y, tile.width, tile.height,
+                        _values.data());
+    apply_colormap(_values.data(), n, min_value, max_value, cmap,
+                   _rgba.data());
+
+    glBindTexture(GL_TEXTURE_2D, tile.texid);
+    SetTextureParameters();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tile.width, tile.height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, _rgba.data());
+  }
+
+  tile.rendered = true;
+  tile.rendered_min = min_value;
+  tile.rendered_max = max_value;
+  tile.rendered_colormap = cmap;
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, last_row_length);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, last_alignment);
+  glBindTexture(GL_TEXTURE_2D, GLuint(last_texture));
+
+  return tile.texid;
+}
+
+void TensorTileCache::end_frame() {
+  if (_tiles.size() > max_tiles) {
+    // Evict least recently used tiles. Tiles used in this frame are kept.
+    std::vector<std::pair<uint64_t, TileKey>> candidates;  // <frame, key>
+    for (const auto &it : _tiles) {
+      if (it.second.last_used_frame < _frame) {
+        candidates.emplace_back(it.second.last_used_frame, it.first);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<uint64_t, TileKey> &a,
+                 const std::pair<uint64_t, TileKey> &b) {
+                return a.first < b.first;
+              });
+
+    for (const auto &candidate : candidates) {
+      if (_tiles.size() <= max_tiles) {
+        break;
+      }
+      auto it = _tiles.find(candidate.second);
+      release(&it->second);
+      _tiles.erase(it);
+    }
+  }
+
+  _frame++;
+  _num_uploads = 0;
+}
+
+void TensorTileCache::clear(int tensor_id) {
+  for (auto it = _tiles.begin(); it != _tiles.end();) {
+    if ((tensor_id == -1) || (it->second.tensor_id == tensor_id)) {
+      release(&it->second);
+      it = _tiles.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void TensorTileCache::release(Tile *tile) {
+  if (tile->value_texid) {
+    glDeleteTextures(1, &tile->value_texid);
+    tile->value_texid = 0;
+  }
+  if (tile->texid) {
+    glDeleteTextures(1, &tile->texid);
+    tile->texid = 0;
+  }
+}
+
+}  // namespace nnview
@@ -0,0 +1,93 @@
+#ifndef NNVIEW_GL_TENSOR_TILES_HH_
+#define NNVIEW_GL_TENSOR_TILES_HH_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "gl-colormap.hh"
+#include "tensor-pyramid.hh"
+
+//
+// GPU cache of tensor tiles.
+// Tiles of `TensorPyramid` levels are uploaded when they become visible and
+// evicted in least recently used order, so GPU memory is bounded by
+// `max_tiles` regardless of the tensor size(and GL_MAX_TEXTURE_SIZE).
+//
+namespace nnview {
+
+class TensorTileCache {
+ public:
+  // Max # of tiles kept on GPU. A tile is up to 512x512 texels of
+  // R32F + RGBA8(2 MB).
+  size_t max_tiles = 128;
+
+  // Max # of tiles uploaded in a frame, so that scrolling through a large
+  // tensor does not stall the UI. Remaining tiles are uploaded in the
+  // following frames.
+  int max_uploads_per_frame = 8;
+
+  //
+  // Returns RGBA8 texture of the tile (`tx`, `ty`) of `level`, colormapped
+  // with [min_value, max_value] and `cmap`.
+  // Returns 0 when the tile is not available in this frame.
+  // `tensor_id` identifies `pyramid` in the cache.
+  //
+  GLuint get_tile(const ColormapRenderer &renderer, int tensor_id,
+                  const TensorPyramid &pyramid, int level, int tx, int ty,
+                  float min_value, float max_value, Colormap cmap);
+
+  // Call once per frame after drawing tiles. Evicts tiles over budget.
+  void end_frame();
+
+  // Release tiles of `tensor_id`. -1 = all tiles.
+  void clear(int tensor_id = -1);
+
+ private:
+  struct Tile {
+    int tensor_id = -1;
+    GLuint value_texid = 0;  // 0 when colormapped on CPU
+    GLuint texid = 0;        // RGBA8
+    int width = 0;
+    int height = 0;
+
+    bool rendered = false;
+    float rendered_min = 0.0f;
+    float rendered_max = 0.0f;
+    Colormap rendered_colormap = COLORMAP_VIRIDIS;
+
+    uint64_t last_used_frame = 0;
+  };
+
+  // Identifies a tile. All fields are kept as is, so tiles of large
+  // tensors(or many tensors) never share a key.
+  struct TileKey {
+    int tensor_id;
+    int level;
+    int tx;
+    int ty;
+
+    bool operator==(const TileKey &rhs) const {
+      return (tensor_id == rhs.tensor_id) && (level == rhs.level) &&
+             (tx == rhs.tx) && (ty == rhs.ty);
+    }
+  };
+
+  struct TileKeyHash {
+    size_t operator()(const TileKey &key) const;
+  };
+
+  void release(Tile *tile);
+
+  std::unordered_map<TileKey, Tile, TileKeyHash> _tiles;
+  uint64_t _frame = 0;
+  int _num_uploads = 0;
+
+  // Staging buffers.
+  std::vector<float> _values;
+  std::vector<uint8_t> _rgba;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_GL_TENSOR_TILES_HH_
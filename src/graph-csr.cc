@@ -0,0 +1,265 @@
+#include "graph-csr.hh"
+
+#include <cstring>
+
+namespace nnview {
+
+constexpr uint32_t StringPool::kInvalidId;
+
+// FNV-1a
+static uint64_t HashString(const char *s, size_t len) {
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < len; i++) {
+    h ^= uint64_t(uint8_t(s[i]));
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+void StringPool::clear() {
+  _chars.clear();
+  _offsets.assign(1, 0);
+  _hashes.clear();
+  _table.clear();
+}
+
+uint32_t StringPool::Find(const char *s, size_t len, uint64_t hash,
+                          size_t *slot) const {
+  const size_t mask = _table.size() - 1;
+  for (size_t i = size_t(hash) & mask;; i = (i + 1) & mask) {
+    const uint32_t id = _table[i];
+    if (id == kInvalidId) {
+      (*slot) = i;
+      return kInvalidId;
+    }
+    if ((_hashes[id] == hash) && (length(id) == len) &&
+        (memcmp(c_str(id), s, len) == 0)) {
+      (*slot) = i;
+      return id;
+    }
+  }
+}
+
+void StringPool::Rehash(size_t num_slots) {
+  _table.assign(num_slots, kInvalidId);
+  const size_t mask = num_slots - 1;
+  for (size_t id = 0; id < _hashes.size(); id++) {
+    size_t i = size_t(_hashes[id]) & mask;
+    while (_table[i] != kInvalidId) {
+      i = (i + 1) & mask;
+    }
+    _table[i] = uint32_t(id);
+  }
+}
+
+uint32_t StringPool::intern(const std::string &s) {
+  if (_table.empty()) {
+    Rehash(64);
+  }
+
+  const uint64_t hash = HashString(s.c_str(), s.size());
+
+  size_t slot = 0;
+  const uint32_t found = Find(s.c_str(), s.size(), hash, &slot);
+  if (found != kInvalidId) {
+    return found;
+  }
+
+  // Keep the load factor below 1/2.
+  if ((size() + 1) * 2 > _table.size()) {
+    Rehash(_table.size() * 2);
+    Find(s.c_str(), s.size(), hash, &slot);
+  }
+
+  const uint32_t id = uint32_t(size());
+  _chars.insert(_chars.end(), s.begin(), s.end());
+  _chars.push_back('\0');
+  _offsets.push_back(_chars.size());
+  _hashes.push_back(hash);
+  _table[slot] = id;
+
+  return id;
+}
+
+uint32_t StringPool::find(const std::string &s) const {
+  if (_table.empty()) {
+    return kInvalidId;
+  }
+
+  size_t slot = 0;
+  return Find(s.c_str(), s.size(), HashString(s.c_str(), s.size()), &slot);
+}
+
+void CsrGraph::clear() {
+  _names.clear();
+  _node_names.clear();
+  _node_types.clear();
+  _tensor_names.clear();
+  _name_to_node.clear();
+  _name_to_tensor.clear();
+  _input_offsets.clear();
+  _input_tensors.clear();
+  _input_slot_names.clear();
+  _output_offsets.clear();
+  _output_tensors.clear();
+  _output_slot_names.clear();
+  _producer_offsets.clear();
+  _producers.clear();
+  _consumer_offsets.clear();
+  _consumers.clear();
+  _succ_offsets.clear();
+  _succs.clear();
+  _pred_offsets.clear();
+  _preds.clear();
+}
+
+// Group <node, slot> of `slots` of all nodes by tensor(counting sort).
+static void BuildTensorSlots(const Graph &graph, bool outputs,
+                             std::vector<uint32_t> *offsets,
+                             std::vector<CsrSlotRef> *refs) {
+  const size_t num_tensors = graph.tensors.size();
+
+  offsets->assign(num_tensors + 1, 0);
+  for (const Node &node : graph.nodes) {
+    for (const Slot &slot : (outputs ? node.outputs : node.inputs)) {
+      if ((slot.id >= 0) && (size_t(slot.id) < num_tensors)) {
+        (*offsets)[size_t(slot.id) + 1]++;
+      }
+    }
+  }
+  for (size_t t = 0; t < num_tensors; t++) {
+    (*offsets)[t + 1] += (*offsets)[t];
+  }
+
+  refs->resize((*offsets)[num_tensors]);
+  std::vector<uint32_t> cursor(offsets->begin(), offsets->end() - 1);
+  for (size_t n = 0; n < graph.nodes.size(); n++) {
+    const std::vector<Slot> &slots =
+        outputs ? graph.nodes[n].outputs : graph.nodes[n].inputs;
+    for (size_t s = 0; s < slots.size(); s++) {
+      const int id = slots[s].id;
+      if ((id >= 0) && (size_t(id) < num_tensors)) {
+        (*refs)[cursor[size_t(id)]++] = {int32_t(n), int32_t(s)};
+      }
+    }
+  }
+}
+
+void CsrGraph::build(const Graph &graph) {
+  clear();
+
+  const size_t num_nodes = graph.nodes.size();
+  const size_t num_tensors = graph.tensors.size();
+
+  _node_names.reserve(num_nodes);
+  _node_types.reserve(num_nodes);
+  for (const Node &node : graph.nodes) {
+    _node_names.push_back(_names.intern(node.name));
+    _node_types.push_back(node.type);
+  }
+
+  _tensor_names.reserve(num_tensors);
+  for (const Tensor &tensor : graph.tensors) {
+    _tensor_names.push_back(_names.intern(tensor.name));
+  }
+
+  // Slots. Nodes are visited in order, so each row is appended at once.
+  _input_offsets.reserve(num_nodes + 1);
+  _output_offsets.reserve(num_nodes + 1);
+  _input_offsets.push_back(0);
+  _output_offsets.push_back(0);
+  for (const Node &node : graph.nodes) {
+    for (const Slot &slot : node.inputs) {
+      _input_tensors.push_back(
+          (size_t(slot.id) < num_tensors) ? int32_t(slot.id) : -1);
+      _input_slot_names.push_back(_names.intern(slot.slot_name));
+    }
+    _input_offsets.push_back(uint32_t(_input_tensors.size()));
+
+    for (const Slot &slot : node.outputs) {
+      _output_tensors.push_back(
+          (size_t(slot.id) < num_tensors) ? int32_t(slot.id) : -1);
+      _output_slot_names.push_back(_names.intern(slot.slot_name));
+    }
+    _output_offsets.push_back(uint32_t(_output_tensors.size()));
+  }
+
+  // The first one wins for duplicated names(same as resolve_tensor_slots).
+  _name_to_node.assign(_names.size(), -1);
+  for (size_t n = num_nodes; n > 0; n--) {
+    _name_to_node[_node_names[n - 1]] = int32_t(n - 1);
+  }
+  _name_to_tensor.assign(_names.size(), -1);
+  for (size_t t = num_tensors; t > 0; t--) {
+    _name_to_tensor[_tensor_names[t - 1]] = int32_t(t - 1);
+  }
+
+  BuildTensorSlots(graph, /* outputs */ true, &_producer_offsets,
+                   &_producers);
+  BuildTensorSlots(graph, /* outputs */ false, &_consumer_offsets,
+                   &_consumers);
+
+  // Node to node connections through tensors.
+  _succ_offsets.reserve(num_nodes + 1);
+  _pred_offsets.reserve(num_nodes + 1);
+  _succ_offsets.push_back(0);
+  _pred_offsets.push_back(0);
+  for (size_t n = 0; n < num_nodes; n++) {
+    for (int32_t t : outputs(n)) {
+      if (t < 0) {
+        continue;
+      }
+      for (const CsrSlotRef &ref : consumers(size_t(t))) {
+        if (size_t(ref.node) != n) {
+          _succs.push_back(ref.node);
+        }
+      }
+    }
+    _succ_offsets.push_back(uint32_t(_succs.size()));
+
+    for (int32_t t : inputs(n)) {
+      if (t < 0) {
+        continue;
+      }
+      for (const CsrSlotRef &ref : producers(size_t(t))) {
+        if (size_t(ref.node) != n) {
+          _preds.push_back(ref.node);
+        }
+      }
+    }
+    _pred_offsets.push_back(uint32_t(_preds.size()));
+  }
+}
+
+int CsrGraph::find_node(const std::string &name) const {
+  const uint32_t id = _names.find(name);
+  return (id == StringPool::kInvalidId) ? -1 : _name_to_node[id];
+}
+
+int CsrGraph::find_tensor(const std::string &name) const {
+  const uint32_t id = _names.find(name);
+  return (id == StringPool::kInvalidId) ? -1 : _name_to_tensor[id];
+}
+
+size_t CsrGraph::num_bytes() const {
+  size_t n = _names.num_bytes();
+
+  n += (_node_names.size() + _tensor_names.size()) * sizeof(uint32_t);
+  n += _node_types.size() * sizeof(LayerType);
+  n += (_name_to_node.size() + _name_to_tensor.size()) * sizeof(int32_t);
+
+  for (const auto *v :
+       {&_input_offsets, &_input_slot_names, &_output_offsets,
+        &_output_slot_names, &_producer_offsets, &_consumer_offsets,
+        &_succ_offsets, &_pred_offsets}) {
+    n += v->size() * sizeof(uint32_t);
+  }
+  for (const auto *v : {&_input_tensors, &_output_tensors, &_succs, &_preds}) {
+    n += v->size() * sizeof(int32_t);
+  }
+  n += (_producers.size() + _consumers.size()) * sizeof(CsrSlotRef);
+
+  return n;
+}
+
+}  // namespace nnview
@@ -0,0 +1,187 @@
+#ifndef NNVIEW_GRAPH_CSR_HH_
+#define NNVIEW_GRAPH_CSR_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Compact, immutable form of Graph for traversal and analysis passes.
+// Connections are kept in compressed sparse row(CSR) arrays and names are
+// interned into a single character buffer, so a graph of millions of nodes
+// takes a handful of allocations and is traversed with linear memory access.
+// Graph stays as the editable representation. Rebuild CsrGraph after
+// editing it.
+//
+namespace nnview {
+
+//
+// Set of unique strings. Each string is stored once, NUL terminated, in a
+// contiguous buffer and is referred by a dense id.
+//
+class StringPool {
+ public:
+  static constexpr uint32_t kInvalidId = 0xffffffffu;
+
+  void clear();
+
+  // Returns the id of `s`. Added when not in the pool.
+  uint32_t intern(const std::string &s);
+
+  // Returns kInvalidId when `s` is not in the pool.
+  uint32_t find(const std::string &s) const;
+
+  const char *c_str(uint32_t id) const { return &_chars[_offsets[id]]; }
+  size_t length(uint32_t id) const {
+    return _offsets[size_t(id) + 1] - _offsets[id] - 1;
+  }
+
+  // # of strings.
+  size_t size() const { return _hashes.size(); }
+
+  // Bytes used by strings and the hash table.
+  size_t num_bytes() const {
+    return _chars.size() + _offsets.size() * sizeof(size_t) +
+           _hashes.size() * sizeof(uint64_t) +
+           _table.size() * sizeof(uint32_t);
+  }
+
+ private:
+  uint32_t Find(const char *s, size_t len, uint64_t hash, size_t *slot) const;
+  void Rehash(size_t num_slots);
+
+  std::vector<char> _chars;
+  std::vector<size_t> _offsets = std::vector<size_t>(1, 0);
+  std::vector<uint64_t> _hashes;  // Hash of each string
+
+  // Open addressing table of ids. kInvalidId = empty.
+  std::vector<uint32_t> _table;
+};
+
+// Contiguous range of a CSR array.
+template <typename T>
+class CsrRange {
+ public:
+  CsrRange(const T *begin, const T *end) : _begin(begin), _end(end) {}
+
+  const T *begin() const { return _begin; }
+  const T *end() const { return _end; }
+  size_t size() const { return size_t(_end - _begin); }
+  bool empty() const { return _begin == _end; }
+  const T &operator[](size_t i) const { return _begin[i]; }
+
+ private:
+  const T *_begin;
+  const T *_end;
+};
+
+// Slot of a node connected to a tensor.
+struct CsrSlotRef {
+  int32_t node;
+  int32_t slot;  // Index to Node::inputs or Node::outputs
+};
+
+class CsrGraph {
+ public:
+  // Build from `graph`. Slots must be resolved. Unresolved slots(id < 0)
+  // have tensor -1 and are not counted as connections.
+  void build(const Graph &graph);
+
+  void clear();
+
+  size_t num_nodes() const { return _node_names.size(); }
+  size_t num_tensors() const { return _tensor_names.size(); }
+
+  const StringPool &names() const { return _names; }
+
+  const char *node_name(size_t node) const {
+    return _names.c_str(_node_names[node]);
+  }
+  const char *tensor_name(size_t tensor) const {
+    return _names.c_str(_tensor_names[tensor]);
+  }
+  LayerType node_type(size_t node) const { return _node_types[node]; }
+
+  // Returns -1 when not found.
+  int find_node(const std::string &name) const;
+  int find_tensor(const std::string &name) const;
+
+  // Tensor of each input/output slot of the node.
+  CsrRange<int32_t> inputs(size_t node) const {
+    return Range(_input_offsets, _input_tensors, node);
+  }
+  CsrRange<int32_t> outputs(size_t node) const {
+    return Range(_output_offsets, _output_tensors, node);
+  }
+
+  // Interned slot name of each input/output slot of the node.
+  CsrRange<uint32_t> input_slot_names(size_t node) const {
+    return Range(_input_offsets, _input_slot_names, node);
+  }
+  CsrRange<uint32_t> output_slot_names(size_t node) const {
+    return Range(_output_offsets, _output_slot_names, node);
+  }
+
+  // Nodes which output / take the tensor, in node order.
+  CsrRange<CsrSlotRef> producers(size_t tensor) const {
+    return Range(_producer_offsets, _producers, tensor);
+  }
+  CsrRange<CsrSlotRef> consumers(size_t tensor) const {
+    return Range(_consumer_offsets, _consumers, tensor);
+  }
+
+  // Nodes connected through a tensor. A node appears once per connecting
+  // slot, so there may be duplicates.
+  CsrRange<int32_t> successors(size_t node) const {
+    return Range(_succ_offsets, _succs, node);
+  }
+  CsrRange<int32_t> predecessors(size_t node) const {
+    return Range(_pred_offsets, _preds, node);
+  }
+
+  // Approximate bytes used by the arrays.
+  size_t num_bytes() const;
+
+ private:
+  template <typename T>
+  static CsrRange<T> Range(const std::vector<uint32_t> &offsets,
+                           const std::vector<T> &items, size_t i) {
+    return CsrRange<T>(items.data() + offsets[i],
+                       items.data() + offsets[i + 1]);
+  }
+
+  StringPool _names;
+
+  std::vector<uint32_t> _node_names;
+  std::vector<LayerType> _node_types;
+  std::vector<uint32_t> _tensor_names;
+
+  // Name id to node/tensor index. -1 = none.
+  std::vector<int32_t> _name_to_node;
+  std::vector<int32_t> _name_to_tensor;
+
+  std::vector<uint32_t> _input_offsets;
+  std::vector<int32_t> _input_tensors;
+  std::vector<uint32_t> _input_slot_names;
+
+  std::vector<uint32_t> _output_offsets;
+  std::vector<int32_t> _output_tensors;
+  std::vector<uint32_t> _output_slot_names;
+
+  std::vector<uint32_t> _producer_offsets;
+  std::vector<CsrSlotRef> _producers;
+  std::vector<uint32_t> _consumer_offsets;
+  std::vector<CsrSlotRef> _consumers;
+
+  std::vector<uint32_t> _succ_offsets;
+  std::vector<int32_t> _succs;
+  std::vector<uint32_t> _pred_offsets;
+  std::vector<int32_t> _preds;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_GRAPH_CSR_HH_
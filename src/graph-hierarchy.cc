@@ -0,0 +1,217 @@
+#include "graph-hierarchy.hh"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace nnview {
+
+namespace {
+
+// Group tree before merging trivial groups.
+struct RawGroup {
+  std::string name;
+  int parent = -1;
+  std::vector<int> children;
+  std::vector<int> nodes;
+  size_t num_nodes = 0;
+};
+
+bool IsSeparator(char c) { return (c == '/') || (c == '.'); }
+
+// Path of the group which `node` belongs to. Empty = top level.
+std::string GroupPath(const Node &node) {
+  if (!node.group.empty()) {
+    return node.group;
+  }
+
+  for (size_t i = node.name.size(); i > 0; i--) {
+    if (IsSeparator(node.name[i - 1])) {
+      return node.name.substr(0, i - 1);
+    }
+  }
+
+  return std::string();
+}
+
+// Find or create the raw group of `path` and its ancestors.
+int FindOrCreateRawGroup(const std::string &path,
+                         std::unordered_map<std::string, int> *path_to_group,
+                         std::vector<RawGroup> *groups) {
+  if (path.empty()) {
+    return -1;
+  }
+
+  auto it = path_to_group->find(path);
+  if (it != path_to_group->end()) {
+    return it->second;
+  }
+
+  int parent = -1;
+  for (size_t i = path.size(); i > 0; i--) {
+    if (IsSeparator(path[i - 1])) {
+      parent = FindOrCreateRawGroup(path.substr(0, i - 1), path_to_group,
+                                    groups);
+      break;
+    }
+  }
+
+  const int idx = int(groups->size());
+  RawGroup group;
+  group.name = path;
+  group.parent = parent;
+  groups->push_back(group);
+
+  if (parent >= 0) {
+    (*groups)[size_t(parent)].children.push_back(idx);
+  }
+
+  (*path_to_group)[path] = idx;
+
+  return idx;
+}
+
+}  // namespace
+
+void find_parameter_tensors(const Graph &graph, std::vector<bool> *params) {
+  params->assign(graph.tensors.size(), true);
+  for (const auto &node : graph.nodes) {
+    for (const auto &slot : node.outputs) {
+      if ((slot.id >= 0) && (size_t(slot.id) < params->size())) {
+        (*params)[size_t(slot.id)] = false;
+      }
+    }
+  }
+}
+
+void GraphHierarchy::clear() {
+  _groups.clear();
+  _node_groups.clear();
+  _root_groups.clear();
+  _root_nodes.clear();
+}
+
+void GraphHierarchy::build(const Graph &graph) {
+  clear();
+
+  std::vector<RawGroup> raw_groups;
+  std::unordered_map<std::string, int> path_to_group;
+
+  std::vector<int> raw_node_groups(graph.nodes.size(), -1);
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    const int g = FindOrCreateRawGroup(GroupPath(graph.nodes[i]),
+                                       &path_to_group, &raw_groups);
+    raw_node_groups[i] = g;
+    if (g >= 0) {
+      raw_groups[size_t(g)].nodes.push_back(int(i));
+    }
+  }
+
+  // Parent is always created before its children.
+  for (size_t i = raw_groups.size(); i > 0; i--) {
+    RawGroup &group = raw_groups[i - 1];
+    group.num_nodes += group.nodes.size();
+    if (group.parent >= 0) {
+      raw_groups[size_t(group.parent)].num_nodes += group.num_nodes;
+    }
+  }
+
+  // Merge trivial groups into the parent, top-down.
+  // `raw_to_group[i]` = group which raw group `i` is merged into.
+  std::vector<int> raw_to_group(raw_groups.size(), -1);
+  for (size_t i = 0; i < raw_groups.size(); i++) {
+    const RawGroup &raw = raw_groups[i];
+    const int parent =
+        (raw.parent >= 0) ? raw_to_group[size_t(raw.parent)] : -1;
+
+    const bool trivial = (raw.num_nodes < 2) ||
+                         (raw.nodes.empty() && (raw.children.size() == 1));
+    if (trivial) {
+      raw_to_group[i] = parent;
+      continue;
+    }
+
+    const int idx = int(_groups.size());
+    NodeGroup group;
+    group.name = raw.name;
+    group.parent = parent;
+    if (parent >= 0) {
+      // Label is relative to the parent.
+      const std::string &parent_name = _groups[size_t(parent)].name;
+      group.label = raw.name.substr(
+          std::min(raw.name.size(), parent_name.size() + 1));
+      _groups[size_t(parent)].children.push_back(idx);
+    } else {
+      group.label = raw.name;
+      _root_groups.push_back(idx);
+    }
+    _groups.push_back(group);
+
+    raw_to_group[i] = idx;
+  }
+
+  _node_groups.assign(graph.nodes.size(), -1);
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    const int raw = raw_node_groups[i];
+    const int g = (raw >= 0) ? raw_to_group[size_t(raw)] : -1;
+    _node_groups[i] = g;
+    if (g >= 0) {
+      _groups[size_t(g)].nodes.push_back(int(i));
+    } else {
+      _root_nodes.push_back(int(i));
+    }
+  }
+
+  // Summary. Parameter tensor is counted in the group of its first consumer.
+  std::vector<bool> params;
+  find_parameter_tensors(graph, &params);
+
+  for (auto &group : _groups) {
+    group.min_depth = std::numeric_limits<int>::max();
+  }
+
+  for (size_t i = 0; i < graph.nodes.size(); i++) {
+    const Node &node = graph.nodes[i];
+
+    size_t num_params = 0;
+    size_t num_bytes = 0;
+    for (const auto &slot : node.inputs) {
+      if ((slot.id < 0) || !params[size_t(slot.id)]) {
+        continue;
+      }
+      // Do not count shared parameters twice.
+      params[size_t(slot.id)] = false;
+
+      const Tensor &tensor = graph.tensors[size_t(slot.id)];
+      num_params += tensor.num_items();
+      num_bytes += tensor.data_size();
+    }
+
+    for (int g = _node_groups[i]; g >= 0; g = _groups[size_t(g)].parent) {
+      NodeGroup &group = _groups[size_t(g)];
+      group.num_nodes++;
+      group.num_params += num_params;
+      group.num_bytes += num_bytes;
+      group.min_depth = std::min(group.min_depth, node.depth);
+    }
+  }
+}
+
+bool GraphHierarchy::is_descendant(int group, int ancestor) const {
+  for (int g = group; g >= 0; g = _groups[size_t(g)].parent) {
+    if (g == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void GraphHierarchy::collect_nodes(int group, std::vector<int> *nodes) const {
+  const NodeGroup &g = _groups[size_t(group)];
+  nodes->insert(nodes->end(), g.nodes.begin(), g.nodes.end());
+  for (int child : g.children) {
+    collect_nodes(child, nodes);
+  }
+}
+
+}  // namespace nnview
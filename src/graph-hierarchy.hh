@@ -0,0 +1,72 @@
+#ifndef NNVIEW_GRAPH_HIERARCHY_HH_
+#define NNVIEW_GRAPH_HIERARCHY_HH_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "datatypes.h"
+
+//
+// Hierarchical grouping of Graph nodes for collapsing subgraphs on GUI.
+// The group of a node is taken from `Node::group`(explicit group in JSON),
+// or from the prefix of its name otherwise. '/' and '.' separate levels, so
+// "encoder.layers.3.fc1" belongs to "encoder.layers.3", which is a child of
+// "encoder.layers".
+// A group with a single member or a single child is merged into its parent
+// so that every level is worth collapsing.
+//
+namespace nnview {
+
+struct NodeGroup {
+  std::string name;   // Full path. e.g. "encoder.layers.3"
+  std::string label;  // Last level of the path. e.g. "3"
+
+  int parent = -1;  // -1 = top level
+
+  std::vector<int> children;  // Index to child groups
+  std::vector<int> nodes;     // Index to Graph::nodes directly in this group
+
+  // Summary of the whole subtree.
+  size_t num_nodes = 0;
+  size_t num_params = 0;  // # of items in parameter tensors
+  size_t num_bytes = 0;   // Bytes of parameter tensors
+  int min_depth = 0;      // Smallest Node::depth
+};
+
+class GraphHierarchy {
+ public:
+  // Build groups of `graph` nodes. Slots of `graph` must be resolved.
+  void build(const Graph &graph);
+
+  void clear();
+
+  const std::vector<NodeGroup> &groups() const { return _groups; }
+
+  // Innermost group of the node. -1 = top level.
+  int node_group(size_t node_idx) const { return _node_groups[node_idx]; }
+
+  // Groups and nodes at top level.
+  const std::vector<int> &root_groups() const { return _root_groups; }
+  const std::vector<int> &root_nodes() const { return _root_nodes; }
+
+  // Returns true when `group` is `ancestor` or its descendant.
+  bool is_descendant(int group, int ancestor) const;
+
+  // Append all nodes in the subtree of `group` to `nodes`.
+  void collect_nodes(int group, std::vector<int> *nodes) const;
+
+ private:
+  std::vector<NodeGroup> _groups;
+  std::vector<int> _node_groups;
+  std::vector<int> _root_groups;
+  std::vector<int> _root_nodes;
+};
+
+// Tensors which are not produced by any node(weights, biases, ...).
+// `params[i]` is true when `graph.tensors[i]` is a parameter.
+void find_parameter_tensors(const Graph &graph, std::vector<bool> *params);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_GRAPH_HIERARCHY_HH_
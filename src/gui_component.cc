@@ -22,14 +22,20 @@
 #include "imgui.h"
 #include "imgui_internal.h"
 
-#include "colormap.hh"
+#include "colormap-lut.hh"
+#include "graph-hierarchy.hh"
 #include "gui_component.hh"
+#include "io/weights-loader.hh"
+#include "log.hh"
+#include "tensor-stats.hh"
+#include "trace.hh"
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
-#include <iostream>
 #include <limits>
+#include <unordered_map>
 
 namespace util = ax::NodeEditor::Utilities;
 
@@ -37,44 +43,6 @@ namespace nnview {
 
 using ax::Widgets::IconType;
 
-inline uint8_t ftoc(const float x) {
-  int i = int(x * 255.0f);
-  i = std::min(255, std::max(0, i));
-  return uint8_t(i);
-}
-
-static std::vector<uint8_t> tensor_to_color(const nnview::Tensor &tensor) {
-  std::vector<uint8_t> img;
-  img.resize(size_t(tensor.shape[0] * tensor.shape[1] * 4));
-
-  // find max/min value
-  float min_value = std::numeric_limits<float>::max();
-  float max_value = -std::numeric_limits<float>::max();
-
-  for (size_t i = 0; i < size_t(tensor.shape[0] * tensor.shape[1]); i++) {
-    min_value = std::min(min_value, tensor.data[i]);
-    max_value = std::max(max_value, tensor.data[i]);
-  }
-
-  std::cout << "tensor min/max = " << min_value << ", " << max_value
-            << std::endl;
-
-  for (size_t i = 0; i < size_t(tensor.shape[0] * tensor.shape[1]); i++) {
-    // normalize.
-    const float x = (tensor.data[i] - min_value) / (max_value - min_value);
-    nnview::vec3 rgb = nnview::viridis(x);
-
-    // std::cout << rgb[0] << ", " << rgb[1] << ", " << rgb[2] << std::endl;
-
-    img[4 * i + 0] = ftoc(rgb[0]);
-    img[4 * i + 1] = ftoc(rgb[1]);
-    img[4 * i + 2] = ftoc(rgb[2]);
-    img[4 * i + 3] = 255;
-  }
-
-  return img;
-}
-
 static GLuint create_gray_texture() {
   static constexpr std::array<uint8_t, 16> data{
       {35, 35, 35, 255, 35, 35, 35, 255, 35, 35, 35, 255, 35, 35, 35, 255}};
@@ -114,8 +82,13 @@ static void show_tensor_value(
   const float cell_left_margin = std::max(0.0f, step / 2.0f - 24.0f);
   const float cell_top_margin = std::max(0.0f, step / 2.0f - 10.0f);
 
-  const size_t height = size_t(tensor.shape[0]);
-  const size_t width = size_t(tensor.shape[1]);
+  int image_width = 0;
+  int image_height = 0;
+  if (!get_tensor_image_size(tensor, &image_width, &image_height)) {
+    return;
+  }
+  const size_t height = size_t(image_height);
+  const size_t width = size_t(image_width);
 
   ImVec2 window_size = ImGui::GetWindowSize();
 
@@ -143,7 +116,7 @@ static void show_tensor_value(
         continue;
       }
 
-      const float value = tensor.data[y * width + x];
+      const float value = tensor.value(y * width + x);
 
       char buf[64];
       snprintf(buf, sizeof(buf), "%4.3f", double(value));
@@ -181,28 +154,6 @@ static void show_tensor_value(
   }
 }
 
-static GLuint gen_gl_texture(const nnview::Tensor &tensor) {
-  GLuint texid = 0;
-  glGenTextures(1, &texid);
-
-  glBindTexture(GL_TEXTURE_2D, texid);
-
-  std::vector<uint8_t> img = tensor_to_color(tensor);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tensor.shape[1], tensor.shape[0],
-               /* border */ 0, GL_RGBA, GL_UNSIGNED_BYTE, img.data());
-
-  // No bilinear filtering.
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  glBindTexture(GL_TEXTURE_2D, 0);
-
-  return texid;
-}
-
 static int GetNextId() {
   static int s_NextId = 1;
   return s_NextId++;
@@ -215,6 +166,42 @@ static ed::NodeId GetNextNodeId() {
 
 static ed::LinkId GetNextLinkId() { return ed::LinkId(uint32_t(GetNextId())); }
 
+// Initial layout of ImNodes.
+static constexpr float kNodeSize = 128.0f;
+static constexpr float kNodeRectSlotSizeY = 32.0f;
+
+// e.g. 1234567 -> "1.23M"
+static std::string FormatCount(size_t n) {
+  char buf[32];
+  const double v = double(n);
+  if (v >= 1.0e9) {
+    snprintf(buf, sizeof(buf), "%.2fG", v / 1.0e9);
+  } else if (v >= 1.0e6) {
+    snprintf(buf, sizeof(buf), "%.2fM", v / 1.0e6);
+  } else if (v >= 1.0e3) {
+    snprintf(buf, sizeof(buf), "%.2fK", v / 1.0e3);
+  } else {
+    snprintf(buf, sizeof(buf), "%zu", n);
+  }
+  return std::string(buf);
+}
+
+// e.g. 1048576 -> "1.00 MiB"
+static std::string FormatBytes(size_t n) {
+  char buf[32];
+  const double v = double(n);
+  if (v >= 1024.0 * 1024.0 * 1024.0) {
+    snprintf(buf, sizeof(buf), "%.2f GiB", v / (1024.0 * 1024.0 * 1024.0));
+  } else if (v >= 1024.0 * 1024.0) {
+    snprintf(buf, sizeof(buf), "%.2f MiB", v / (1024.0 * 1024.0));
+  } else if (v >= 1024.0) {
+    snprintf(buf, sizeof(buf), "%.2f KiB", v / 1024.0);
+  } else {
+    snprintf(buf, sizeof(buf), "%zu B", n);
+  }
+  return std::string(buf);
+}
+
 static ImColor GetIconColor(PinType type) {
   switch (type) {
     case PinType::Flow:
@@ -277,21 +264,176 @@ static void DrawPinIcon(const Pin &pin, bool connected, int alpha) {
 //  return ImRect(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
 //}
 
+void GUIContext::reset_spatial_index() {
+  // Cell size is about the size of a few nodes.
+  _imnode_grid.reset(512.0f);
+  _link_grid.reset(512.0f);
+
+  _imnode_links.clear();
+
+  _imnode_visible.clear();
+  _visible_imnodes.clear();
+  _visible_links.clear();
+  _hovered_imnode_idx = -1;
+}
+
+void GUIContext::update_imnode_bounds(size_t imnode_idx, const ImVec2 &pos,
+                                      const ImVec2 &size) {
+  ImNode &node = _imnodes[imnode_idx];
+  node.pos = pos;
+  node.size = size;
+
+  if (node.removed) {
+    return;
+  }
+
+  _imnode_grid.update(int(imnode_idx), pos.x, pos.y, pos.x + size.x,
+                      pos.y + size.y);
+
+  if (imnode_idx >= _imnode_links.size()) {
+    return;
+  }
+
+  for (int link_idx : _imnode_links[imnode_idx]) {
+    update_link_bounds(size_t(link_idx));
+  }
+}
+
+void GUIContext::update_link_bounds(size_t link_idx) {
+  const Link &link = _links[link_idx];
+  if (link.removed) {
+    return;
+  }
+
+  // A link is covered by the bounding box of its end nodes.
+  const ImNode &a = _imnodes[size_t(link.start_imnode_idx)];
+  const ImNode &b = _imnodes[size_t(link.end_imnode_idx)];
+
+  _link_grid.update(int(link_idx), std::min(a.pos.x, b.pos.x),
+                    std::min(a.pos.y, b.pos.y),
+                    std::max(a.pos.x + a.size.x, b.pos.x + b.size.x),
+                    std::max(a.pos.y + a.size.y, b.pos.y + b.size.y));
+}
+
+void GUIContext::cull_imnodes(const ImVec2 &view_min, const ImVec2 &view_max) {
+  if (_imnode_visible.size() != _imnodes.size()) {
+    _imnode_visible.assign(_imnodes.size(), 0);
+    _visible_imnodes.clear();
+  }
+
+  for (int idx : _visible_imnodes) {
+    _imnode_visible[size_t(idx)] = 0;
+  }
+  _visible_imnodes.clear();
+  _visible_links.clear();
+
+  _imnode_grid.query(view_min.x, view_min.y, view_max.x, view_max.y,
+                     &_visible_imnodes);
+  for (int idx : _visible_imnodes) {
+    _imnode_visible[size_t(idx)] = 1;
+  }
+
+  // ed::Link() requires both end pins to be submitted in the same frame, so
+  // end nodes of a visible link are also visible.
+  _link_grid.query(view_min.x, view_min.y, view_max.x, view_max.y,
+                   &_visible_links);
+  for (int link_idx : _visible_links) {
+    const Link &link = _links[size_t(link_idx)];
+    for (int idx : {link.start_imnode_idx, link.end_imnode_idx}) {
+      if (!_imnode_visible[size_t(idx)]) {
+        _imnode_visible[size_t(idx)] = 1;
+        _visible_imnodes.push_back(idx);
+      }
+    }
+  }
+
+  // Keep the drawing order of nodes and links.
+  std::sort(_visible_imnodes.begin(), _visible_imnodes.end());
+  std::sort(_visible_links.begin(), _visible_links.end());
+}
+
+// Draw ImNode as a plain rectangle(no header, pins and text).
+static void DrawSimpleNode(const ImNode &node) {
+  ed::PushStyleColor(ed::StyleColor_NodeBg, node.color);
+  ed::PushStyleVar(ed::StyleVar_NodePadding, ImVec4(0, 0, 0, 0));
+
+  ed::BeginNode(node.id);
+  ImGui::Dummy(node.size);
+  ed::EndNode();
+
+  ed::PopStyleVar();
+  ed::PopStyleColor();
+}
+
 void GUIContext::draw_imnodes() {
+  NNVIEW_TRACE_SCOPE("draw_imnodes");
+
   ImGui::Begin("Graph");
 
   ed::SetCurrentEditor(_editor_context);
 
+  // Screen rect of the node editor canvas.
+  const ImVec2 screen_min = ImGui::GetCursorScreenPos();
+  const ImVec2 screen_avail = ImGui::GetContentRegionAvail();
+
   ed::Begin("Graph");
 
+  {
+    // Compute the visible region in canvas coordinate.
+    // Add a margin so that nodes appear before they enter the view, and the
+    // node size estimate for never-drawn nodes does not have to be exact.
+    const float margin = 64.0f;
+    const ImVec2 view_min = ed::ScreenToCanvas(screen_min);
+    const ImVec2 view_max = ed::ScreenToCanvas(ImVec2(
+        screen_min.x + screen_avail.x, screen_min.y + screen_avail.y));
+
+    // Screen pixels per canvas unit.
+    _canvas_scale = (view_max.x > view_min.x)
+                        ? screen_avail.x / (view_max.x - view_min.x)
+                        : 1.0f;
+
+    if (_cull_imnodes) {
+      cull_imnodes(ImVec2(view_min.x - margin, view_min.y - margin),
+                   ImVec2(view_max.x + margin, view_max.y + margin));
+    } else {
+      cull_imnodes(ImVec2(-std::numeric_limits<float>::max(),
+                          -std::numeric_limits<float>::max()),
+                   ImVec2(std::numeric_limits<float>::max(),
+                          std::numeric_limits<float>::max()));
+    }
+
+    // Hit test with the spatial index. Nodes outside the view are not
+    // submitted, so the node editor cannot tell about them.
+    _hovered_imnode_idx = -1;
+    const ImVec2 screen_max(screen_min.x + screen_avail.x,
+                            screen_min.y + screen_avail.y);
+    if (ImGui::IsMouseHoveringRect(screen_min, screen_max)) {
+      const ImVec2 mouse_pos = ed::ScreenToCanvas(ImGui::GetMousePos());
+      _hovered_imnode_idx = _imnode_grid.pick(mouse_pos.x, mouse_pos.y);
+    }
+  }
+
   // const float padding = 6.0f;
 
   util::BlueprintNodeBuilder builder(
       ImTextureID(intptr_t(_background_texture_id)),
       /* tex width */ 2, /* tex height */ 2);
 
-  for (size_t i = 0; i < _imnodes.size(); i++) {
-    const ImNode &node = _imnodes[i];
+  _num_drawn_imnodes = 0;
+  _num_drawn_links = 0;
+
+  // Text and pins are not legible when zoomed out. Draw nodes and links in
+  // simplified form so that frame time does not depend on the zoom level.
+  const bool simplified = _canvas_scale < _lod_scale_threshold;
+
+  for (int imnode_idx : _visible_imnodes) {
+    const ImNode &node = _imnodes[size_t(imnode_idx)];
+
+    if (simplified) {
+      DrawSimpleNode(node);
+      _num_drawn_imnodes++;
+      continue;
+    }
 
     builder.Begin(node.id);
     builder.Header(node.color);
@@ -330,6 +472,24 @@ void GUIContext::draw_imnodes() {
       }
     }
 
+    if (node.group_id > -1) {
+      // Summary of the collapsed group.
+      const NodeGroup &group = _hierarchy.groups()[size_t(node.group_id)];
+      builder.Middle();
+      ImGui::Text("%zu nodes", group.num_nodes);
+      ImGui::Text("%s params", FormatCount(group.num_params).c_str());
+      ImGui::Text("%s", FormatBytes(group.num_bytes).c_str());
+    }
+
+    if (node.tensor_id > -1) {
+      ImVec2 thumbnail_size;
+      GLuint texid = get_tensor_thumbnail(node.tensor_id, &thumbnail_size);
+      if (texid) {
+        builder.Middle();
+        ImGui::Image(ImTextureID(intptr_t(texid)), thumbnail_size);
+      }
+    }
+
     if (!node.outputs.empty()) {
       for (const auto &out_pin : node.outputs) {
         // ImGui::Dummy(ImVec2(0, padding));
@@ -366,10 +526,7 @@ void GUIContext::draw_imnodes() {
 
     builder.End();
 
-    // draw link
-    for (auto &link : _links) {
-      ed::Link(link.ID, link.StartPinID, link.EndPinID, link.Color, 2.0f);
-    }
+    _num_drawn_imnodes++;
 
     // ImGui::Spring(1);
     // ImGui::EndHorizontal();
@@ -385,6 +542,55 @@ void GUIContext::draw_imnodes() {
     // ed::EndNode();
   }
 
+  // Submit links after all nodes have been submitted. Each link is submitted
+  // once per frame.
+  // Pins are not submitted in simplified form, so links are drawn as
+  // straight lines between the end nodes instead of ed::Link().
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  // Keep about 1 pixel width on screen.
+  const float line_width = 1.0f / std::max(_canvas_scale, 1.0e-3f);
+
+  for (int link_idx : _visible_links) {
+    const Link &link = _links[size_t(link_idx)];
+
+    if (simplified) {
+      const ImNode &a = _imnodes[size_t(link.start_imnode_idx)];
+      const ImNode &b = _imnodes[size_t(link.end_imnode_idx)];
+      draw_list->AddLine(ImVec2(a.pos.x + a.size.x, a.pos.y + 0.5f * a.size.y),
+                         ImVec2(b.pos.x, b.pos.y + 0.5f * b.size.y),
+                         ImGui::GetColorU32(ImVec4(link.Color)), line_width);
+    } else {
+      ed::Link(link.ID, link.StartPinID, link.EndPinID, link.Color, 2.0f);
+    }
+
+    _num_drawn_links++;
+  }
+
+  if (_hovered_imnode_idx >= 0) {
+    const ImNode &node = _imnodes[size_t(_hovered_imnode_idx)];
+
+    ed::Suspend();
+    ImGui::BeginTooltip();
+    ImGui::TextUnformatted(node.name.c_str());
+    if (node.group_id > -1) {
+      const NodeGroup &group = _hierarchy.groups()[size_t(node.group_id)];
+      ImGui::Text("%s : %zu nodes, %s params(%s)", group.name.c_str(),
+                  group.num_nodes, FormatCount(group.num_params).c_str(),
+                  FormatBytes(group.num_bytes).c_str());
+      ImGui::TextDisabled("Double click to expand");
+    }
+    if (node.tensor_id > -1) {
+      const Tensor &tensor = _graph.tensors[size_t(node.tensor_id)];
+      std::string shape;
+      for (size_t i = 0; i < tensor.shape.size(); i++) {
+        shape += (i > 0 ? " x " : "") + std::to_string(tensor.shape[i]);
+      }
+      ImGui::Text("%s [%s]", get_data_type_name(tensor.dtype), shape.c_str());
+    }
+    ImGui::EndTooltip();
+    ed::Resume();
+  }
+
   // Update _active_tensor_idx if selected node is a tensor node
   {
     std::vector<ed::NodeId> selectedNodes;
@@ -407,8 +613,10 @@ void GUIContext::draw_imnodes() {
 
           // std::cout << "selected tensor idx = " << std::to_string(tensor_idx)
           // << "\n";
-          if (tensor_idx != -1) {
-            _active_tensor_idx = tensor_idx;
+          if ((tensor_idx != -1) && (tensor_idx != _active_tensor_idx)) {
+            if (prepare_tensor(tensor_idx)) {
+              _active_tensor_idx = tensor_idx;
+            }
           }
         }
       }
@@ -421,224 +629,915 @@ void GUIContext::draw_imnodes() {
     }
 #endif
 
+  // Expand/collapse groups from the context menu.
+  ed::Suspend();
+  {
+    ed::NodeId context_node_id;
+    if (ed::ShowNodeContextMenu(&context_node_id)) {
+      auto it = _node_id_to_imnode_idx_map.find(
+          int(intptr_t(context_node_id.AsPointer())));
+      _context_imnode_idx =
+          (it != _node_id_to_imnode_idx_map.end()) ? it->second : -1;
+      ImGui::OpenPopup("Node Context Menu");
+    }
+
+    if (ImGui::BeginPopup("Node Context Menu")) {
+      int group_idx = -1;
+      if (_context_imnode_idx >= 0) {
+        const ImNode &node = _imnodes[size_t(_context_imnode_idx)];
+        if (node.group_id > -1) {
+          if (ImGui::MenuItem("Expand")) {
+            _pending_expand_group = node.group_id;
+          }
+          group_idx = _hierarchy.groups()[size_t(node.group_id)].parent;
+        } else if (node.graph_node_id > -1) {
+          group_idx = _hierarchy.node_group(size_t(node.graph_node_id));
+        } else if (node.tensor_id > -1) {
+          const int owner = _tensor_owners[size_t(node.tensor_id)];
+          group_idx = (owner >= 0) ? _hierarchy.node_group(size_t(owner)) : -1;
+        }
+      }
+
+      if ((group_idx < 0) &&
+          ((_context_imnode_idx < 0) ||
+           (_imnodes[size_t(_context_imnode_idx)].group_id < 0))) {
+        ImGui::TextDisabled("No group");
+      }
+
+      // Innermost group first.
+      for (; group_idx >= 0;
+           group_idx = _hierarchy.groups()[size_t(group_idx)].parent) {
+        const std::string label =
+            "Collapse " + _hierarchy.groups()[size_t(group_idx)].name;
+        if (ImGui::MenuItem(label.c_str())) {
+          _pending_collapse_group = group_idx;
+        }
+      }
+
+      ImGui::EndPopup();
+    }
+
+    if (ed::ShowBackgroundContextMenu()) {
+      ImGui::OpenPopup("Graph Context Menu");
+    }
+
+    if (ImGui::BeginPopup("Graph Context Menu")) {
+      const char *layout_names[kNumGraphLayouts] = {"Layered layout",
+                                                    "Force-directed layout"};
+      for (int i = 0; i < kNumGraphLayouts; i++) {
+        if (ImGui::MenuItem(layout_names[i], /* shortcut */ nullptr,
+                            _graph_layout == GraphLayout(i))) {
+          _graph_layout = GraphLayout(i);
+          _pending_layout = true;
+        }
+      }
+
+      if (_force_layout.running()) {
+        ImGui::Separator();
+        const std::string label =
+            "Stop layout (iteration " +
+            std::to_string(_force_layout.iteration()) + ")";
+        if (ImGui::MenuItem(label.c_str())) {
+          _force_layout.clear();
+        }
+      }
+
+      ImGui::EndPopup();
+    }
+  }
+  ed::Resume();
+
   ed::End();
+
+  {
+    // Expand the collapsed group with double click.
+    const ed::NodeId double_clicked_node_id = ed::GetDoubleClickedNode();
+    if (double_clicked_node_id) {
+      auto it = _node_id_to_imnode_idx_map.find(
+          int(intptr_t(double_clicked_node_id.AsPointer())));
+      if (it != _node_id_to_imnode_idx_map.end()) {
+        const int group_idx = _imnodes[size_t(it->second)].group_id;
+        if (group_idx > -1) {
+          _pending_expand_group = group_idx;
+        }
+      }
+    }
+  }
+
+  // Node position and size are only known to the node editor, and it may
+  // have been changed by the user(e.g. dragging). Fetch them for drawn nodes
+  // so that they are culled correctly in the next frame.
+  bool resized = false;
+  for (int imnode_idx : _visible_imnodes) {
+    const ImNode &node = _imnodes[size_t(imnode_idx)];
+    const ImVec2 pos = ed::GetNodePosition(node.id);
+    const ImVec2 size = ed::GetNodeSize(node.id);
+    // Sub-pixel changes do not matter for culling.
+    if ((std::fabs(size.x - node.size.x) > 0.5f) ||
+        (std::fabs(size.y - node.size.y) > 0.5f)) {
+      resized = true;
+      update_imnode_bounds(size_t(imnode_idx), pos, size);
+    } else if ((std::fabs(pos.x - node.pos.x) > 0.5f) ||
+               (std::fabs(pos.y - node.pos.y) > 0.5f)) {
+      update_imnode_bounds(size_t(imnode_idx), pos, size);
+    }
+  }
+
+  if (_relayout_after_draw) {
+    _relayout_after_draw = false;
+    if (resized) {
+      layout_imnodes();
+    }
+  }
+
+  if (!_placed_imnodes.empty()) {
+    if (resized) {
+      place_imnodes(_placed_imnodes, _placed_anchor);
+    }
+    _placed_imnodes.clear();
+  }
+
+  // Change ImNodes after drawing, since they are referenced while drawing.
+  // Other ImNodes keep their positions(e.g. moved by the user).
+  if ((_pending_expand_group >= 0) || (_pending_collapse_group >= 0)) {
+    expand_group(_pending_expand_group);
+    collapse_group(_pending_collapse_group);
+    _pending_expand_group = -1;
+    _pending_collapse_group = -1;
+  }
+
+  if (_pending_layout) {
+    _pending_layout = false;
+    layout_imnodes();
+    _relayout_after_draw = true;
+  }
+
+  if (_force_layout.running()) {
+    _force_layout.step(_force_layout_budget_ms);
+    apply_force_layout();
+  }
+
   ImGui::End();
 }
 
+bool GUIContext::prepare_tensor(int tensor_idx) {
+  NNVIEW_TRACE_SCOPE("prepare_tensor");
+
+  if ((tensor_idx < 0) || (size_t(tensor_idx) >= _graph.tensors.size())) {
+    return false;
+  }
+
+  Tensor &tensor = _graph.tensors[size_t(tensor_idx)];
+
+  if (!tensor.is_loaded()) {
+    if (!load_tensor_data(&tensor, _use_mmap)) {
+      NNVIEW_LOG_ERROR(GUI) << "Failed to load tensor : " << tensor.name;
+      return false;
+    }
+  }
+
+  if (_tensor_views.size() < _graph.tensors.size()) {
+    _tensor_views.resize(_graph.tensors.size());
+    _tensor_stats.resize(_graph.tensors.size());
+  }
+
+  TensorView &view = _tensor_views[size_t(tensor_idx)];
+  if (!view.prepared) {
+    NNVIEW_TRACE_SCOPE("build_tensor_pyramid");
+
+    _tensor_stats[size_t(tensor_idx)] =
+        compute_tensor_stats(tensor, _num_threads);
+    view.range_min = _tensor_stats[size_t(tensor_idx)].min_value;
+    view.range_max = _tensor_stats[size_t(tensor_idx)].max_value;
+
+    // Stays empty when the tensor cannot be displayed as an image. The
+    // statistics are shown anyway.
+    view.pyramid.build(&tensor, view.downsample_mode, _num_threads);
+    view.prepared = true;
+  }
+
+  return true;
+}
+
+void GUIContext::set_colormap(Colormap cmap) {
+  // Tiles are updated when they are drawn next time.
+  _colormap = cmap;
+}
+
 void GUIContext::init() {
   if (_editor_context != nullptr) {
     // ???
-    std::cerr << "EditorContext is already initialized or filled with invalid "
-                 "value.\n";
+    NNVIEW_LOG_ERROR(GUI) << "EditorContext is already initialized or filled "
+                             "with invalid value.";
     exit(-1);
   }
 
   _editor_context = ed::CreateEditor();
 
-  std::cout << "num tensors" << _graph.tensors.size() << "\n";
+  {
+    std::string err;
+    if (!_colormap_renderer.init(&err)) {
+      // `err` ends with a newline.
+      NNVIEW_LOG_WARN(GL) << err
+                          << "GPU colormapping is not available. Use CPU "
+                             "instead.";
+    }
+  }
+
+  NNVIEW_LOG_DEBUG(GUI) << "num tensors " << _graph.tensors.size();
+  _tensor_views.assign(_graph.tensors.size(), TensorView());
+  _tensor_stats.assign(_graph.tensors.size(), TensorStats());
   for (size_t i = 0; i < _graph.tensors.size(); i++) {
-    std::cout << "shape size " << _graph.tensors[i].shape.size() << "\n";
+    NNVIEW_LOG_DEBUG(GUI) << "shape size " << _graph.tensors[i].shape.size();
+
+    // Lazily loaded tensor is prepared when selected.
+    if (!_graph.tensors[i].is_loaded()) {
+      continue;
+    }
 
     // std::cout << "tensor "  << _graph.tensors[i].shape[0] << ", " <<
     // _graph.tensors[i].shape[1] << std::endl;
-    GLuint texid = gen_gl_texture(_graph.tensors[i]);
-
-    _tensor_texture_ids.push_back(texid);
+    prepare_tensor(int(i));
   }
 
   // Create whilte BG texture.
   _background_texture_id = create_gray_texture();
 }
 
-void GUIContext::init_imnode_graph() {
-  ed::SetCurrentEditor(_editor_context);
+static std::pair<uintptr_t, uintptr_t> GetLinkPinPair(const Link &link) {
+  return std::make_pair(uintptr_t(link.StartPinID.AsPointer()),
+                        uintptr_t(link.EndPinID.AsPointer()));
+}
 
-  const float node_size = 128.0f;
-  const float node_padding = 160.0f;
-  const float layer_stride = 2 * node_size + node_padding;
-  const float node_rect_slot_size_y = 32.0f;
-  const float tensor_x_offset = node_size + 64.0f;
+// Pin of `imnode` to connect a link. `slot` is the slot index of the graph
+// node. Tensor and group ImNode has a single input and output pin, which is
+// created when it is linked for the first time.
+static ed::PinId GetLinkPin(ImNode *imnode, bool output, size_t slot) {
+  std::vector<Pin> &pins = output ? imnode->outputs : imnode->inputs;
+  if (imnode->graph_node_id >= 0) {
+    return pins[slot].ID;
+  }
 
-  _imnodes.clear();
-  _links.clear();
+  if (pins.empty()) {
+    pins.emplace_back(uint32_t(GetNextId()), /* empty name */ "",
+                      PinType::Flow);
+  }
 
-  std::map<int, int> tensor_id_imnode_map;  // <id, imnode index>
+  return pins[0].ID;
+}
 
-  // Create node for layers
-  for (size_t i = 0; i < _graph.nodes.size(); i++) {
-    const nnview::Node &node = _graph.nodes[i];
-    std::cout << "=== node[" << std::to_string(i) << "] " << node.name << "\n";
-    std::cout << "  inputs = " << std::to_string(node.inputs.size()) << "\n";
-    std::cout << "  outputs = " << std::to_string(node.outputs.size()) << "\n";
+int GUIContext::add_imnode(const ImNode &imnode) {
+  int imnode_idx;
+  if (!_free_imnodes.empty()) {
+    imnode_idx = _free_imnodes.back();
+    _free_imnodes.pop_back();
+    _imnodes[size_t(imnode_idx)] = imnode;
+    _imnode_links[size_t(imnode_idx)].clear();
+  } else {
+    imnode_idx = int(_imnodes.size());
+    _imnodes.push_back(imnode);
+    _imnode_links.emplace_back();
+  }
 
-    {
-      ed::NodeId node_id = GetNextNodeId();
-      ImNode imnode(node_id, node.name);
-      const float node_rect_height =
-          float(node.outputs.size()) * node_rect_slot_size_y;
-      imnode.size = ImVec2(node_size, node_rect_height);
+  _node_id_to_imnode_idx_map[int(intptr_t(imnode.id.AsPointer()))] =
+      imnode_idx;
+  _new_imnodes.push_back(imnode_idx);
 
-      // Create pin id
-      for (size_t p = 0; p < node.inputs.size(); p++) {
-        const Slot &slot = node.inputs[p];
-        std::string name = slot.slot_name;
+  update_imnode_bounds(size_t(imnode_idx), imnode.pos, imnode.size);
 
-        Pin pin(uint32_t(GetNextId()), name, PinType::Flow);
+  return imnode_idx;
+}
 
-        imnode.inputs.emplace_back(pin);
-      }
+int GUIContext::add_link(const Link &link) {
+  int link_idx;
+  if (!_free_links.empty()) {
+    link_idx = _free_links.back();
+    _free_links.pop_back();
+    _links[size_t(link_idx)] = link;
+  } else {
+    link_idx = int(_links.size());
+    _links.push_back(link);
+  }
 
-      for (size_t p = 0; p < node.outputs.size(); p++) {
-        const Slot &slot = node.outputs[p];
-        std::string name = slot.slot_name;
+  _imnode_links[size_t(link.start_imnode_idx)].push_back(link_idx);
+  _imnode_links[size_t(link.end_imnode_idx)].push_back(link_idx);
+  _link_pins.insert(GetLinkPinPair(link));
 
-        Pin pin(uint32_t(GetNextId()), name, PinType::Flow);
+  update_link_bounds(size_t(link_idx));
 
-        imnode.outputs.emplace_back(pin);
-      }
+  return link_idx;
+}
+
+void GUIContext::remove_imnode(int imnode_idx) {
+  if ((imnode_idx < 0) || _imnodes[size_t(imnode_idx)].removed) {
+    return;
+  }
+
+  ImNode &imnode = _imnodes[size_t(imnode_idx)];
+  imnode.removed = true;
+  _free_imnodes.push_back(imnode_idx);
 
-      float offset_x = layer_stride * float(node.depth);
-      std::cout << "depth = " << node.depth << "\n";
-      std::cout << "id = " << uintptr_t(imnode.id) << "\n";
-      ed::SetNodePosition(imnode.id, ImVec2(offset_x, 64.0f));
+  _imnode_grid.remove(imnode_idx);
+  _node_id_to_imnode_idx_map.erase(int(intptr_t(imnode.id.AsPointer())));
 
-      _imnodes.emplace_back(imnode);
+  for (int link_idx : _imnode_links[size_t(imnode_idx)]) {
+    Link &link = _links[size_t(link_idx)];
+    if (link.removed) {
+      continue;
     }
 
-    // Use index since `_imnodes` will be resized later(pointer or reference
-    // value differs due to std::vector resizing)
-    const size_t imnode_idx = _imnodes.size() - 1;
+    link.removed = true;
+    _free_links.push_back(link_idx);
+    _link_grid.remove(link_idx);
+    _link_pins.erase(GetLinkPinPair(link));
+
+    // Unregister from the ImNode at the other end.
+    const int other = (link.start_imnode_idx == imnode_idx)
+                          ? link.end_imnode_idx
+                          : link.start_imnode_idx;
+    std::vector<int> &other_links = _imnode_links[size_t(other)];
+    other_links.erase(
+        std::remove(other_links.begin(), other_links.end(), link_idx),
+        other_links.end());
+  }
+  _imnode_links[size_t(imnode_idx)].clear();
 
-    assert(_imnodes[imnode_idx].inputs.size() == node.inputs.size());
-    assert(_imnodes[imnode_idx].outputs.size() == node.outputs.size());
+  if (_hovered_imnode_idx == imnode_idx) {
+    _hovered_imnode_idx = -1;
+  }
+  if (_context_imnode_idx == imnode_idx) {
+    _context_imnode_idx = -1;
+  }
+}
 
-    // Create node for tensor connected to this node
-    for (size_t t = 0; t < node.inputs.size(); t++) {
-      const Slot &slot = node.inputs[t];
-      std::cout << "Node " << node.name << ".inputs[" << std::to_string(t)
-                << "] tensor id = " << slot.id << "\n";
+void GUIContext::materialize_graph_node(size_t node_idx) {
+  const nnview::Node &node = _graph.nodes[node_idx];
 
-      assert(slot.id >= 0);
-      assert(slot.id < int(_graph.tensors.size()));
+  {
+    ImNode imnode(GetNextNodeId(), node.name);
+    imnode.graph_node_id = int(node_idx);
+    // Header and a row per slot. Replaced by the actual size once drawn.
+    imnode.size = ImVec2(
+        kNodeSize,
+        float(std::max(node.inputs.size(), node.outputs.size()) + 1) *
+            kNodeRectSlotSizeY);
+
+    // Create pin id
+    for (size_t p = 0; p < node.inputs.size(); p++) {
+      imnode.inputs.emplace_back(uint32_t(GetNextId()),
+                                 node.inputs[p].slot_name, PinType::Flow);
+    }
 
-      if (tensor_id_imnode_map.find(slot.id) != tensor_id_imnode_map.end()) {
-        ImNode &tensor_imnode = _imnodes[size_t(tensor_id_imnode_map[slot.id])];
+    for (size_t p = 0; p < node.outputs.size(); p++) {
+      imnode.outputs.emplace_back(uint32_t(GetNextId()),
+                                  node.outputs[p].slot_name, PinType::Flow);
+    }
 
-        std::cout << "outputs.size = " << tensor_imnode.outputs.size() << "\n";
+    _graph_node_imnodes[node_idx] = add_imnode(imnode);
+  }
 
-        if (tensor_imnode.outputs.size() == 0) {
-          // Create output pin
-          Pin out_pin(uint32_t(GetNextId()), /* empty name */ "",
-                      PinType::Flow);
-          tensor_imnode.outputs.push_back(out_pin);
-        }
+  // Create node for tensors owned by this node.
+  for (size_t t = 0; t < node.inputs.size(); t++) {
+    const Slot &slot = node.inputs[t];
 
-        Link link(GetNextLinkId(), tensor_imnode.outputs[0].ID,
-                  _imnodes[imnode_idx].inputs[t].ID);
+    assert(slot.id >= 0);
+    assert(slot.id < int(_graph.tensors.size()));
 
-        _links.emplace_back(link);
+    if ((_tensor_owners[size_t(slot.id)] != int(node_idx)) ||
+        (_tensor_imnodes[size_t(slot.id)] != -1)) {
+      continue;
+    }
 
-        continue;
+    const nnview::Tensor &tensor = _graph.tensors[size_t(slot.id)];
+
+    ImNode tensor_imnode(GetNextNodeId(), tensor.name);
+    tensor_imnode.tensor_id = slot.id;
+    tensor_imnode.color = ImColor(32, 255, 32);
+    tensor_imnode.size = ImVec2(kNodeSize, kNodeSize);
+
+    _tensor_imnodes[size_t(slot.id)] = add_imnode(tensor_imnode);
+  }
+
+  for (size_t t = 0; t < node.outputs.size(); t++) {
+    const Slot &slot = node.outputs[t];
+
+    assert(slot.id >= 0);
+    assert(slot.id < int(_graph.tensors.size()));
+
+    if ((_tensor_owners[size_t(slot.id)] != int(node_idx)) ||
+        (_tensor_imnodes[size_t(slot.id)] != -1)) {
+      continue;
+    }
+
+    const nnview::Tensor &tensor = _graph.tensors[size_t(slot.id)];
+
+    ImNode tensor_imnode(GetNextNodeId(), tensor.name);
+    tensor_imnode.tensor_id = slot.id;
+    tensor_imnode.color = ImColor(32, 32, 255);
+    tensor_imnode.size = ImVec2(kNodeSize, kNodeSize);
+
+    _tensor_imnodes[size_t(slot.id)] = add_imnode(tensor_imnode);
+  }
+}
+
+void GUIContext::dematerialize_graph_node(size_t node_idx) {
+  remove_imnode(_graph_node_imnodes[node_idx]);
+  _graph_node_imnodes[node_idx] = -1;
+
+  const nnview::Node &node = _graph.nodes[node_idx];
+  for (const auto *slots : {&node.inputs, &node.outputs}) {
+    for (const Slot &slot : *slots) {
+      if (_tensor_owners[size_t(slot.id)] == int(node_idx)) {
+        remove_imnode(_tensor_imnodes[size_t(slot.id)]);
+        _tensor_imnodes[size_t(slot.id)] = -1;
       }
+    }
+  }
+}
 
-      const nnview::Tensor &tensor = _graph.tensors[size_t(slot.id)];
+void GUIContext::materialize_group(size_t group_idx) {
+  const NodeGroup &group = _hierarchy.groups()[group_idx];
 
-      ed::NodeId imnode_id = GetNextNodeId();
-      ImNode tensor_imnode(imnode_id, tensor.name);
-      tensor_imnode.tensor_id = slot.id;
+  ImNode imnode(GetNextNodeId(), group.label, ImColor(255, 160, 32));
+  imnode.group_id = int(group_idx);
+  imnode.size = ImVec2(kNodeSize, 96.0f);
 
-      const float node_rect_width = float(tensor.shape[1]);
-      const float node_rect_height = float(tensor.shape[0]);
+  _group_imnodes[group_idx] = add_imnode(imnode);
+}
 
-      tensor_imnode.color = ImColor(32, 255, 32);
-      tensor_imnode.size = ImVec2(node_rect_width, node_rect_height);
+int GUIContext::find_graph_node_imnode(size_t node_idx) const {
+  if (_graph_node_imnodes[node_idx] != -1) {
+    return _graph_node_imnodes[node_idx];
+  }
 
-      Pin out_pin(uint32_t(GetNextId()), /* empty name */ "", PinType::Flow);
+  // At most one group in the ancestors is materialized.
+  for (int g = _hierarchy.node_group(node_idx); g >= 0;
+       g = _hierarchy.groups()[size_t(g)].parent) {
+    if (_group_imnodes[size_t(g)] != -1) {
+      return _group_imnodes[size_t(g)];
+    }
+  }
 
-      tensor_imnode.outputs.emplace_back(out_pin);
+  return -1;
+}
 
-      // FIXME(LTE): Use the depth of previous op
-      float offset_x = layer_stride * float(node.depth - 2) + tensor_x_offset;
-      float offset_y = 128.0f * float(t);
-      ed::SetNodePosition(tensor_imnode.id, ImVec2(offset_x, 64.0f + offset_y));
+int GUIContext::find_tensor_imnode(size_t tensor_idx) const {
+  if (_tensor_imnodes[tensor_idx] != -1) {
+    return _tensor_imnodes[tensor_idx];
+  }
+
+  const int owner = _tensor_owners[tensor_idx];
+  if (owner < 0) {
+    return -1;
+  }
 
-      tensor_id_imnode_map[slot.id] = int(_imnodes.size());
+  // Hidden in the collapsed group of its owner.
+  return find_graph_node_imnode(size_t(owner));
+}
 
-      Link link(GetNextLinkId(), out_pin.ID, _imnodes[imnode_idx].inputs[t].ID);
+void GUIContext::link_tensor(size_t tensor_idx, size_t node_idx, size_t slot,
+                             bool consumer) {
+  const int tensor_imnode_idx = find_tensor_imnode(tensor_idx);
+  const int node_imnode_idx = find_graph_node_imnode(node_idx);
 
-      std::cout << "link (" << intptr_t(&out_pin.ID) << ") -> ("
-                << intptr_t(&_imnodes[imnode_idx].inputs[t].ID) << std::endl;
-      _links.push_back(link);
+  if ((tensor_imnode_idx < 0) || (node_imnode_idx < 0) ||
+      (tensor_imnode_idx == node_imnode_idx)) {
+    // Not visible, or inside of a collapsed group.
+    return;
+  }
 
-      _node_id_to_imnode_idx_map[int(intptr_t(imnode_id.AsPointer()))] =
-          int(_imnodes.size());
+  const int start = consumer ? tensor_imnode_idx : node_imnode_idx;
+  const int end = consumer ? node_imnode_idx : tensor_imnode_idx;
 
-      _imnodes.push_back(tensor_imnode);
+  Link link(GetNextLinkId(),
+            GetLinkPin(&_imnodes[size_t(start)], /* output */ true, slot),
+            GetLinkPin(&_imnodes[size_t(end)], /* output */ false, slot));
+  link.start_imnode_idx = start;
+  link.end_imnode_idx = end;
+
+  if (_link_pins.count(GetLinkPinPair(link))) {
+    // Already linked.
+    return;
+  }
+
+  add_link(link);
+}
+
+void GUIContext::connect_graph_nodes(const std::vector<int> &nodes) {
+  for (int node_idx : nodes) {
+    const nnview::Node &node = _graph.nodes[size_t(node_idx)];
+
+    for (size_t t = 0; t < node.inputs.size(); t++) {
+      link_tensor(size_t(node.inputs[t].id), size_t(node_idx), t,
+                  /* consumer */ true);
     }
 
     for (size_t t = 0; t < node.outputs.size(); t++) {
-      const Slot &slot = node.outputs[t];
-      std::cout << "output[" << t << "] tensor id = " << slot.id << "\n";
+      link_tensor(size_t(node.outputs[t].id), size_t(node_idx), t,
+                  /* consumer */ false);
+    }
+
+    // Other consumers of tensors owned by this node.
+    for (const auto *slots : {&node.inputs, &node.outputs}) {
+      for (const Slot &slot : *slots) {
+        if (_tensor_owners[size_t(slot.id)] != node_idx) {
+          continue;
+        }
+
+        for (const CsrSlotRef &consumer :
+             _csr_graph.consumers(size_t(slot.id))) {
+          link_tensor(size_t(slot.id), size_t(consumer.node),
+                      size_t(consumer.slot), /* consumer */ true);
+        }
+      }
+    }
+  }
+}
 
-      assert(slot.id >= 0);
-      assert(slot.id < int(_graph.tensors.size()));
+void GUIContext::expand_group(int group_idx) {
+  if ((group_idx < 0) || _group_expanded[size_t(group_idx)]) {
+    return;
+  }
 
-      if (tensor_id_imnode_map.find(slot.id) != tensor_id_imnode_map.end()) {
-        size_t tensor_imnode_idx = size_t(tensor_id_imnode_map[slot.id]);
-        ImNode &tensor_imnode = _imnodes[tensor_imnode_idx];
+  const NodeGroup &group = _hierarchy.groups()[size_t(group_idx)];
+  NNVIEW_LOG_DEBUG(GUI) << "Expand group " << group.name;
 
-        if (tensor_imnode.outputs.size() == 0) {
-          // ImNode for Tensor is already registered but no input pin registered
-          Pin in_pin(uint32_t(GetNextId()), /* empty name */ "", PinType::Flow);
+  // The force-directed layout in progress refers to the removed ImNodes.
+  _force_layout.clear();
+  _force_layout_imnodes.clear();
 
-          tensor_imnode.inputs.emplace_back(in_pin);
+  // Children are placed where the collapsed group was.
+  const int group_imnode_idx = _group_imnodes[size_t(group_idx)];
+  const ImVec2 anchor = (group_imnode_idx >= 0)
+                            ? _imnodes[size_t(group_imnode_idx)].pos
+                            : ImVec2(0.0f, 0.0f);
+
+  _group_expanded[size_t(group_idx)] = 1;
+  remove_imnode(group_imnode_idx);
+  _group_imnodes[size_t(group_idx)] = -1;
+
+  _new_imnodes.clear();
+
+  // Child groups are collapsed.
+  for (int child : group.children) {
+    materialize_group(size_t(child));
+  }
+
+  for (int node_idx : group.nodes) {
+    materialize_graph_node(size_t(node_idx));
+  }
+
+  std::vector<int> nodes;
+  _hierarchy.collect_nodes(group_idx, &nodes);
+  connect_graph_nodes(nodes);
+
+  place_imnodes(_new_imnodes, anchor);
+  _placed_imnodes.swap(_new_imnodes);
+  _placed_anchor = anchor;
+  _new_imnodes.clear();
+}
+
+void GUIContext::collapse_group(int group_idx) {
+  if ((group_idx < 0) || !_group_expanded[size_t(group_idx)]) {
+    return;
+  }
+
+  NNVIEW_LOG_DEBUG(GUI) << "Collapse group "
+                        << _hierarchy.groups()[size_t(group_idx)].name;
+
+  // The force-directed layout in progress refers to the removed ImNodes.
+  _force_layout.clear();
+  _force_layout_imnodes.clear();
+
+  // The group is placed at the upper left corner of the ImNodes it replaces.
+  ImVec2 anchor(std::numeric_limits<float>::max(),
+                std::numeric_limits<float>::max());
+  bool has_anchor = false;
+  const auto extend_anchor = [this, &anchor, &has_anchor](int imnode_idx) {
+    if (imnode_idx >= 0) {
+      const ImVec2 &pos = _imnodes[size_t(imnode_idx)].pos;
+      anchor.x = std::min(anchor.x, pos.x);
+      anchor.y = std::min(anchor.y, pos.y);
+      has_anchor = true;
+    }
+  };
+
+  std::vector<int> nodes;
+  _hierarchy.collect_nodes(group_idx, &nodes);
+
+  for (int node_idx : nodes) {
+    extend_anchor(_graph_node_imnodes[size_t(node_idx)]);
+    const nnview::Node &node = _graph.nodes[size_t(node_idx)];
+    for (const auto *slots : {&node.inputs, &node.outputs}) {
+      for (const Slot &slot : *slots) {
+        if (_tensor_owners[size_t(slot.id)] == node_idx) {
+          extend_anchor(_tensor_imnodes[size_t(slot.id)]);
         }
+      }
+    }
+
+    dematerialize_graph_node(size_t(node_idx));
+  }
+
+  // Descendant groups are collapsed as well.
+  for (size_t g = 0; g < _hierarchy.groups().size(); g++) {
+    if ((int(g) != group_idx) && _hierarchy.is_descendant(int(g), group_idx)) {
+      extend_anchor(_group_imnodes[g]);
+      remove_imnode(_group_imnodes[g]);
+      _group_imnodes[g] = -1;
+      _group_expanded[g] = 0;
+    }
+  }
+
+  if (!has_anchor) {
+    anchor = ImVec2(0.0f, 0.0f);
+  }
+
+  _new_imnodes.clear();
+
+  _group_expanded[size_t(group_idx)] = 0;
+  materialize_group(size_t(group_idx));
+
+  connect_graph_nodes(nodes);
+
+  place_imnodes(_new_imnodes, anchor);
+  _placed_imnodes.swap(_new_imnodes);
+  _placed_anchor = anchor;
+  _new_imnodes.clear();
+}
+
+void GUIContext::init_imnode_graph() {
+  NNVIEW_TRACE_SCOPE("init_imnode_graph");
+
+  ed::SetCurrentEditor(_editor_context);
+
+  _imnodes.clear();
+  _links.clear();
+  _free_imnodes.clear();
+  _free_links.clear();
+  _new_imnodes.clear();
+  _placed_imnodes.clear();
+  _link_pins.clear();
+  _node_id_to_imnode_idx_map.clear();
+  reset_spatial_index();
+
+  _hierarchy.build(_graph);
+  NNVIEW_LOG_INFO(GUI) << "# of groups = " << _hierarchy.groups().size();
+
+  _group_expanded.assign(_hierarchy.groups().size(), 0);
+  _graph_node_imnodes.assign(_graph.nodes.size(), -1);
+  _tensor_imnodes.assign(_graph.tensors.size(), -1);
+  _group_imnodes.assign(_hierarchy.groups().size(), -1);
+
+  assert(_csr_graph.num_nodes() == _graph.nodes.size());
+  assert(_csr_graph.num_tensors() == _graph.tensors.size());
+
+  // Producer owns the tensor. Otherwise the first consumer.
+  _tensor_owners.assign(_graph.tensors.size(), -1);
+  for (size_t t = 0; t < _csr_graph.num_tensors(); t++) {
+    const auto producers = _csr_graph.producers(t);
+    const auto consumers = _csr_graph.consumers(t);
+    if (!producers.empty()) {
+      _tensor_owners[t] = producers[producers.size() - 1].node;
+    } else if (!consumers.empty()) {
+      _tensor_owners[t] = consumers[0].node;
+    }
+  }
+
+  // Top level groups are collapsed.
+  for (int group_idx : _hierarchy.root_groups()) {
+    materialize_group(size_t(group_idx));
+  }
+
+  for (int node_idx : _hierarchy.root_nodes()) {
+    NNVIEW_LOG_DEBUG(GUI) << "=== node[" << node_idx << "] "
+                          << _graph.nodes[size_t(node_idx)].name;
+    materialize_graph_node(size_t(node_idx));
+  }
+
+  std::vector<int> nodes(_graph.nodes.size());
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i] = int(i);
+  }
+  connect_graph_nodes(nodes);
+  _new_imnodes.clear();
 
+  layout_imnodes();
+  _relayout_after_draw = true;
+
+  ed::NavigateToContent();
+}
+
+void GUIContext::layout_imnodes() {
+  NNVIEW_TRACE_SCOPE("layout_imnodes");
+
+  // All ImNodes are placed.
+  _placed_imnodes.clear();
+
+  LayoutGraph graph;
+
+  std::vector<int> imnode_indices;
+  std::vector<int> imnode_to_layout(_imnodes.size(), -1);
+  for (size_t i = 0; i < _imnodes.size(); i++) {
+    if (_imnodes[i].removed) {
+      continue;
+    }
+    imnode_to_layout[i] =
+        graph.add_node(_imnodes[i].size.x, _imnodes[i].size.y);
+    imnode_indices.push_back(int(i));
+  }
+
+  for (const Link &link : _links) {
+    if (link.removed) {
+      continue;
+    }
+    graph.add_edge(imnode_to_layout[size_t(link.start_imnode_idx)],
+                   imnode_to_layout[size_t(link.end_imnode_idx)]);
+  }
+
+  _layout_option.num_threads = _num_threads;
+
+  std::vector<float> xs, ys;
+  layered_layout(graph, _layout_option, &xs, &ys);
+
+  for (size_t k = 0; k < imnode_indices.size(); k++) {
+    const size_t imnode_idx = size_t(imnode_indices[k]);
+    const ImVec2 pos(xs[k], ys[k]);
+    ed::SetNodePosition(_imnodes[imnode_idx].id, pos);
+    update_imnode_bounds(imnode_idx, pos, _imnodes[imnode_idx].size);
+  }
+
+  if (_graph_layout != GRAPH_LAYOUT_FORCE) {
+    _force_layout.clear();
+    _force_layout_imnodes.clear();
+    return;
+  }
+
+  // Refine from the layered layout over the following frames.
+  for (size_t k = 0; k < imnode_indices.size(); k++) {
+    const ImVec2 &size = _imnodes[size_t(imnode_indices[k])].size;
+    xs[k] += 0.5f * size.x;
+    ys[k] += 0.5f * size.y;
+  }
+
+  _force_layout_option.num_threads = _num_threads;
+  _force_layout.reset(graph, xs, ys, _force_layout_option);
+  _force_layout_imnodes.swap(imnode_indices);
+  _force_layout_applied_iteration = 0;
+}
+
+void GUIContext::place_imnodes(const std::vector<int> &imnodes,
+                               const ImVec2 &anchor) {
+  NNVIEW_TRACE_SCOPE("place_imnodes");
+
+  LayoutGraph graph;
+
+  std::vector<int> imnode_indices;
+  std::unordered_map<int, int> imnode_to_layout;
+  for (int imnode_idx : imnodes) {
+    const ImNode &imnode = _imnodes[size_t(imnode_idx)];
+    if (imnode.removed) {
+      continue;
+    }
+    imnode_to_layout[imnode_idx] =
+        graph.add_node(imnode.size.x, imnode.size.y);
+    imnode_indices.push_back(imnode_idx);
+  }
+
+  if (imnode_indices.empty()) {
+    return;
+  }
+
+  // Only links between the placed ImNodes. Each link is visited from its
+  // start ImNode.
+  for (int imnode_idx : imnode_indices) {
+    for (int link_idx : _imnode_links[size_t(imnode_idx)]) {
+      const Link &link = _links[size_t(link_idx)];
+      if (link.start_imnode_idx != imnode_idx) {
         continue;
       }
+      auto it = imnode_to_layout.find(link.end_imnode_idx);
+      if (it != imnode_to_layout.end()) {
+        graph.add_edge(imnode_to_layout[imnode_idx], it->second);
+      }
+    }
+  }
+
+  _layout_option.num_threads = _num_threads;
 
-      const nnview::Tensor &tensor = _graph.tensors[size_t(slot.id)];
+  std::vector<float> xs, ys;
+  layered_layout(graph, _layout_option, &xs, &ys);
 
-      ed::NodeId imnode_id = GetNextNodeId();
-      ImNode tensor_imnode(imnode_id, tensor.name);
-      tensor_imnode.tensor_id = slot.id;
+  const float min_x = *std::min_element(xs.begin(), xs.end());
+  const float min_y = *std::min_element(ys.begin(), ys.end());
 
-      const float node_rect_width = float(tensor.shape[1]);
-      const float node_rect_height = float(tensor.shape[0]);
+  for (size_t k = 0; k < imnode_indices.size(); k++) {
+    const size_t imnode_idx = size_t(imnode_indices[k]);
+    const ImVec2 pos(anchor.x + xs[k] - min_x, anchor.y + ys[k] - min_y);
+    ed::SetNodePosition(_imnodes[imnode_idx].id, pos);
+    update_imnode_bounds(imnode_idx, pos, _imnodes[imnode_idx].size);
+  }
 
-      tensor_imnode.color = ImColor(32, 32, 255);
-      tensor_imnode.size = ImVec2(node_rect_width, node_rect_height);
+  resolve_overlaps(imnode_indices);
+}
 
-      Pin in_pin(uint32_t(GetNextId()), /* empty name */ "", PinType::Flow);
-      // Pin out_pin(uint32_t(GetNextId()), /* empty name */ "", PinType::Flow);
+void GUIContext::resolve_overlaps(const std::vector<int> &imnodes) {
+  const float spacing = _layout_option.node_spacing;
 
-      tensor_imnode.inputs.emplace_back(in_pin);
-      // tensor_imnode.outputs.emplace_back(out_pin);
+  // `imnodes` are not moved. Other ImNodes are pushed away from the ImNodes
+  // in `stack`.
+  std::vector<uint8_t> fixed(_imnodes.size(), 0);
+  for (int imnode_idx : imnodes) {
+    fixed[size_t(imnode_idx)] = 1;
+  }
 
-      Link link(GetNextLinkId(), _imnodes[imnode_idx].outputs[t].ID, in_pin.ID);
+  // Move `mover_idx` right or down, whichever is shorter, past `obstacle`.
+  const auto move_past = [this, spacing](int mover_idx,
+                                         const ImNode &obstacle) {
+    const ImNode &mover = _imnodes[size_t(mover_idx)];
+    const float dx = obstacle.pos.x + obstacle.size.x + spacing - mover.pos.x;
+    const float dy = obstacle.pos.y + obstacle.size.y + spacing - mover.pos.y;
+    const ImVec2 pos = (dx <= dy) ? ImVec2(mover.pos.x + dx, mover.pos.y)
+                                  : ImVec2(mover.pos.x, mover.pos.y + dy);
+    ed::SetNodePosition(mover.id, pos);
+    update_imnode_bounds(size_t(mover_idx), pos, mover.size);
+  };
+
+  std::vector<int> stack(imnodes);
+  std::vector<int> hits;
+
+  // Each move pushes an ImNode right or down, so this terminates. Bound the
+  // work for pathological inputs anyway.
+  size_t num_moves = 0;
+  const size_t max_moves = 16 * _imnodes.size();
+
+  while (!stack.empty() && (num_moves < max_moves)) {
+    const int idx = stack.back();
+    stack.pop_back();
+
+    const ImNode &node = _imnodes[size_t(idx)];
+    if (node.removed) {
+      continue;
+    }
 
-      std::cout << "link " << node.name << " ("
-                << intptr_t(&_imnodes[imnode_idx].outputs[t].ID) << ") -> ("
-                << intptr_t(&in_pin.ID) << std::endl;
-      _links.push_back(link);
+    hits.clear();
+    _imnode_grid.query(node.pos.x, node.pos.y, node.pos.x + node.size.x,
+                       node.pos.y + node.size.y, &hits);
 
-      float offset_x = layer_stride * float(node.depth) + tensor_x_offset;
-      float offset_y = 128.0f * float(t);
-      ed::SetNodePosition(tensor_imnode.id, ImVec2(offset_x, 64.0f + offset_y));
+    for (int other_idx : hits) {
+      if (other_idx == idx) {
+        continue;
+      }
 
-      tensor_id_imnode_map[slot.id] = int(_imnodes.size());
+      const ImNode &other = _imnodes[size_t(other_idx)];
+      if (!((other.pos.x < node.pos.x + node.size.x) &&
+            (node.pos.x < other.pos.x + other.size.x) &&
+            (other.pos.y < node.pos.y + node.size.y) &&
+            (node.pos.y < other.pos.y + other.size.y))) {
+        // Only touching.
+        continue;
+      }
 
-      _node_id_to_imnode_idx_map[int(intptr_t(imnode_id.AsPointer()))] =
-          int(_imnodes.size());
+      if (fixed[size_t(other_idx)]) {
+        if (fixed[size_t(idx)]) {
+          continue;
+        }
+        // Pushed onto a placed ImNode. Move it again past the placed one.
+        move_past(idx, other);
+        stack.push_back(idx);
+        num_moves++;
+        break;
+      }
 
-      _imnodes.push_back(tensor_imnode);
+      move_past(other_idx, node);
+      stack.push_back(other_idx);
+      num_moves++;
     }
   }
+}
 
-  ed::NavigateToContent();
+void GUIContext::apply_force_layout() {
+  if (_force_layout.iteration() == _force_layout_applied_iteration) {
+    return;
+  }
+  _force_layout_applied_iteration = _force_layout.iteration();
+
+  for (size_t k = 0; k < _force_layout_imnodes.size(); k++) {
+    const size_t imnode_idx = size_t(_force_layout_imnodes[k]);
+    if (_imnodes[imnode_idx].removed) {
+      continue;
+    }
+    const ImVec2 &size = _imnodes[imnode_idx].size;
+    const ImVec2 pos(_force_layout.xs()[k] - 0.5f * size.x,
+                     _force_layout.ys()[k] - 0.5f * size.y);
+    ed::SetNodePosition(_imnodes[imnode_idx].id, pos);
+    update_imnode_bounds(imnode_idx, pos, size);
+  }
 }
 
 void GUIContext::draw_tensor() {
+  NNVIEW_TRACE_SCOPE("draw_tensor");
+
   static float scale = 4.0f;  // Set 4x for better initial visual
 
   ImGui::Begin("Tensor", /* p_open */ nullptr,
@@ -649,9 +1548,83 @@ void GUIContext::draw_tensor() {
                            ? _graph.tensors[size_t(_active_tensor_idx)].name
                            : "no selection";
     ImGui::Text("Tensor : %s", name.c_str());
+    if (_active_tensor_idx > -1) {
+      const Tensor &tensor = _graph.tensors[size_t(_active_tensor_idx)];
+      ImGui::Text("Type : %s", get_data_type_name(tensor.dtype));
+
+      std::string shape;
+      for (size_t i = 0; i < tensor.shape.size(); i++) {
+        shape += (i > 0 ? " x " : "") + std::to_string(tensor.shape[i]);
+      }
+      int image_width = 0;
+      int image_height = 0;
+      if (!get_tensor_image_size(tensor, &image_width, &image_height)) {
+        ImGui::Text("Shape : [%s] (no image)", shape.c_str());
+      } else if (tensor.shape.size() != 2) {
+        ImGui::Text("Shape : [%s] (shown as %d x %d)", shape.c_str(),
+                    image_height, image_width);
+      } else {
+        ImGui::Text("Shape : [%s]", shape.c_str());
+      }
+
+      if (size_t(_active_tensor_idx) < _tensor_stats.size()) {
+        const TensorStats &stats = _tensor_stats[size_t(_active_tensor_idx)];
+        ImGui::Text("Min : %g, Max : %g", double(stats.min_value),
+                    double(stats.max_value));
+        ImGui::Text("Mean : %g, Stddev : %g", stats.mean,
+                    std::sqrt(stats.variance));
+        if ((stats.nan_count > 0) || (stats.inf_count > 0)) {
+          ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f),
+                             "NaN : %zu, Inf : %zu", stats.nan_count,
+                             stats.inf_count);
+        }
+      }
+    }
 
     ImGui::SliderFloat("scale", &scale, 0.0f, 100.0f);
 
+    const char *cmap_names[kNumColormaps];
+    for (int i = 0; i < kNumColormaps; i++) {
+      cmap_names[i] = get_colormap_name(Colormap(i));
+    }
+
+    int cmap = int(_colormap);
+    if (ImGui::Combo("colormap", &cmap, cmap_names, kNumColormaps)) {
+      set_colormap(Colormap(cmap));
+    }
+
+    if ((_active_tensor_idx > -1) &&
+        (size_t(_active_tensor_idx) < _tensor_views.size())) {
+      TensorView &view = _tensor_views[size_t(_active_tensor_idx)];
+      const TensorStats &stats = _tensor_stats[size_t(_active_tensor_idx)];
+
+      const float speed =
+          std::max(1.0e-6f, (stats.max_value - stats.min_value) / 1000.0f);
+      ImGui::DragFloatRange2("range", &view.range_min, &view.range_max, speed);
+      ImGui::SameLine();
+      if (ImGui::Button("reset")) {
+        view.range_min = stats.min_value;
+        view.range_max = stats.max_value;
+      }
+
+      const char *mode_names[kNumDownsampleModes];
+      for (int i = 0; i < kNumDownsampleModes; i++) {
+        mode_names[i] = get_downsample_mode_name(DownsampleMode(i));
+      }
+
+      // Reduction used when the tensor is displayed at small scale.
+      int mode = int(view.downsample_mode);
+      if (ImGui::Combo("downsample", &mode, mode_names,
+                       kNumDownsampleModes)) {
+        view.downsample_mode = DownsampleMode(mode);
+        if (!view.pyramid.empty()) {
+          _tile_cache.clear(_active_tensor_idx);
+          view.pyramid.build(view.pyramid.tensor(), view.downsample_mode,
+                             _num_threads);
+        }
+      }
+    }
+
     ImVec2 pos = ImGui::GetCursorScreenPos();
     ImVec2 win_pos = ImGui::GetWindowPos();
 
@@ -669,14 +1642,18 @@ void GUIContext::draw_tensor() {
   }
 
   // std::cout << "active_tensor_idx " << std::to_string(_active_tensor_idx) <<
-  // ", tensor_texids = " << std::to_string(_tensor_texture_ids.size()) << "\n";
+  // ", tensor_views = " << std::to_string(_tensor_views.size()) << "\n";
 
-  if (size_t(_active_tensor_idx) >= _tensor_texture_ids.size()) {
+  if (size_t(_active_tensor_idx) >= _tensor_views.size()) {
     // ???
     return;
   }
 
-  GLuint texid = _tensor_texture_ids[size_t(_active_tensor_idx)];
+  const TensorView &view = _tensor_views[size_t(_active_tensor_idx)];
+  if (view.pyramid.empty()) {
+    return;
+  }
+
   const Tensor &tensor = _graph.tensors[size_t(_active_tensor_idx)];
 
   // Create child so that scroll bar only effective to the image region.
@@ -684,14 +1661,74 @@ void GUIContext::draw_tensor() {
                ImGuiWindowFlags_HorizontalScrollbar);
   {
     ImVec2 win_pos = ImGui::GetWindowPos();
+    ImVec2 win_size = ImGui::GetWindowSize();
     ImVec2 image_pos = ImGui::GetCursorScreenPos();
 
     ImVec2 image_local_offset;
     image_local_offset.x = image_pos.x - win_pos.x;
     image_local_offset.y = image_pos.y - win_pos.y;
 
-    ImGui::Image(ImTextureID(intptr_t(texid)),
-                 ImVec2(scale * float(tensor.shape[1]), scale * float(tensor.shape[0])));
+    // Pick the pyramid level whose texel is the closest to(but not larger
+    // than) a screen pixel.
+    const float pixel_scale = std::max(scale, 1.0e-3f);
+    int level = 0;
+    float texel_size = pixel_scale;  // in screen pixels
+    while (((level + 1) < view.pyramid.num_levels()) &&
+           ((texel_size * 2.0f) <= 1.0f)) {
+      level++;
+      texel_size *= 2.0f;
+    }
+
+    const int level_width = view.pyramid.width(level);
+    const int level_height = view.pyramid.height(level);
+    const float tile_extent = float(kTensorTileSize) * texel_size;
+
+    // Tiles in the visible region of the window.
+    const int num_tiles_x =
+        (level_width + kTensorTileSize - 1) / kTensorTileSize;
+    const int num_tiles_y =
+        (level_height + kTensorTileSize - 1) / kTensorTileSize;
+    const int tx_begin = std::max(
+        0, int(std::floor((win_pos.x - image_pos.x) / tile_extent)));
+    const int ty_begin = std::max(
+        0, int(std::floor((win_pos.y - image_pos.y) / tile_extent)));
+    const int tx_end = std::min(
+        num_tiles_x,
+        int(std::ceil((win_pos.x + win_size.x - image_pos.x) / tile_extent)));
+    const int ty_end = std::min(
+        num_tiles_y,
+        int(std::ceil((win_pos.y + win_size.y - image_pos.y) / tile_extent)));
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    for (int ty = ty_begin; ty < ty_end; ty++) {
+      for (int tx = tx_begin; tx < tx_end; tx++) {
+        const int tile_width =
+            std::min(kTensorTileSize, level_width - tx * kTensorTileSize);
+        const int tile_height =
+            std::min(kTensorTileSize, level_height - ty * kTensorTileSize);
+
+        const ImVec2 bmin(image_pos.x + float(tx) * tile_extent,
+                          image_pos.y + float(ty) * tile_extent);
+        const ImVec2 bmax(bmin.x + float(tile_width) * texel_size,
+                          bmin.y + float(tile_height) * texel_size);
+
+        GLuint texid = _tile_cache.get_tile(
+            _colormap_renderer, _active_tensor_idx, view.pyramid, level, tx,
+            ty, view.range_min, view.range_max, _colormap);
+        if (texid) {
+          draw_list->AddImage(ImTextureID(intptr_t(texid)), bmin, bmax);
+        } else {
+          // Not uploaded yet.
+          draw_list->AddRectFilled(
+              bmin, bmax,
+              ImGui::GetColorU32(ImVec4(0.14f, 0.14f, 0.14f, 1.0f)));
+        }
+      }
+    }
+
+    // Reserve the region of the whole tensor for scrolling.
+    ImGui::Dummy(ImVec2(scale * float(view.pyramid.width(0)),
+                        scale * float(view.pyramid.height(0))));
 
     if (scale > 40.0f) {
       // 40.0 ~ 64.0 : alpha 0 -> 1
@@ -705,7 +1742,42 @@ void GUIContext::draw_tensor() {
   }
 }
 
+GLuint GUIContext::get_tensor_thumbnail(int tensor_idx, ImVec2 *size) {
+  if ((tensor_idx < 0) || (size_t(tensor_idx) >= _tensor_views.size())) {
+    return 0;
+  }
+
+  const TensorView &view = _tensor_views[size_t(tensor_idx)];
+  if (view.pyramid.empty()) {
+    // Not prepared yet(e.g. lazily loaded).
+    return 0;
+  }
+
+  // The last level fits in `kTensorThumbnailSize`.
+  const int level = view.pyramid.num_levels() - 1;
+
+  // Keep aspect ratio.
+  const float w = float(view.pyramid.width(level));
+  const float h = float(view.pyramid.height(level));
+  const float s = float(kTensorThumbnailSize) / std::max(w, h);
+  (*size) = ImVec2(std::max(2.0f, w * s), std::max(2.0f, h * s));
+
+  return _tile_cache.get_tile(_colormap_renderer, tensor_idx, view.pyramid,
+                              level, 0, 0, view.range_min, view.range_max,
+                              _colormap);
+}
+
+void GUIContext::end_frame() {
+  // Evict tiles which are not visible anymore.
+  _tile_cache.end_frame();
+}
+
 void GUIContext::finalize() {
+  _tile_cache.clear();
+  _tensor_views.clear();
+
+  _colormap_renderer.finalize();
+
   if (_editor_context) {
     ed::DestroyEditor(_editor_context);
   }
@@ -12,11 +12,24 @@
 #pragma clang diagnostic pop
 #endif
 
+#include "colormap-lut.hh"
 #include "datatypes.h"
-
+#include "gl-colormap.hh"
+#include "gl-tensor-tiles.hh"
+#include "graph-csr.hh"
+#include "graph-hierarchy.hh"
+#include "layout/force-layout.hh"
+#include "layout/layered-layout.hh"
+#include "spatial-grid.hh"
+#include "tensor-pyramid.hh"
+#include "tensor-stats.hh"
+
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <utility>
 
 namespace ed = ax::NodeEditor;
 
@@ -37,6 +50,14 @@ enum class PinType {
 
 enum class PinKind { Output, Input };
 
+// Placement of nodes in the graph view.
+enum GraphLayout {
+  GRAPH_LAYOUT_LAYERED = 0,  // Layers from left to right
+  GRAPH_LAYOUT_FORCE,        // Force-directed, refined over frames
+};
+
+constexpr int kNumGraphLayouts = 2;
+
 struct Link {
   ed::LinkId ID;
 
@@ -45,6 +66,14 @@ struct Link {
 
   ImColor Color;
 
+  // Index to GUIContext::_imnodes of the nodes connected by this link.
+  int start_imnode_idx = -1;
+  int end_imnode_idx = -1;
+
+  // true when removed by expanding/collapsing a group. The slot is reused by
+  // the next link added.
+  bool removed = false;
+
   Link(ed::LinkId id, ed::PinId startPinId, ed::PinId endPinId)
       : ID(id),
         StartPinID(startPinId),
@@ -70,13 +99,43 @@ struct ImNode {
   std::vector<Pin> inputs;
   std::vector<Pin> outputs;
   ImColor color;
+
+  // Position and size on the canvas. Used for culling.
+  // Updated from the node editor while the node is drawn. `size` is an
+  // estimate until the node is drawn for the first time.
+  ImVec2 pos;
   ImVec2 size;
 
   int tensor_id = -1;  // Index to nnview::Graph::tensors
+  int graph_node_id = -1;  // Index to nnview::Graph::nodes
+  int group_id = -1;  // Index to GraphHierarchy::groups(collapsed group)
+
+  // true when removed by expanding/collapsing a group. Removed ImNode is
+  // kept in GUIContext::_imnodes until its slot is reused by the next ImNode
+  // added, so that indices of other ImNodes are stable.
+  bool removed = false;
 
   ImNode(ed::NodeId _id, const std::string _name,
          ImColor _color = ImColor(255, 255, 255))
-      : id(_id), name(_name), color(_color), size(0, 0) {}
+      : id(_id), name(_name), color(_color), pos(0, 0), size(0, 0) {}
+};
+
+// Display state of a Tensor in the Tensor Image window.
+struct TensorView {
+  // Downsampled levels. Tiles of levels are uploaded to `TensorTileCache`.
+  // Empty when the tensor is not prepared yet or cannot be displayed as an
+  // image(e.g. no items).
+  TensorPyramid pyramid;
+
+  // Statistics are computed and the pyramid is built.
+  bool prepared = false;
+
+  // Reduction used to build the pyramid.
+  DownsampleMode downsample_mode = DOWNSAMPLE_MEAN;
+
+  // Value range mapped to the colormap. Initialized with tensor min/max.
+  float range_min = 0.0f;
+  float range_max = 0.0f;
 };
 
 class GUIContext {
@@ -89,10 +148,123 @@ class GUIContext {
   std::vector<ImNode> _imnodes;
   std::vector<Link> _links;
 
+  // Index to removed entries of `_imnodes` and `_links`, reused when an
+  // ImNode or a link is added.
+  std::vector<int> _free_imnodes;
+  std::vector<int> _free_links;
+
+  // ImNodes added since this was cleared. Expanding/collapsing a group places
+  // only these ImNodes.
+  std::vector<int> _new_imnodes;
+
   std::map<int, int> _node_id_to_imnode_idx_map; // <NodeId, index to _imnodes>
 
-  // OpenGL texture id for displaying Tensor as Texture(Image)
-  std::vector<GLuint> _tensor_texture_ids;
+  // Connections of `_graph` for traversal. Built when the graph is loaded,
+  // together with node depths.
+  CsrGraph _csr_graph;
+
+  // Groups of graph nodes. A collapsed group is drawn as a single ImNode.
+  // Groups are collapsed initially.
+  GraphHierarchy _hierarchy;
+  std::vector<uint8_t> _group_expanded;
+
+  // Index to `_imnodes` of each graph node, tensor and collapsed group.
+  // -1 = not materialized(hidden in a collapsed group).
+  std::vector<int> _graph_node_imnodes;
+  std::vector<int> _tensor_imnodes;
+  std::vector<int> _group_imnodes;
+
+  // Graph node which materializes the ImNode of each tensor. The producer, or
+  // the first consumer for parameters and inputs.
+  std::vector<int> _tensor_owners;
+
+  // <start pin, end pin> of links. Tensors flowing between the same pair of
+  // collapsed groups are drawn as one link.
+  std::set<std::pair<uintptr_t, uintptr_t>> _link_pins;
+
+  // Placement of ImNodes. Applied on load and when a group is expanded or
+  // collapsed.
+  GraphLayout _graph_layout = GRAPH_LAYOUT_LAYERED;
+  LayeredLayoutOption _layout_option;
+  ForceLayoutOption _force_layout_option;
+
+  // Force-directed layout in progress, advanced for
+  // `_force_layout_budget_ms` per frame. Starts from the layered layout.
+  ForceLayout _force_layout;
+  std::vector<int> _force_layout_imnodes;  // ImNode of each layout node
+  int _force_layout_applied_iteration = 0;
+  double _force_layout_budget_ms = 4.0;
+
+  // Sizes of ImNodes are estimated until they are drawn. Lay out again once
+  // the actual sizes are known.
+  bool _relayout_after_draw = false;
+
+  // ImNodes placed by the last expand/collapse and their upper left corner.
+  // Placed again once their actual sizes are known.
+  std::vector<int> _placed_imnodes;
+  ImVec2 _placed_anchor;
+
+  // Group expanded/collapsed after drawing the current frame. -1 = none.
+  int _pending_expand_group = -1;
+  int _pending_collapse_group = -1;
+  bool _pending_layout = false;  // `_graph_layout` changed
+
+  // ImNode of the opened context menu.
+  int _context_imnode_idx = -1;
+
+  // Submit only nodes and links in the view. false = submit all(for
+  // benchmarking).
+  bool _cull_imnodes = true;
+
+  // Spatial index of `_imnodes` and `_links`(bounding box of its end nodes)
+  // on the canvas. Used for culling and hit testing.
+  SpatialGrid _imnode_grid;
+  SpatialGrid _link_grid;
+
+  // Index to `_links` connected to each ImNode.
+  std::vector<std::vector<int>> _imnode_links;
+
+  // Index to `_imnodes` and `_links` in the view in the current frame, in
+  // ascending order. Only these are submitted to the node editor.
+  std::vector<int> _visible_imnodes;
+  std::vector<int> _visible_links;
+
+  // 1 when the ImNode is in `_visible_imnodes`.
+  std::vector<uint8_t> _imnode_visible;
+
+  // Screen pixels per canvas unit in the current frame.
+  float _canvas_scale = 1.0f;
+
+  // Below this scale, nodes are drawn as plain rectangles and links as
+  // straight lines. 0 = always draw in full detail.
+  float _lod_scale_threshold = 0.4f;
+
+  // ImNode under the mouse cursor. -1 = none.
+  int _hovered_imnode_idx = -1;
+
+  // # of nodes and links submitted to the node editor in the last frame.
+  size_t _num_drawn_imnodes = 0;
+  size_t _num_drawn_links = 0;
+
+  std::vector<TensorView> _tensor_views;
+
+  // Statistics of each tensor. Valid when its TensorView is prepared.
+  std::vector<TensorStats> _tensor_stats;
+
+  // Used when reading the payload of lazily loaded tensor.
+  bool _use_mmap = true;
+
+  Colormap _colormap = COLORMAP_VIRIDIS;
+
+  // Applies range and colormap on GPU. When not available(e.g. shader
+  // compilation failed), colormapping is done on CPU.
+  ColormapRenderer _colormap_renderer;
+
+  // OpenGL textures for displaying Tensor as Texture(Image)
+  TensorTileCache _tile_cache;
+
+  // # of threads used for tensor statistics. -1 = use all cores.
+  int _num_threads = -1;
 
   GLuint _background_texture_id = 0;
 
@@ -104,14 +276,95 @@ class GUIContext {
 
   // Initialize and layout ImNodes from Graph.
   // This function should be called after `init` and before calling ImNode
-  // drawing methods.
+  // drawing methods. `_csr_graph` must be built from `_graph`(see
+  // `load_json_graph`).
   void init_imnode_graph();
 
+  // Clear `_imnode_grid` and `_link_grid`. ImNodes and links are registered
+  // when they are added.
+  void reset_spatial_index();
+
+  // Add ImNode/Link and register it to the spatial index.
+  // Returns the index to `_imnodes` or `_links`.
+  int add_imnode(const ImNode &imnode);
+  int add_link(const Link &link);
+
+  // Remove ImNode and links connected to it.
+  void remove_imnode(int imnode_idx);
+
+  // Create ImNode of the graph node and tensors owned by it.
+  void materialize_graph_node(size_t node_idx);
+
+  // Create ImNode of the collapsed group.
+  void materialize_group(size_t group_idx);
+
+  // Remove ImNodes of the graph node and tensors owned by it.
+  void dematerialize_graph_node(size_t node_idx);
+
+  // ImNode currently representing the graph node or tensor: its own ImNode,
+  // or the ImNode of the collapsed group which contains it. -1 = none.
+  int find_graph_node_imnode(size_t node_idx) const;
+  int find_tensor_imnode(size_t tensor_idx) const;
+
+  // Create links of all tensors connected to `nodes`(index to Graph::nodes)
+  // between the ImNodes currently representing them.
+  void connect_graph_nodes(const std::vector<int> &nodes);
+
+  // Link the tensor and its consumer(`consumer` = true) or producer node.
+  void link_tensor(size_t tensor_idx, size_t node_idx, size_t slot,
+                   bool consumer);
+
+  // Materialize children of the group in place of its ImNode, and vice versa.
+  // Only ImNodes and links of the group are updated. New ImNodes are placed
+  // at the position of the removed ones with `place_imnodes`.
+  void expand_group(int group_idx);
+  void collapse_group(int group_idx);
+
+  // Place ImNodes and links currently materialized with `_graph_layout`.
+  // Positions set by the user are discarded.
+  void layout_imnodes();
+
+  // Place `imnodes` with the layered layout of the links between them, with
+  // the upper left corner at `anchor`. Other ImNodes are kept, and moved only
+  // when they overlap.
+  void place_imnodes(const std::vector<int> &imnodes, const ImVec2 &anchor);
+
+  // Move ImNodes overlapping with `imnodes` right or down, whichever is
+  // shorter, and then ImNodes overlapping with the moved ones.
+  void resolve_overlaps(const std::vector<int> &imnodes);
+
+  // Move ImNodes to the positions of the force-directed layout.
+  void apply_force_layout();
+
+  // Update position and size of ImNode, and the spatial index of the node and
+  // its links.
+  void update_imnode_bounds(size_t imnode_idx, const ImVec2 &pos,
+                            const ImVec2 &size);
+  void update_link_bounds(size_t link_idx);
+
+  // Collect nodes and links overlapping with the view(in canvas coordinate).
+  void cull_imnodes(const ImVec2 &view_min, const ImVec2 &view_max);
+
   void draw_imnodes();
 
+  // Read the payload of the tensor(if not loaded yet), compute its statistics
+  // and build its pyramid.
+  // Returns false when the tensor cannot be read.
+  bool prepare_tensor(int tensor_idx);
+
+  // Change the colormap used for tensor textures.
+  void set_colormap(Colormap cmap);
+
   // Draw Tensor in active section.
   void draw_tensor();
 
+  // Returns the texture of the thumbnail of the tensor and its display size.
+  // Returns 0 when the thumbnail is not available.
+  GLuint get_tensor_thumbnail(int tensor_idx, ImVec2 *size);
+
+  // Call at the end of each frame, after drawing.
+  void end_frame();
+
   void finalize();
 };
 
@@ -1,12 +1,20 @@
 #include "io/graph-loader.hh"
+#include "io/json-sax.hh"
 #include "io/weights-loader.hh"
+#include "log.hh"
+#include "parallel.hh"
+#include "trace.hh"
 
 #include "json11.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <fstream>
-#include <iostream>
+#include <functional>
+#include <set>
 #include <sstream>
+#include <unordered_map>
 
 using namespace json11;
 
@@ -34,32 +42,173 @@ static std::string GetBaseDir(const std::string &filepath) {
 
 static bool LoadWeights(
     const std::vector<std::pair<std::string, std::string>> &weights,
-    const std::string base_dir, std::map<std::string, Tensor> *tensors) {
-  // item = <name, filename>
-  for (const auto &item : weights) {
-    Tensor tensor;
-    std::string filepath = JoinPath(base_dir, item.second);
-    if (!load_weights(filepath, &tensor)) {
-      std::cerr << "Failed to read weight/tensor : " << filepath << "\n";
-      return false;
+    const std::string base_dir, const GraphLoaderOption &option,
+    std::map<std::string, Tensor> *tensors) {
+  // Ensure uniqueness before reading any file.
+  {
+    std::set<std::string> names;
+    for (const auto &item : weights) {
+      if (names.count(item.first) || tensors->count(item.first)) {
+        NNVIEW_LOG_ERROR(GRAPH) << item.first << "(filename: " << item.second
+                                << ") is already exists.";
+        return false;
+      }
+      names.insert(item.first);
     }
+  }
 
-    // Ensure uniqueness
-    if (tensors->count(item.first)) {
-      std::cerr << item.first << "(filename: " << item.second
-                << ") is already exists.\n";
-      return false;
+  std::vector<Tensor> loaded(weights.size());
+  std::vector<char> succeeded(weights.size(), 0);
+
+  // item = <name, filename>
+  if (option.structure_only) {
+    std::fill(succeeded.begin(), succeeded.end(), 1);
+  } else {
+    const int num_threads = option.num_threads;
+    parallel_for(weights.size(), num_threads, [&](size_t i, int thread_id) {
+      (void)thread_id;
+
+      std::string filepath = JoinPath(base_dir, weights[i].second);
+      bool ret =
+          option.lazy
+              ? load_weights_header(filepath, &loaded[i])
+              : (option.use_mmap ? load_weights_mmap(filepath, &loaded[i])
+                                 : load_weights(filepath, &loaded[i]));
+      succeeded[i] = ret ? 1 : 0;
+    });
+  }
+
+  // Report every failed file, not only the first one.
+  bool all_succeeded = true;
+  for (size_t i = 0; i < weights.size(); i++) {
+    if (!succeeded[i]) {
+      NNVIEW_LOG_ERROR(GRAPH) << "Failed to read weight/tensor : "
+                              << JoinPath(base_dir, weights[i].second);
+      all_succeeded = false;
     }
+  }
+
+  if (!all_succeeded) {
+    return false;
+  }
 
-    std::cout << "loaded tensor/weight : " << item.first
-              << ", len(shape) = " << tensor.shape.size() << "\n";
-    (*tensors)[item.first] = tensor;
+  for (size_t i = 0; i < weights.size(); i++) {
+    NNVIEW_LOG_DEBUG(GRAPH) << "loaded tensor/weight : " << weights[i].first
+                            << ", len(shape) = " << loaded[i].shape.size();
+    // Move. Only the reference to the payload is transferred.
+    (*tensors)[weights[i].first] = std::move(loaded[i]);
   }
 
   return true;
 }
 
-static bool ParseInputProperty(const Json &j, Node *node, Graph *graph) {
+// Keys of a layer object used to build Node.
+enum LayerKey {
+  LAYER_KEY_TYPE = 0,
+  LAYER_KEY_NAME,
+  LAYER_KEY_GROUP,
+  LAYER_KEY_SOURCE,
+  LAYER_KEY_KERNEL_WEIGHTS_FILE,
+  LAYER_KEY_BIAS_WEIGHTS_FILE,
+  LAYER_KEY_INPUT_TENSOR,
+  LAYER_KEY_OUTPUT_TENSOR,
+  LAYER_KEY_OUTPUT_NAMES,  // Array of strings
+  LAYER_KEY_OTHER,
+};
+
+// # of keys whose value is a string.
+constexpr int kNumLayerStringKeys = 8;
+
+static const char *GetLayerKeyName(LayerKey key) {
+  switch (key) {
+    case LAYER_KEY_TYPE:
+      return "type";
+    case LAYER_KEY_NAME:
+      return "name";
+    case LAYER_KEY_GROUP:
+      return "group";
+    case LAYER_KEY_SOURCE:
+      return "source";
+    case LAYER_KEY_KERNEL_WEIGHTS_FILE:
+      return "kernel_weights_file";
+    case LAYER_KEY_BIAS_WEIGHTS_FILE:
+      return "bias_weights_file";
+    case LAYER_KEY_INPUT_TENSOR:
+      return "input_tensor";
+    case LAYER_KEY_OUTPUT_TENSOR:
+      return "output_tensor";
+    case LAYER_KEY_OUTPUT_NAMES:
+      return "output_names";
+    case LAYER_KEY_OTHER:
+      break;
+  }
+  return "";
+}
+
+static LayerKey GetLayerKey(const std::string &s) {
+  for (int i = 0; i < LAYER_KEY_OTHER; i++) {
+    if (s.compare(GetLayerKeyName(LayerKey(i))) == 0) {
+      return LayerKey(i);
+    }
+  }
+  return LAYER_KEY_OTHER;
+}
+
+//
+// Fields of a layer object which are used to build Node. Filled from json11
+// DOM(`GetLayerFields`) or directly from streaming JSON events
+// (`GraphSaxHandler`), so that both parsers build the same Node.
+//
+struct LayerFields {
+  std::string strings[kNumLayerStringKeys];
+
+  // false when the key is missing or its value is not a string.
+  bool has_string[kNumLayerStringKeys] = {};
+
+  std::vector<std::string> output_names;
+
+  bool has(LayerKey key) const { return has_string[key]; }
+
+  // Empty when `has(key)` is false.
+  const std::string &get(LayerKey key) const { return strings[key]; }
+
+  void set(LayerKey key, const std::string &s) {
+    strings[key] = s;
+    has_string[key] = true;
+  }
+
+  void reset(LayerKey key) {
+    strings[key].clear();
+    has_string[key] = false;
+  }
+
+  void clear() {
+    for (int i = 0; i < kNumLayerStringKeys; i++) {
+      reset(LayerKey(i));
+    }
+    output_names.clear();
+  }
+};
+
+static void GetLayerFields(const Json &layer, LayerFields *fields) {
+  fields->clear();
+
+  for (int i = 0; i < kNumLayerStringKeys; i++) {
+    const Json &value = layer[GetLayerKeyName(LayerKey(i))];
+    if (value.is_string()) {
+      fields->set(LayerKey(i), value.string_value());
+    }
+  }
+
+  for (auto &output_name : layer["output_names"].array_items()) {
+    if (output_name.is_string()) {
+      fields->output_names.push_back(output_name.string_value());
+    }
+  }
+}
+
+static bool ParseInputProperty(const LayerFields &j, Node *node,
+                               Graph *graph) {
   (void)j;
   (void)node;
   (void)graph;
@@ -88,17 +237,17 @@ static bool ParseInputProperty(const Json &j, Node *node, Graph *graph) {
 }
 
 static bool ParseLinearFunctionProperty(
-    const Json &j, Node *node,
+    const LayerFields &j, Node *node,
     std::vector<std::pair<std::string, std::string>> *tensor_files) {
-  if (j["source"].is_string()) {
-    std::string name = j["source"].string_value();
+  if (j.has(LAYER_KEY_SOURCE)) {
+    const std::string &name = j.get(LAYER_KEY_SOURCE);
 
     // id will be determinted later
     node->inputs.push_back(Slot(name, "input", -1));
   }
 
-  if (j["kernel_weights_file"].is_string()) {
-    std::string filepath = j["kernel_weights_file"].string_value();
+  if (j.has(LAYER_KEY_KERNEL_WEIGHTS_FILE)) {
+    const std::string &filepath = j.get(LAYER_KEY_KERNEL_WEIGHTS_FILE);
 
     (*tensor_files).push_back({filepath, filepath});
 
@@ -106,8 +255,8 @@ static bool ParseLinearFunctionProperty(
     node->inputs.push_back(Slot(filepath, "W", -1));
   }
 
-  if (j["bias_weights_file"].is_string()) {
-    std::string filepath = j["bias_weights_file"].string_value();
+  if (j.has(LAYER_KEY_BIAS_WEIGHTS_FILE)) {
+    const std::string &filepath = j.get(LAYER_KEY_BIAS_WEIGHTS_FILE);
 
     (*tensor_files).push_back({filepath, filepath});
 
@@ -118,9 +267,9 @@ static bool ParseLinearFunctionProperty(
   return true;
 }
 
-static bool ParseReLUProperty(const Json &j, Node *node) {
-  if (j["source"].is_string()) {
-    std::string name = j["source"].string_value();
+static bool ParseReLUProperty(const LayerFields &j, Node *node) {
+  if (j.has(LAYER_KEY_SOURCE)) {
+    const std::string &name = j.get(LAYER_KEY_SOURCE);
 
     // id will be determinted later
     node->inputs.push_back(Slot(name, "input", -1));
@@ -129,234 +278,636 @@ static bool ParseReLUProperty(const Json &j, Node *node) {
   return true;
 }
 
-static int FindTensor(const std::string &name,
-                      const std::vector<Tensor> &tensors) {
-  for (size_t i = 0; i < tensors.size(); i++) {
-    if (name.compare(tensors[i].name) == 0) {
-      return int(i);
+//
+// Open addressing index of tensor names. Refers to the names in
+// Graph::tensors, so no string is copied.
+//
+class TensorNameIndex {
+ public:
+  explicit TensorNameIndex(const std::vector<Tensor> &tensors)
+      : _tensors(tensors) {
+    size_t num_slots = 64;
+    // Keep the load factor below 1/2.
+    while (num_slots < tensors.size() * 2) {
+      num_slots *= 2;
+    }
+    _mask = num_slots - 1;
+    _table.assign(num_slots, -1);
+    _hashes.resize(tensors.size());
+
+    for (size_t i = 0; i < tensors.size(); i++) {
+      _hashes[i] = std::hash<std::string>()(tensors[i].name);
+      // Keep the first one when the name is duplicated(same as linear search)
+      size_t slot = 0;
+      if (Find(tensors[i].name, _hashes[i], &slot) == -1) {
+        _table[slot] = int(i);
+      }
     }
   }
 
-  return -1;  // not found
-}
+  // Returns -1 when not found.
+  int find(const std::string &name) const {
+    size_t slot = 0;
+    return Find(name, std::hash<std::string>()(name), &slot);
+  }
 
-bool load_json_graph(const std::string &filename, Graph *graph) {
-  if (graph == nullptr) {
-    std::cerr << "`graph` is nullptr\n";
-    return false;
+ private:
+  int Find(const std::string &name, size_t hash, size_t *slot) const {
+    for (size_t i = hash & _mask;; i = (i + 1) & _mask) {
+      const int id = _table[i];
+      if ((id == -1) || ((_hashes[size_t(id)] == hash) &&
+                         (_tensors[size_t(id)].name == name))) {
+        (*slot) = i;
+        return id;
+      }
+    }
   }
 
-  std::ifstream ifs(filename, std::ios::in);
-  if (!ifs) {
-    std::cerr << "Failed to open graph file : " << filename << std::endl;
+  const std::vector<Tensor> &_tensors;
+  std::vector<int> _table;
+  std::vector<size_t> _hashes;  // Hash of each tensor name
+  size_t _mask;
+};
+
+bool resolve_tensor_slots(Graph *graph) {
+  NNVIEW_TRACE_SCOPE("resolve_tensor_slots");
+
+  if (graph == nullptr) {
     return false;
   }
 
-  std::stringstream ss;
-  ss << ifs.rdbuf();
-  ifs.close();
+  // Build name index once. O(1) lookup per slot.
+  const TensorNameIndex tensor_index(graph->tensors);
 
-  std::string json_str(ss.str());
+  for (size_t n = 0; n < graph->nodes.size(); n++) {
+    Node &node = graph->nodes[n];
 
-  std::string err;
-  Json json = Json::parse(json_str, err);
+    for (size_t i = 0; i < node.inputs.size(); i++) {
+      const std::string &name = node.inputs[i].name;
 
-  if (!err.empty()) {
-    std::cerr << "JSON parse error. filename: " << filename << " err: " << err
-              << std::endl;
-    return false;
-  }
+      int tensor_id = tensor_index.find(name);
+      if (tensor_id == -1) {
+        NNVIEW_LOG_ERROR(GRAPH) << "Input tensor \"" << name
+                                << "\" not found in the graph.";
+        return false;
+      }
 
-  std::vector<std::string> inputs;
-  for (auto input : json["inputs"].array_items()) {
-    if (input.is_string()) {
-      inputs.push_back(input.string_value());
+      node.inputs[i].id = tensor_id;
     }
-  }
 
-  std::vector<std::string> outputs;
-  for (auto output : json["outputs"].array_items()) {
-    // Chainer-TRT's outpus is an array of array item.
-    if (output.is_array()) {
-      // Just take the first one.
-      auto &item = output.array_items()[0];
-      if (item.is_string()) {
-        outputs.push_back(item.string_value());
+    for (size_t o = 0; o < node.outputs.size(); o++) {
+      const std::string &name = node.outputs[o].name;
+
+      int tensor_id = tensor_index.find(name);
+      if (tensor_id == -1) {
+        NNVIEW_LOG_ERROR(GRAPH) << "Output tensor \"" << name
+                                << "\" not found in the graph.";
+        return false;
       }
+
+      node.outputs[o].id = tensor_id;
     }
   }
 
-  std::map<std::string, int> node_name_to_id_map;
-
-  std::vector<std::pair<std::string, std::string>>
-      temp_tensors;  // <name, filename>
+  return true;
+}
 
-  graph->nodes.clear();
-  // layers
-  for (auto layer : json["layers"].array_items()) {
-    // Exampe definition of layer.
-    // See $nnview/models/mnist/model.json for details.
-    //
-    // {
-    //   "type": "input",
-    //   "name": "input",
-    //   "output_names": [
-    //     "input"
-    //   ],
-    //   "rank": -2,
-    //   "shape": [
-    //     784
-    //   ]
-    // },
+// Frontiers narrower than this are processed on the calling thread.
+static constexpr size_t kMinParallelFrontier = 1 << 14;
+static constexpr size_t kFrontierChunkSize = 1024;
 
-    if (!layer.is_object()) {
-      continue;
-    }
+static void AtomicMax(std::atomic<int> *a, int value) {
+  int current = a->load();
+  while ((current < value) && !a->compare_exchange_weak(current, value)) {
+  }
+}
 
-    std::string type = layer["type"].string_value();
-    std::string name = layer["name"].string_value();
+bool compute_node_depths(const CsrGraph &csr, Graph *graph, int num_threads) {
+  NNVIEW_TRACE_SCOPE("compute_node_depths");
 
-    std::vector<std::string> output_names;
+  if ((graph == nullptr) || (csr.num_nodes() != graph->nodes.size())) {
+    return false;
+  }
 
-    // rank = layer depth
-    int rank = layer["rank"].int_value();
+  const size_t num_nodes = csr.num_nodes();
 
-    Node node;
-    node.name = name;
-    node.depth = rank;
+  std::vector<std::atomic<int>> in_degrees(num_nodes);
+  std::vector<std::atomic<int>> depths(num_nodes);
+  for (size_t n = 0; n < num_nodes; n++) {
+    in_degrees[n] = int(csr.predecessors(n).size());
+    depths[n] = 0;
+  }
 
-    for (auto &output_name : layer["output_names"].array_items()) {
-      if (output_name.is_string()) {
-        node.outputs.push_back(Slot(output_name.string_value(), "output", -1));
+  // Visit `u` and append consumers which become ready to `ready`.
+  auto visit = [&](int u, std::vector<int> *ready) {
+    const int depth = depths[size_t(u)].load() + 1;
+    for (int32_t successor : csr.successors(size_t(u))) {
+      const size_t v = size_t(successor);
+      const int remaining = in_degrees[v].fetch_sub(1);
+      if (remaining <= 0) {
+        // `v` is already visited. The edge closes a cycle.
+        continue;
+      }
+      // Visited in the next frontier at the earliest, so the depth is
+      // complete by then.
+      AtomicMax(&depths[v], depth);
+      if (remaining == 1) {
+        ready->push_back(int(v));
       }
     }
+  };
 
-    // TODO(LTE): Support multiple outputs.
-    if (node.outputs.size() == 1) {
-      if (layer["output_tensor"].is_string()) {
-        std::string tensor_filename = layer["output_tensor"].string_value();
-        temp_tensors.push_back({node.outputs[0].name, tensor_filename});
-      }
+  std::vector<int> frontier;
+  for (size_t n = 0; n < num_nodes; n++) {
+    if (in_degrees[n] == 0) {
+      frontier.push_back(int(n));
     }
+  }
 
-    if (type.compare("input") == 0) {
-      bool ret = ParseInputProperty(layer, &node, graph);
-      if (!ret) {
-        std::cerr << "Failed to parse `input` layer.\n";
-        return false;
+  const size_t num_workers = size_t(get_num_threads(num_threads));
+  std::vector<std::vector<int>> worker_frontiers(num_workers);
+  std::vector<int> next_frontier;
+
+  size_t num_visited = 0;
+  size_t num_broken_cycles = 0;
+  size_t next_unvisited = 0;
+  while (num_visited < num_nodes) {
+    if (frontier.empty()) {
+      // Remaining nodes are on cycles or behind them. Visit the first one
+      // regardless of unvisited predecessors.
+      while (in_degrees[next_unvisited] <= 0) {
+        next_unvisited++;
       }
-
-      // `input` layer has `input_tensor`.
-      // We treat it as output tensor.
-      assert(node.outputs.size() == 1);
-      if (layer["input_tensor"].is_string()) {
-        std::string tensor_filename = layer["input_tensor"].string_value();
-        temp_tensors.push_back({node.outputs[0].name, tensor_filename});
+      if (num_broken_cycles == 0) {
+        NNVIEW_LOG_WARN(GRAPH) << "Graph has a cycle through node \""
+                               << graph->nodes[next_unvisited].name << "\".";
       }
+      num_broken_cycles++;
+      in_degrees[next_unvisited] = 0;
+      frontier.push_back(int(next_unvisited));
+    }
 
-    } else if (type.compare("LinearFunction") == 0) {
-      bool ret = ParseLinearFunctionProperty(layer, &node, &temp_tensors);
-      if (!ret) {
-        std::cerr << "Failed to parse `LinearFunction` layer.\n";
-        return false;
-      }
-    } else if (type.compare("ReLU") == 0) {
-      bool ret = ParseReLUProperty(layer, &node);
-      if (!ret) {
-        std::cerr << "Failed to parse `ReLU` layer.\n";
-        return false;
+    num_visited += frontier.size();
+    next_frontier.clear();
+
+    if ((num_workers > 1) && (frontier.size() >= kMinParallelFrontier)) {
+      const size_t num_chunks =
+          (frontier.size() + kFrontierChunkSize - 1) / kFrontierChunkSize;
+      parallel_for(num_chunks, int(num_workers), [&](size_t c, int thread_id) {
+        const size_t end =
+            std::min(frontier.size(), (c + 1) * kFrontierChunkSize);
+        for (size_t i = c * kFrontierChunkSize; i < end; i++) {
+          visit(frontier[i], &worker_frontiers[size_t(thread_id)]);
+        }
+      });
+
+      for (auto &ready : worker_frontiers) {
+        next_frontier.insert(next_frontier.end(), ready.begin(), ready.end());
+        ready.clear();
       }
     } else {
-      // Unknown
+      for (int u : frontier) {
+        visit(u, &next_frontier);
+      }
     }
 
-    node.id = int(graph->nodes.size());
-    graph->nodes.push_back(node);
+    frontier.swap(next_frontier);
+  }
+
+  for (size_t n = 0; n < num_nodes; n++) {
+    graph->nodes[n].depth = depths[n];
+  }
+
+  if (num_broken_cycles > 0) {
+    NNVIEW_LOG_WARN(GRAPH) << num_broken_cycles
+                           << " cycle(s) are broken to compute node depths.";
+  }
+
+  return num_broken_cycles == 0;
+}
+
+// Intermediate state while building Graph from JSON.
+// Shared by DOM(json11) and streaming JSON parser.
+struct GraphParseState {
+  Graph *graph = nullptr;
+
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+
+  std::unordered_map<std::string, int> node_name_to_id_map;
 
-    std::cout << "Node: " << name << ", id: " << node.id << "\n";
-    std::cout << "  # of inputs: " << node.inputs.size() << "\n";
-    std::cout << "  # of outputs: " << node.outputs.size() << "\n";
+  // Receives CsrGraph of `graph`. nullptr = Not requested by the caller.
+  CsrGraph *csr = nullptr;
 
-    node_name_to_id_map[name] = node.id;
+  std::vector<std::pair<std::string, std::string>>
+      temp_tensors;  // <name, filename>
+};
+
+static bool ParseLayer(const LayerFields &layer, GraphParseState *state) {
+  // Exampe definition of layer.
+  // See $nnview/models/mnist/model.json for details.
+  //
+  // {
+  //   "type": "input",
+  //   "name": "input",
+  //   "output_names": [
+  //     "input"
+  //   ],
+  //   "rank": -2,
+  //   "shape": [
+  //     784
+  //   ]
+  // },
+
+  const std::string &type = layer.get(LAYER_KEY_TYPE);
+  const std::string &name = layer.get(LAYER_KEY_NAME);
+
+  // `rank` is ignored. Depth is computed from connections after all layers
+  // are read. See `compute_node_depths`.
+  Node node;
+  node.name = name;
+
+  // Optional. Path of the group to collapse on GUI.
+  node.group = layer.get(LAYER_KEY_GROUP);
+
+  for (const auto &output_name : layer.output_names) {
+    node.outputs.push_back(Slot(output_name, "output", -1));
   }
 
-  for (size_t i = 0; i < temp_tensors.size(); i++) {
-    std::cout << temp_tensors[i].first << " = " << temp_tensors[i].second
-              << "\n";
+  // TODO(LTE): Support multiple outputs.
+  if (node.outputs.size() == 1) {
+    if (layer.has(LAYER_KEY_OUTPUT_TENSOR)) {
+      state->temp_tensors.push_back(
+          {node.outputs[0].name, layer.get(LAYER_KEY_OUTPUT_TENSOR)});
+    }
+  }
+
+  if (type.compare("input") == 0) {
+    bool ret = ParseInputProperty(layer, &node, state->graph);
+    if (!ret) {
+      NNVIEW_LOG_ERROR(GRAPH) << "Failed to parse `input` layer.";
+      return false;
+    }
+
+    // `input` layer has `input_tensor`.
+    // We treat it as output tensor.
+    assert(node.outputs.size() == 1);
+    if (layer.has(LAYER_KEY_INPUT_TENSOR)) {
+      state->temp_tensors.push_back(
+          {node.outputs[0].name, layer.get(LAYER_KEY_INPUT_TENSOR)});
+    }
+
+  } else if (type.compare("LinearFunction") == 0) {
+    bool ret = ParseLinearFunctionProperty(layer, &node, &state->temp_tensors);
+    if (!ret) {
+      NNVIEW_LOG_ERROR(GRAPH) << "Failed to parse `LinearFunction` layer.";
+      return false;
+    }
+  } else if (type.compare("ReLU") == 0) {
+    bool ret = ParseReLUProperty(layer, &node);
+    if (!ret) {
+      NNVIEW_LOG_ERROR(GRAPH) << "Failed to parse `ReLU` layer.";
+      return false;
+    }
+  } else {
+    // Unknown
+  }
+
+  node.id = int(state->graph->nodes.size());
+
+  NNVIEW_LOG_DEBUG(GRAPH) << "Node: " << name << ", id: " << node.id
+                          << ", # of inputs: " << node.inputs.size()
+                          << ", # of outputs: " << node.outputs.size();
+
+  state->node_name_to_id_map[name] = node.id;
+  state->graph->nodes.push_back(std::move(node));
+
+  return true;
+}
+
+static bool FinalizeGraph(const std::string &filename,
+                          const GraphLoaderOption &option,
+                          GraphParseState *state) {
+  for (size_t i = 0; i < state->temp_tensors.size(); i++) {
+    NNVIEW_LOG_DEBUG(GRAPH) << state->temp_tensors[i].first << " = "
+                            << state->temp_tensors[i].second;
   }
 
   // Batch load weights/tensors.
   {
+    NNVIEW_TRACE_SCOPE("load_weights_batch");
+
     std::string base_dir = GetBaseDir(filename);
 
     std::map<std::string, Tensor> tensors;
-    if (!LoadWeights(temp_tensors, base_dir, &tensors)) {
+    if (!LoadWeights(state->temp_tensors, base_dir, option, &tensors)) {
       return false;
     }
 
     for (auto &item : tensors) {
       // Rename
       item.second.name = item.first;
-      graph->tensors.push_back(item.second);
-      std::cout << "len(shape) = " << item.second.shape.size() << "\n";
+      state->graph->tensors.push_back(std::move(item.second));
     }
   }
 
   // Find id for input and output of the graph.
   {
-    for (const auto &input : inputs) {
-      int input_id = node_name_to_id_map[input];
-      graph->inputs.push_back(Slot(input, "input", input_id));
-      std::cout << "Input: " << input << ", id: " << input_id << "\n";
+    for (const auto &input : state->inputs) {
+      int input_id = state->node_name_to_id_map[input];
+      state->graph->inputs.push_back(Slot(input, "input", input_id));
+      NNVIEW_LOG_DEBUG(GRAPH) << "Input: " << input << ", id: " << input_id;
     }
 
-    for (const auto &output : outputs) {
-      int output_id = node_name_to_id_map[output];
-      graph->inputs.push_back(Slot(output, "output", output_id));
-      std::cout << "Output: " << output << ", id: " << output_id << "\n";
+    for (const auto &output : state->outputs) {
+      int output_id = state->node_name_to_id_map[output];
+      state->graph->inputs.push_back(Slot(output, "output", output_id));
+      NNVIEW_LOG_DEBUG(GRAPH) << "Output: " << output << ", id: " << output_id;
     }
   }
 
   // Establish the link of inputs and outpus for each layers.
-  {
-    for (size_t n = 0; n < graph->nodes.size(); n++) {
-      Node &node = graph->nodes[n];
-
-      for (size_t i = 0; i < node.inputs.size(); i++) {
-        const std::string &name = node.inputs[i].name;
-
-        int tensor_id = FindTensor(name, graph->tensors);
-        if (tensor_id == -1) {
-          std::cerr << "Input tensor \"" << name
-                    << "\" not found in the graph.\n";
-          return false;
-        } else {
-          std::cerr << "Input tensor \"" << name
-                    << "\" has connection. tensor id " << tensor_id << "\n";
+  if (!resolve_tensor_slots(state->graph)) {
+    return false;
+  }
+
+  // Built once here and handed to the caller when requested.
+  CsrGraph local_csr;
+  CsrGraph *csr = state->csr ? state->csr : &local_csr;
+  csr->build(*state->graph);
+
+  // `rank` in JSON is not reliable(or missing) depending on the exporter.
+  // A cycle is not fatal for viewing.
+  compute_node_depths(*csr, state->graph, option.num_threads);
+
+  NNVIEW_LOG_INFO(GRAPH) << "Loaded " << filename << " : "
+                         << state->graph->nodes.size() << " nodes, "
+                         << state->graph->tensors.size() << " tensors";
+
+  return true;
+}
+
+
+//
+// Builds Graph while streaming JSON events.
+// Fields of each element of `layers` are written to `LayerFields` as they are
+// read and the layer is converted to Node at the end of its object, so no
+// DOM is built and only one layer is kept in memory at a time.
+//
+class GraphSaxHandler : public JsonSaxHandler {
+ public:
+  explicit GraphSaxHandler(GraphParseState *state) : _state(state) {}
+
+  bool null_value() override { return non_string_value(); }
+  bool bool_value(bool b) override {
+    (void)b;
+    return non_string_value();
+  }
+  bool number_value(double d) override {
+    (void)d;
+    return non_string_value();
+  }
+
+  bool string_value(const std::string &s) override {
+    if (_in_layer) {
+      if (_depth == kLayerDepth) {
+        // Value of a layer key.
+        if (_key < kNumLayerStringKeys) {
+          _layer.set(_key, s);
+        } else if (_key == LAYER_KEY_OUTPUT_NAMES) {
+          _layer.output_names.clear();
         }
+      } else if (_in_output_names && (_depth == kLayerDepth + 1)) {
+        _layer.output_names.push_back(s);
+      }
+      return true;
+    }
 
-        node.inputs[i].id = tensor_id;
+    if ((_section == SECTION_INPUTS) && (_depth == 2)) {
+      _state->inputs.push_back(s);
+    } else if ((_section == SECTION_OUTPUTS) && (_depth == 3)) {
+      // Chainer-TRT's outpus is an array of array item.
+      // Just take the first one.
+      if (_output_item_index == 0) {
+        _state->outputs.push_back(s);
       }
+      _output_item_index++;
+    }
 
-      for (size_t o = 0; o < node.outputs.size(); o++) {
-        const std::string &name = node.outputs[o].name;
-
-        int tensor_id = FindTensor(name, graph->tensors);
-        if (tensor_id == -1) {
-          std::cerr << "Output tensor \"" << name
-                    << "\" not found in the graph.\n";
-          return false;
-        } else {
-          std::cerr << "Output tensor \"" << name
-                    << "\" has connection. tensor id " << tensor_id << "\n";
-        }
+    return true;
+  }
+
+  bool start_object() override {
+    if (_in_layer) {
+      container_value();
+    } else if ((_section == SECTION_LAYERS) && (_depth == kLayerDepth - 1)) {
+      _in_layer = true;
+      _key = LAYER_KEY_OTHER;
+      _layer.clear();
+    }
 
-        node.outputs[o].id = tensor_id;
+    _depth++;
+    return true;
+  }
+
+  bool key(const std::string &s) override {
+    if (_in_layer) {
+      if (_depth == kLayerDepth) {
+        _key = GetLayerKey(s);
+      }
+    } else if (_depth == 1) {
+      if (s.compare("inputs") == 0) {
+        _section = SECTION_INPUTS;
+      } else if (s.compare("outputs") == 0) {
+        _section = SECTION_OUTPUTS;
+      } else if (s.compare("layers") == 0) {
+        _section = SECTION_LAYERS;
+      } else {
+        _section = SECTION_OTHER;
       }
     }
+
+    return true;
   }
 
-  return true;
+  bool end_object() override {
+    _depth--;
+
+    if (_in_layer && (_depth == kLayerDepth - 1)) {
+      // End of a layer object.
+      _in_layer = false;
+      return ParseLayer(_layer, _state);
+    }
+
+    return true;
+  }
+
+  bool start_array() override {
+    if (_in_layer) {
+      if ((_depth == kLayerDepth) && (_key == LAYER_KEY_OUTPUT_NAMES)) {
+        // Last `output_names` wins as in json11.
+        _in_output_names = true;
+        _layer.output_names.clear();
+      } else {
+        container_value();
+      }
+    } else if ((_section == SECTION_OUTPUTS) && (_depth == 2)) {
+      _output_item_index = 0;
+    }
+
+    _depth++;
+    return true;
+  }
+
+  bool end_array() override {
+    _depth--;
+
+    if (_in_layer && (_depth == kLayerDepth)) {
+      _in_output_names = false;
+    }
+
+    return true;
+  }
+
+ private:
+  enum Section {
+    SECTION_OTHER,
+    SECTION_INPUTS,
+    SECTION_OUTPUTS,
+    SECTION_LAYERS,
+  };
+
+  // Depth of JSON containers inside a layer object.
+  static constexpr int kLayerDepth = 3;
+
+  // A value other than string is the same as a missing key, as
+  // `Json::is_string` in `GetLayerFields`.
+  bool non_string_value() {
+    if (_in_layer && (_depth == kLayerDepth)) {
+      reset_key();
+    }
+    return true;
+  }
+
+  // Object or array(other than `output_names`) starts in a layer.
+  void container_value() {
+    if (_depth == kLayerDepth) {
+      reset_key();
+    }
+  }
+
+  void reset_key() {
+    if (_key < kNumLayerStringKeys) {
+      _layer.reset(_key);
+    } else if (_key == LAYER_KEY_OUTPUT_NAMES) {
+      _layer.output_names.clear();
+    }
+  }
+
+  GraphParseState *_state;
+
+  Section _section = SECTION_OTHER;
+  int _depth = 0;  // Depth of JSON containers.
+  size_t _output_item_index = 0;
+
+  // Layer currently being read.
+  bool _in_layer = false;
+  bool _in_output_names = false;
+  LayerKey _key = LAYER_KEY_OTHER;
+  LayerFields _layer;
+};
+
+bool load_json_graph(const std::string &filename, Graph *graph,
+                     const GraphLoaderOption &option, CsrGraph *csr) {
+  NNVIEW_TRACE_SCOPE_DETAIL("load_json_graph", filename);
+
+  if (graph == nullptr) {
+    NNVIEW_LOG_ERROR(GRAPH) << "`graph` is nullptr";
+    return false;
+  }
+
+  std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    NNVIEW_LOG_ERROR(GRAPH) << "Failed to open graph file : " << filename;
+    return false;
+  }
+
+  if (csr) {
+    csr->clear();
+  }
+
+  GraphParseState state;
+  state.graph = graph;
+  state.csr = csr;
+
+  graph->nodes.clear();
+
+  if (option.streaming_json) {
+    GraphSaxHandler handler(&state);
+
+    std::string err;
+    bool ok;
+    {
+      NNVIEW_TRACE_SCOPE("parse_json");
+      ok = parse_json_sax(ifs, &handler, &err);
+    }
+    if (!ok) {
+      NNVIEW_LOG_ERROR(GRAPH) << "JSON parse error. filename: " << filename
+                              << " err: " << err;
+      return false;
+    }
+
+    return FinalizeGraph(filename, option, &state);
+  }
+
+  std::string err;
+  Json json;
+  {
+    NNVIEW_TRACE_SCOPE("parse_json");
+
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    ifs.close();
+
+    json = Json::parse(ss.str(), err);
+  }
+
+  if (!err.empty()) {
+    NNVIEW_LOG_ERROR(GRAPH) << "JSON parse error. filename: " << filename
+                            << " err: " << err;
+    return false;
+  }
+
+  for (const auto &input : json["inputs"].array_items()) {
+    if (input.is_string()) {
+      state.inputs.push_back(input.string_value());
+    }
+  }
+
+  for (const auto &output : json["outputs"].array_items()) {
+    // Chainer-TRT's outpus is an array of array item.
+    if (output.is_array() && !output.array_items().empty()) {
+      // Just take the first one.
+      auto &item = output.array_items()[0];
+      if (item.is_string()) {
+        state.outputs.push_back(item.string_value());
+      }
+    }
+  }
+
+  // layers
+  LayerFields fields;
+  for (const auto &layer : json["layers"].array_items()) {
+    if (!layer.is_object()) {
+      continue;
+    }
+    GetLayerFields(layer, &fields);
+    if (!ParseLayer(fields, &state)) {
+      return false;
+    }
+  }
+
+  return FinalizeGraph(filename, option, &state);
 }
 
 }  // namespace nnview
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "datatypes.h"
+#include "graph-csr.hh"
 
 //
 // Simple JSON graph loader. Supports JSON graph description generated by
@@ -11,7 +12,57 @@
 //
 namespace nnview {
 
-bool load_json_graph(const std::string &filename, Graph *graph);
+struct GraphLoaderOption {
+  // Map weights/tensor files with mmap instead of reading them into memory.
+  bool use_mmap = true;
+
+  // Number of threads for reading weights/tensor files.
+  // <= 0 : Use all hardware threads. 1 : Read files sequentially.
+  int num_threads = -1;
+
+  // Read only the headers of weights/tensor files. Payload is read on demand
+  // with `load_tensor_data`.
+  bool lazy = false;
+
+  // Parse JSON with the streaming parser. Layers are converted to Node as
+  // they are read, without building DOM of the whole file.
+  // false = Parse with json11.
+  bool streaming_json = true;
+
+  // Do not open weights/tensor files. Tensors only have names(no shape and
+  // payload). Used to view the structure of a model whose weights are not
+  // available, and to measure JSON parsing without file I/O.
+  bool structure_only = false;
+};
+
+//
+// Load `filename` into `graph`.
+// CsrGraph of the loaded graph is built to compute node depths. When `csr`
+// is given, it is stored there so that the caller need not build it again.
+//
+bool load_json_graph(const std::string &filename, Graph *graph,
+                     const GraphLoaderOption &option = GraphLoaderOption(),
+                     CsrGraph *csr = nullptr);
+
+//
+// Resolve tensor id of each input/output slot of nodes by tensor name.
+// Uses a hash index of tensor names, so it runs in O(slots + tensors).
+// Returns false when a slot refers the tensor which does not exist.
+//
+bool resolve_tensor_slots(Graph *graph);
+
+//
+// Compute `Node::depth` as the longest path from source nodes, following
+// connections from the producer to the consumers of each tensor. `csr` must
+// be built from `graph` after its slots are resolved.
+// Runs in O(nodes + slots) with Kahn's algorithm. Each frontier of nodes
+// whose predecessors are all visited is processed in parallel when it is
+// wide enough.
+// Returns false when the graph has a cycle. Depths are still assigned, with
+// the cycle broken at an arbitrary node.
+//
+bool compute_node_depths(const CsrGraph &csr, Graph *graph,
+                         int num_threads = -1);
 
 }  // namespace nnview
 
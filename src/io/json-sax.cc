@@ -0,0 +1,350 @@
+#include "io/json-sax.hh"
+
+#include <cstdlib>
+#include <vector>
+
+namespace nnview {
+
+JsonSaxHandler::~JsonSaxHandler() {}
+
+namespace {
+
+// Deep enough for any graph description. Prevents stack overflow on
+// malicious input.
+constexpr int kMaxDepth = 512;
+
+constexpr size_t kChunkSize = 64 * 1024;
+
+class ChunkReader {
+ public:
+  explicit ChunkReader(std::istream &is) : _is(is), _buf(kChunkSize) {}
+
+  int peek() {
+    if ((_pos == _len) && !fill()) {
+      return -1;
+    }
+    return int(static_cast<unsigned char>(_buf[_pos]));
+  }
+
+  int get() {
+    int c = peek();
+    if (c >= 0) {
+      _pos++;
+      if (c == '\n') {
+        _line++;
+      }
+    }
+    return c;
+  }
+
+  void skip_whitespace() {
+    for (;;) {
+      int c = peek();
+      if ((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')) {
+        get();
+      } else {
+        break;
+      }
+    }
+  }
+
+  size_t line() const { return _line; }
+
+ private:
+  bool fill() {
+    if (!_is) {
+      return false;
+    }
+    _is.read(_buf.data(), std::streamsize(_buf.size()));
+    _len = size_t(_is.gcount());
+    _pos = 0;
+    return _len > 0;
+  }
+
+  std::istream &_is;
+  std::vector<char> _buf;
+  size_t _pos = 0;
+  size_t _len = 0;
+  size_t _line = 1;
+};
+
+class SaxParser {
+ public:
+  SaxParser(std::istream &is, JsonSaxHandler *handler)
+      : _reader(is), _handler(handler) {}
+
+  bool parse() {
+    _reader.skip_whitespace();
+    if (!parse_value(0)) {
+      return false;
+    }
+
+    _reader.skip_whitespace();
+    if (_reader.peek() != -1) {
+      return error("Unexpected trailing characters");
+    }
+
+    return true;
+  }
+
+  const std::string &err() const { return _err; }
+
+ private:
+  bool error(const std::string &msg) {
+    _err = msg + " at line " + std::to_string(_reader.line());
+    return false;
+  }
+
+  bool expect(int expected) {
+    _reader.skip_whitespace();
+    if (_reader.get() != expected) {
+      return error(std::string("Expected '") + char(expected) + "'");
+    }
+    return true;
+  }
+
+  bool parse_literal(const char *literal) {
+    for (const char *p = literal; *p; p++) {
+      if (_reader.get() != *p) {
+        return error(std::string("Invalid literal. Expected ") + literal);
+      }
+    }
+    return true;
+  }
+
+  bool parse_hex4(unsigned int *code) {
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++) {
+      int c = _reader.get();
+      v <<= 4;
+      if ((c >= '0') && (c <= '9')) {
+        v |= unsigned(c - '0');
+      } else if ((c >= 'a') && (c <= 'f')) {
+        v |= unsigned(c - 'a' + 10);
+      } else if ((c >= 'A') && (c <= 'F')) {
+        v |= unsigned(c - 'A' + 10);
+      } else {
+        return error("Invalid \\u escape");
+      }
+    }
+    (*code) = v;
+    return true;
+  }
+
+  static void append_utf8(unsigned int code, std::string *s) {
+    if (code < 0x80) {
+      s->push_back(char(code));
+    } else if (code < 0x800) {
+      s->push_back(char(0xC0 | (code >> 6)));
+      s->push_back(char(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      s->push_back(char(0xE0 | (code >> 12)));
+      s->push_back(char(0x80 | ((code >> 6) & 0x3F)));
+      s->push_back(char(0x80 | (code & 0x3F)));
+    } else {
+      s->push_back(char(0xF0 | (code >> 18)));
+      s->push_back(char(0x80 | ((code >> 12) & 0x3F)));
+      s->push_back(char(0x80 | ((code >> 6) & 0x3F)));
+      s->push_back(char(0x80 | (code & 0x3F)));
+    }
+  }
+
+  // Parse string after the opening '"'. Result is stored to `_str`, whose
+  // capacity is reused between strings.
+  bool parse_string() {
+    _str.clear();
+
+    for (;;) {
+      int c = _reader.get();
+      if (c == -1) {
+        return error("Unterminated string");
+      } else if (c == '"') {
+        return true;
+      } else if (c < 0x20) {
+        return error("Control character in string");
+      } else if (c != '\\') {
+        _str.push_back(char(c));
+        continue;
+      }
+
+      c = _reader.get();
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          _str.push_back(char(c));
+          break;
+        case 'b':
+          _str.push_back('\b');
+          break;
+        case 'f':
+          _str.push_back('\f');
+          break;
+        case 'n':
+          _str.push_back('\n');
+          break;
+        case 'r':
+          _str.push_back('\r');
+          break;
+        case 't':
+          _str.push_back('\t');
+          break;
+        case 'u': {
+          unsigned int code = 0;
+          if (!parse_hex4(&code)) {
+            return false;
+          }
+          // Surrogate pair
+          if ((code >= 0xD800) && (code <= 0xDBFF)) {
+            unsigned int low = 0;
+            if ((_reader.get() != '\\') || (_reader.get() != 'u') ||
+                !parse_hex4(&low) || (low < 0xDC00) || (low > 0xDFFF)) {
+              return error("Invalid surrogate pair");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          append_utf8(code, &_str);
+          break;
+        }
+        default:
+          return error("Invalid escape sequence");
+      }
+    }
+  }
+
+  bool parse_number() {
+    std::string num;
+    for (;;) {
+      int c = _reader.peek();
+      if (((c >= '0') && (c <= '9')) || (c == '-') || (c == '+') ||
+          (c == '.') || (c == 'e') || (c == 'E')) {
+        num.push_back(char(_reader.get()));
+      } else {
+        break;
+      }
+    }
+
+    char *end = nullptr;
+    double d = std::strtod(num.c_str(), &end);
+    if (num.empty() || (end != (num.c_str() + num.size()))) {
+      return error("Invalid number : " + num);
+    }
+
+    return _handler->number_value(d);
+  }
+
+  bool parse_object(int depth) {
+    if (!_handler->start_object()) {
+      return false;
+    }
+
+    _reader.skip_whitespace();
+    if (_reader.peek() == '}') {
+      _reader.get();
+      return _handler->end_object();
+    }
+
+    for (;;) {
+      if (!expect('"') || !parse_string()) {
+        return false;
+      }
+      if (!_handler->key(_str)) {
+        return false;
+      }
+      if (!expect(':')) {
+        return false;
+      }
+
+      _reader.skip_whitespace();
+      if (!parse_value(depth + 1)) {
+        return false;
+      }
+
+      _reader.skip_whitespace();
+      int c = _reader.get();
+      if (c == '}') {
+        return _handler->end_object();
+      } else if (c != ',') {
+        return error("Expected ',' or '}' in object");
+      }
+    }
+  }
+
+  bool parse_array(int depth) {
+    if (!_handler->start_array()) {
+      return false;
+    }
+
+    _reader.skip_whitespace();
+    if (_reader.peek() == ']') {
+      _reader.get();
+      return _handler->end_array();
+    }
+
+    for (;;) {
+      _reader.skip_whitespace();
+      if (!parse_value(depth + 1)) {
+        return false;
+      }
+
+      _reader.skip_whitespace();
+      int c = _reader.get();
+      if (c == ']') {
+        return _handler->end_array();
+      } else if (c != ',') {
+        return error("Expected ',' or ']' in array");
+      }
+    }
+  }
+
+  bool parse_value(int depth) {
+    if (depth > kMaxDepth) {
+      return error("JSON nesting is too deep");
+    }
+
+    int c = _reader.peek();
+    switch (c) {
+      case '{':
+        _reader.get();
+        return parse_object(depth);
+      case '[':
+        _reader.get();
+        return parse_array(depth);
+      case '"':
+        _reader.get();
+        return parse_string() && _handler->string_value(_str);
+      case 't':
+        return parse_literal("true") && _handler->bool_value(true);
+      case 'f':
+        return parse_literal("false") && _handler->bool_value(false);
+      case 'n':
+        return parse_literal("null") && _handler->null_value();
+      case -1:
+        return error("Unexpected end of input");
+      default:
+        if ((c == '-') || ((c >= '0') && (c <= '9'))) {
+          return parse_number();
+        }
+        return error(std::string("Unexpected character '") + char(c) + "'");
+    }
+  }
+
+  ChunkReader _reader;
+  JsonSaxHandler *_handler;
+  std::string _str;
+  std::string _err;
+};
+
+}  // namespace
+
+bool parse_json_sax(std::istream &is, JsonSaxHandler *handler,
+                    std::string *err) {
+  SaxParser parser(is, handler);
+  bool ret = parser.parse();
+  if (!ret && err) {
+    (*err) = parser.err();
+  }
+  return ret;
+}
+
+}  // namespace nnview
@@ -0,0 +1,41 @@
+#ifndef NNVIEW_IO_JSON_SAX_H_
+#define NNVIEW_IO_JSON_SAX_H_
+
+#include <istream>
+#include <string>
+
+//
+// Streaming(SAX style) JSON parser.
+// Reads input in fixed size chunks and reports each value through
+// `JsonSaxHandler` without building a DOM, so memory usage does not depend
+// on the size of JSON file.
+//
+namespace nnview {
+
+class JsonSaxHandler {
+ public:
+  virtual ~JsonSaxHandler();
+
+  // Return false to stop parsing.
+  virtual bool null_value() = 0;
+  virtual bool bool_value(bool b) = 0;
+  virtual bool number_value(double d) = 0;
+  virtual bool string_value(const std::string &s) = 0;
+  virtual bool start_object() = 0;
+  virtual bool key(const std::string &s) = 0;
+  virtual bool end_object() = 0;
+  virtual bool start_array() = 0;
+  virtual bool end_array() = 0;
+};
+
+//
+// Parse JSON from `is` and report events to `handler`.
+// Returns false on syntax error(`err` is filled) or when the handler stops
+// parsing(`err` is empty).
+//
+bool parse_json_sax(std::istream &is, JsonSaxHandler *handler,
+                    std::string *err);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_JSON_SAX_H_
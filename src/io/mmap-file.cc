@@ -0,0 +1,130 @@
+#include "io/mmap-file.hh"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nnview {
+
+MappedFile::~MappedFile() { close(); }
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &filename, std::string *err) {
+  close();
+
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (err) (*err) = "Failed to open file : " + filename;
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || (file_size.QuadPart == 0)) {
+    if (err) (*err) = "Failed to get file size or file is empty : " + filename;
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    if (err) (*err) = "Failed to create file mapping : " + filename;
+    CloseHandle(file);
+    return false;
+  }
+
+  void *p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (p == nullptr) {
+    if (err) (*err) = "Failed to map file : " + filename;
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  _file_handle = file;
+  _mapping_handle = mapping;
+  _data = reinterpret_cast<const uint8_t *>(p);
+  _size = size_t(file_size.QuadPart);
+
+  return true;
+}
+
+void MappedFile::close() {
+  if (_data) {
+    UnmapViewOfFile(_data);
+  }
+  if (_mapping_handle) {
+    CloseHandle(_mapping_handle);
+  }
+  if (_file_handle) {
+    CloseHandle(_file_handle);
+  }
+
+  _data = nullptr;
+  _size = 0;
+  _file_handle = nullptr;
+  _mapping_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filename, std::string *err) {
+  close();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    if (err) (*err) = "Failed to open file : " + filename;
+    return false;
+  }
+
+  struct stat sb;
+  if ((fstat(fd, &sb) == -1) || (sb.st_size <= 0)) {
+    if (err) (*err) = "Failed to get file size or file is empty : " + filename;
+    ::close(fd);
+    return false;
+  }
+
+  const size_t size = size_t(sb.st_size);
+
+  void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping stays valid after closing the descriptor.
+  ::close(fd);
+
+  if (p == MAP_FAILED) {
+    if (err) (*err) = "Failed to mmap file : " + filename;
+    return false;
+  }
+
+  _data = reinterpret_cast<const uint8_t *>(p);
+  _size = size;
+
+  return true;
+}
+
+void MappedFile::close() {
+  if (_data) {
+    munmap(const_cast<uint8_t *>(_data), _size);
+  }
+
+  _data = nullptr;
+  _size = 0;
+}
+
+#endif
+
+}  // namespace nnview
@@ -0,0 +1,44 @@
+#ifndef NNVIEW_IO_MMAP_FILE_H_
+#define NNVIEW_IO_MMAP_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// Read-only memory-mapped file.
+// Pages are brought in by the OS when they are actually accessed, so opening
+// a huge weights file is cheap.
+//
+namespace nnview {
+
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Returns false when the file cannot be opened or mapped.
+  // `err` is filled with the reason on failure.
+  bool open(const std::string &filename, std::string *err);
+
+  void close();
+
+  const uint8_t *data() const { return _data; }
+  size_t size() const { return _size; }
+
+ private:
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+
+#if defined(_WIN32)
+  void *_file_handle = nullptr;
+  void *_mapping_handle = nullptr;
+#endif
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_IO_MMAP_FILE_H_
@@ -1,31 +1,54 @@
 #include "io/weights-loader.hh"
+#include "io/mmap-file.hh"
+#include "log.hh"
+#include "trace.hh"
 
-#include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <iostream>
+#include <memory>
 
 namespace nnview {
 
-bool load_weights(const std::string &filename, Tensor *tensor) {
-  std::ifstream ifs(filename, std::ios::in | std::ios::binary);
-  if (!ifs) {
-    std::cerr << "Failed to open file : " << filename << std::endl;
-    return false;
+// `datasize` line is either the size of element in bytes or the name of data
+// type.
+static bool ParseDataType(const std::string &datasize_line, DataType *dtype) {
+  std::string s = datasize_line;
+  // Remove trailing CR/spaces
+  while (!s.empty() && ((s.back() == '\r') || (s.back() == ' '))) {
+    s.pop_back();
   }
 
-  std::string datasize_line;
-  std::getline(ifs, datasize_line);
-
-  int datasize = std::stoi(datasize_line);
-  if (datasize != 4) {
-    std::cerr << "Data size must be 4, but got " << datasize_line << std::endl;
+  if ((s.compare("4") == 0) || (s.compare("float32") == 0)) {
+    (*dtype) = DATA_TYPE_FLOAT32;
+  } else if ((s.compare("2") == 0) || (s.compare("float16") == 0) ||
+             (s.compare("half") == 0)) {
+    (*dtype) = DATA_TYPE_FLOAT16;
+  } else if (s.compare("bfloat16") == 0) {
+    (*dtype) = DATA_TYPE_BFLOAT16;
+  } else if ((s.compare("1") == 0) || (s.compare("int8") == 0)) {
+    (*dtype) = DATA_TYPE_INT8;
+  } else if (s.compare("int4") == 0) {
+    (*dtype) = DATA_TYPE_INT4;
+  } else {
     return false;
   }
 
-  std::cout << "datasize " << datasize << "\n";
+  return true;
+}
 
-  std::string shape_line;
-  std::getline(ifs, shape_line);
+// Parse `datasize` and `shape` lines of .weights header.
+static bool ParseHeader(const std::string &datasize_line,
+                        const std::string &shape_line, DataType *dtype_out,
+                        std::vector<int> *shape_out, size_t *num_items_out) {
+  DataType dtype;
+  if (!ParseDataType(datasize_line, &dtype)) {
+    NNVIEW_LOG_ERROR(IO) << "Data size must be 4, 2, 1 or data type "
+                            "name(float32, float16, bfloat16, int8, int4), "
+                            "but got "
+                         << datasize_line;
+    return false;
+  }
 
   // Up to 5D tensor
   int d[5];
@@ -35,45 +58,208 @@ bool load_weights(const std::string &filename, Tensor *tensor) {
   size_t num_items = 1;
   std::vector<int> shape;
   for (int i = 0; i < n; i++) {
-    assert(d[i] > 0);
+    if (d[i] <= 0) {
+      NNVIEW_LOG_ERROR(IO) << "Invalid shape: " << shape_line;
+      return false;
+    }
     shape.push_back(d[i]);
     num_items *= size_t(d[i]);
   }
 
-  std::cout << "dim : " << shape.size() << std::endl;
-  for (size_t i = 0; i < shape.size(); i++) {
-    std::cout << "  [" << i << "] = " << shape[i] << std::endl;
-  }
-
   if (shape.size() == 0) {
-    std::cerr << "Failed to parse shape information: " << shape_line
-              << std::endl;
+    NNVIEW_LOG_ERROR(IO) << "Failed to parse shape information: "
+                         << shape_line;
     return false;
   }
 
+  NNVIEW_LOG_DEBUG(IO) << "datatype " << get_data_type_name(dtype)
+                       << ", shape [" << shape_line
+                       << "], num_items: " << num_items;
+
   if (shape.size() == 1) {
     // force create 2D tensor
     shape.push_back(1);
   }
 
-  std::cout << "num_items: " << num_items << "\n";
+  (*dtype_out) = dtype;
+  (*shape_out) = shape;
+  (*num_items_out) = num_items;
+
+  return true;
+}
+
+// Read a line terminated by '\n' from `data` at `*offset` and advance
+// `*offset` past it. Returns false when there is no '\n'.
+static bool ReadLine(const uint8_t *data, size_t size, size_t *offset,
+                     std::string *line) {
+  const uint8_t *begin = data + (*offset);
+  const void *end = memchr(begin, '\n', size - (*offset));
+  if (!end) {
+    return false;
+  }
+
+  const size_t len = size_t(static_cast<const uint8_t *>(end) - begin);
+  line->assign(reinterpret_cast<const char *>(begin), len);
+  (*offset) += len + 1;
+
+  return true;
+}
+
+// Refer the payload in the mapped `file` from `tensor`.
+static bool SetMappedPayload(const std::shared_ptr<MappedFile> &file,
+                             Tensor *tensor) {
+  const size_t payload_size = tensor->data_size();
+
+  // Payload pages are read by the OS on the first access to
+  // `Tensor::data`.
+  if ((file->size() < tensor->offset) ||
+      ((file->size() - tensor->offset) < payload_size)) {
+    NNVIEW_LOG_ERROR(IO) << "Failed to read [" << payload_size
+                         << "] bytes. only ["
+                         << ((file->size() < tensor->offset)
+                                 ? size_t(0)
+                                 : (file->size() - tensor->offset))
+                         << "] could be read : " << tensor->filename;
+    return false;
+  }
+
+  tensor->data = file->data() + tensor->offset;
+  tensor->storage = file;
+
+  return true;
+}
+
+bool load_weights_header(const std::string &filename, Tensor *tensor) {
+  NNVIEW_TRACE_SCOPE_DETAIL("load_weights_header", filename);
+
+  std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    NNVIEW_LOG_ERROR(IO) << "Failed to open file : " << filename;
+    return false;
+  }
+
+  std::string datasize_line;
+  std::getline(ifs, datasize_line);
 
-  tensor->data.resize(num_items);
+  std::string shape_line;
+  std::getline(ifs, shape_line);
 
+  if (!ifs) {
+    NNVIEW_LOG_ERROR(IO) << "Failed to read header : " << filename;
+    return false;
+  }
+
+  DataType dtype;
+  std::vector<int> shape;
+  size_t num_items = 0;
+  if (!ParseHeader(datasize_line, shape_line, &dtype, &shape, &num_items)) {
+    return false;
+  }
+
+  tensor->dtype = dtype;
   tensor->shape = shape;
   tensor->name = filename;
+  tensor->filename = filename;
+  tensor->offset = size_t(ifs.tellg());
+  tensor->storage.reset();
+  tensor->data = nullptr;
+
+  return true;
+}
+
+bool load_tensor_data(Tensor *tensor, const bool use_mmap) {
+  NNVIEW_TRACE_SCOPE_DETAIL("load_tensor_data", tensor->filename);
+
+  const size_t payload_size = tensor->data_size();
+
+  if (use_mmap) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+
+    std::string err;
+    if (!file->open(tensor->filename, &err)) {
+      NNVIEW_LOG_ERROR(IO) << err;
+      return false;
+    }
 
-  ifs.read(reinterpret_cast<char *>(tensor->data.data()),
-           int64_t(num_items) * datasize);
+    return SetMappedPayload(file, tensor);
+  }
+
+  std::ifstream ifs(tensor->filename, std::ios::in | std::ios::binary);
+  if (!ifs) {
+    NNVIEW_LOG_ERROR(IO) << "Failed to open file : " << tensor->filename;
+    return false;
+  }
+
+  ifs.seekg(std::streamoff(tensor->offset));
+
+  // Allocate the buffer exactly once. Not zero-initialized since it is
+  // overwritten by the read below.
+  std::shared_ptr<uint8_t> buffer(new uint8_t[payload_size],
+                                  std::default_delete<uint8_t[]>());
+
+  ifs.read(reinterpret_cast<char *>(buffer.get()),
+           std::streamsize(payload_size));
 
   if (!ifs) {
-    std::cerr << "Failed to read ["
-              << std::to_string(int64_t(num_items) * datasize)
-              << "] bytes. only [" << ifs.gcount() << "] could be read.\n";
+    NNVIEW_LOG_ERROR(IO) << "Failed to read [" << payload_size
+                         << "] bytes. only [" << ifs.gcount()
+                         << "] could be read : " << tensor->filename;
     return false;
   }
 
+  tensor->data = buffer.get();
+  tensor->storage = buffer;
+
   return true;
 }
 
+bool load_weights(const std::string &filename, Tensor *tensor) {
+  NNVIEW_TRACE_SCOPE_DETAIL("load_weights", filename);
+
+  if (!load_weights_header(filename, tensor)) {
+    return false;
+  }
+
+  return load_tensor_data(tensor, /* use_mmap */ false);
+}
+
+bool load_weights_mmap(const std::string &filename, Tensor *tensor) {
+  NNVIEW_TRACE_SCOPE_DETAIL("load_weights_mmap", filename);
+
+  // Map the file once and read the header from the mapping.
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+
+  std::string err;
+  if (!file->open(filename, &err)) {
+    NNVIEW_LOG_ERROR(IO) << err;
+    return false;
+  }
+
+  size_t offset = 0;
+  std::string datasize_line;
+  std::string shape_line;
+  if (!ReadLine(file->data(), file->size(), &offset, &datasize_line) ||
+      !ReadLine(file->data(), file->size(), &offset, &shape_line)) {
+    NNVIEW_LOG_ERROR(IO) << "Failed to read header : " << filename;
+    return false;
+  }
+
+  DataType dtype;
+  std::vector<int> shape;
+  size_t num_items = 0;
+  if (!ParseHeader(datasize_line, shape_line, &dtype, &shape, &num_items)) {
+    return false;
+  }
+
+  tensor->dtype = dtype;
+  tensor->shape = shape;
+  tensor->name = filename;
+  tensor->filename = filename;
+  tensor->offset = offset;
+  tensor->storage.reset();
+  tensor->data = nullptr;
+
+  return SetMappedPayload(file, tensor);
+}
+
 }  // namespace nnview
@@ -7,18 +7,40 @@
 
 //
 // Simple weights loader for .weights file generated by chainer-trt.
-// Assume datatype is float32
 //
 // format is:
 //
 // datasize\n
-// size0 size1 ...\n
+// size0,size1,...\n
 // <<binary>>
 //
+// `datasize` is 4(float32), 2(float16) or 1(int8), or the name of data type
+// (float32, float16, bfloat16, int8, int4). Data is kept in its native width.
+// int4 packs 2 signed values per byte, lower 4 bits first.
+//
 namespace nnview {
 
 bool load_weights(const std::string &filename, Tensor *tensor);
 
+//
+// Same as `load_weights`, but the payload is not copied. `tensor` refers the
+// memory-mapped file, so only the header is read at open time.
+//
+bool load_weights_mmap(const std::string &filename, Tensor *tensor);
+
+//
+// Read only the header(shape) of .weights file. The payload location is
+// recorded in `Tensor::filename` and `Tensor::offset`, and can be read later
+// with `load_tensor_data`.
+//
+bool load_weights_header(const std::string &filename, Tensor *tensor);
+
+//
+// Read(or map) the payload of a tensor whose header was read by
+// `load_weights_header`.
+//
+bool load_tensor_data(Tensor *tensor, bool use_mmap);
+
 }  // namespace nnview
 
 #endif  // NNVIEW_IO_WEIGHT_LOADER_H_
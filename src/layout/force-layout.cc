@@ -0,0 +1,341 @@
+#include "layout/force-layout.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "parallel.hh"
+
+namespace nnview {
+
+namespace {
+
+// Deeper cells hold all nodes reaching them, so (almost) coincident nodes do
+// not subdivide forever.
+constexpr int kMaxTreeDepth = 24;
+
+// Relative strength of repulsion.
+constexpr float kRepulsion = 0.2f;
+
+// Step length is multiplied or divided by this factor.
+constexpr float kCooling = 0.9f;
+
+// # of nodes of which forces are computed by a task.
+constexpr size_t kChunkSize = 256;
+
+}  // namespace
+
+void ForceLayout::clear() {
+  _running = false;
+  _iteration = 0;
+  _next_body = 0;
+  _tree_ready = false;
+  _adj_offsets.clear();
+  _adj_indices.clear();
+  _xs.clear();
+  _ys.clear();
+  _fxs.clear();
+  _fys.clear();
+}
+
+void ForceLayout::reset(const LayoutGraph &graph, const std::vector<float> &xs,
+                        const std::vector<float> &ys,
+                        const ForceLayoutOption &option) {
+  clear();
+
+  const size_t num_nodes = graph.num_nodes();
+
+  _option = option;
+  _option.edge_length = std::max(1.0f, _option.edge_length);
+  _option.num_threads = get_num_threads(_option.num_threads);
+
+  _xs = xs;
+  _ys = ys;
+  _xs.resize(num_nodes, 0.0f);
+  _ys.resize(num_nodes, 0.0f);
+  _fxs.assign(num_nodes, 0.0f);
+  _fys.assign(num_nodes, 0.0f);
+
+  _adj_offsets.assign(num_nodes + 1, 0);
+  for (const auto &e : graph.edges) {
+    if ((e.first < 0) || (e.second < 0) || (size_t(e.first) >= num_nodes) ||
+        (size_t(e.second) >= num_nodes) || (e.first == e.second)) {
+      continue;
+    }
+    _adj_offsets[size_t(e.first) + 1]++;
+    _adj_offsets[size_t(e.second) + 1]++;
+  }
+  for (size_t i = 0; i < num_nodes; i++) {
+    _adj_offsets[i + 1] += _adj_offsets[i];
+  }
+
+  _adj_indices.resize(_adj_offsets[num_nodes]);
+  std::vector<size_t> cursor(_adj_offsets.begin(), _adj_offsets.end() - 1);
+  for (const auto &e : graph.edges) {
+    if ((e.first < 0) || (e.second < 0) || (size_t(e.first) >= num_nodes) ||
+        (size_t(e.second) >= num_nodes) || (e.first == e.second)) {
+      continue;
+    }
+    _adj_indices[cursor[size_t(e.first)]++] = e.second;
+    _adj_indices[cursor[size_t(e.second)]++] = e.first;
+  }
+
+  _step_length = _option.edge_length;
+  _energy = 0.0;
+  _progress = 0;
+  _running = (num_nodes > 1);
+}
+
+int ForceLayout::Subdivide(int cell) {
+  const size_t c = size_t(cell);
+  const int first = int(_cell_sizes.size());
+
+  const float half = 0.5f * _cell_sizes[c];
+  for (int q = 0; q < 4; q++) {
+    _cell_cxs.push_back(_cell_cxs[c] + ((q & 1) ? 0.5f : -0.5f) * half);
+    _cell_cys.push_back(_cell_cys[c] + ((q & 2) ? 0.5f : -0.5f) * half);
+    _cell_sizes.push_back(half);
+    _cell_mxs.push_back(0.0f);
+    _cell_mys.push_back(0.0f);
+    _cell_masses.push_back(0.0f);
+    _cell_children.push_back(-1);
+    _cell_bodies.push_back(-1);
+  }
+
+  _cell_children[c] = first;
+
+  return first;
+}
+
+int ForceLayout::Quadrant(int cell, int body) const {
+  return ((_xs[size_t(body)] >= _cell_cxs[size_t(cell)]) ? 1 : 0) +
+         ((_ys[size_t(body)] >= _cell_cys[size_t(cell)]) ? 2 : 0);
+}
+
+void ForceLayout::BuildTree() {
+  const size_t num_nodes = _xs.size();
+
+  float min_x = _xs[0], max_x = _xs[0];
+  float min_y = _ys[0], max_y = _ys[0];
+  for (size_t i = 1; i < num_nodes; i++) {
+    min_x = std::min(min_x, _xs[i]);
+    max_x = std::max(max_x, _xs[i]);
+    min_y = std::min(min_y, _ys[i]);
+    max_y = std::max(max_y, _ys[i]);
+  }
+
+  _cell_cxs.assign(1, 0.5f * (min_x + max_x));
+  _cell_cys.assign(1, 0.5f * (min_y + max_y));
+  _cell_sizes.assign(1, std::max(max_x - min_x, max_y - min_y) + 1.0f);
+  _cell_mxs.assign(1, 0.0f);
+  _cell_mys.assign(1, 0.0f);
+  _cell_masses.assign(1, 0.0f);
+  _cell_children.assign(1, -1);
+  _cell_bodies.assign(1, -1);
+  _body_nexts.assign(num_nodes, -1);
+
+  for (size_t i = 0; i < num_nodes; i++) {
+    const int body = int(i);
+
+    int cell = 0;
+    int depth = 0;
+    while (true) {
+      if (_cell_children[size_t(cell)] >= 0) {
+        cell = _cell_children[size_t(cell)] + Quadrant(cell, body);
+        depth++;
+        continue;
+      }
+
+      const int occupant = _cell_bodies[size_t(cell)];
+      if ((occupant < 0) || (depth >= kMaxTreeDepth)) {
+        _body_nexts[i] = occupant;
+        _cell_bodies[size_t(cell)] = body;
+        break;
+      }
+
+      // Split the leaf and push down its node, then retry.
+      const int first = Subdivide(cell);
+      _cell_bodies[size_t(cell)] = -1;
+      _cell_bodies[size_t(first + Quadrant(cell, occupant))] = occupant;
+    }
+  }
+
+  // Children are created after their parent.
+  for (size_t c = _cell_sizes.size(); c > 0; c--) {
+    const size_t cell = c - 1;
+
+    float mass = 0.0f, mx = 0.0f, my = 0.0f;
+    if (_cell_children[cell] >= 0) {
+      for (size_t q = 0; q < 4; q++) {
+        const size_t child = size_t(_cell_children[cell]) + q;
+        mass += _cell_masses[child];
+        mx += _cell_masses[child] * _cell_mxs[child];
+        my += _cell_masses[child] * _cell_mys[child];
+      }
+    } else {
+      for (int b = _cell_bodies[cell]; b >= 0; b = _body_nexts[size_t(b)]) {
+        mass += 1.0f;
+        mx += _xs[size_t(b)];
+        my += _ys[size_t(b)];
+      }
+    }
+
+    _cell_masses[cell] = mass;
+    _cell_mxs[cell] = (mass > 0.0f) ? (mx / mass) : _cell_cxs[cell];
+    _cell_mys[cell] = (mass > 0.0f) ? (my / mass) : _cell_cys[cell];
+  }
+}
+
+void ForceLayout::ComputeForces(size_t begin, size_t end) {
+  const float k = _option.edge_length;
+  const float repulsion = kRepulsion * k * k;
+  const float theta2 = _option.theta * _option.theta;
+
+  // Coincident nodes are pushed apart in an arbitrary direction.
+  const float min_dist2 = 1.0e-4f * k * k;
+
+  // Pending cells. 3 siblings per level are kept at most.
+  int stack[4 * kMaxTreeDepth + 4];
+
+  for (size_t i = begin; i < end; i++) {
+    const float x = _xs[i];
+    const float y = _ys[i];
+    float fx = 0.0f;
+    float fy = 0.0f;
+
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const size_t cell = size_t(stack[--top]);
+      if (!(_cell_masses[cell] > 0.0f)) {
+        continue;
+      }
+
+      if (_cell_children[cell] < 0) {
+        for (int b = _cell_bodies[cell]; b >= 0; b = _body_nexts[size_t(b)]) {
+          if (size_t(b) == i) {
+            continue;
+          }
+          float dx = x - _xs[size_t(b)];
+          float dy = y - _ys[size_t(b)];
+          float d2 = dx * dx + dy * dy;
+          if (d2 < min_dist2) {
+            dx = (size_t(b) < i) ? 0.01f * k : -0.01f * k;
+            dy = 0.0f;
+            d2 = dx * dx;
+          }
+          fx += repulsion * dx / d2;
+          fy += repulsion * dy / d2;
+        }
+        continue;
+      }
+
+      const float dx = x - _cell_mxs[cell];
+      const float dy = y - _cell_mys[cell];
+      const float d2 = dx * dx + dy * dy;
+      const float size = _cell_sizes[cell];
+      if ((size * size < theta2 * d2) && (d2 > min_dist2)) {
+        // Far enough. Approximate the cell by its center of mass.
+        fx += _cell_masses[cell] * repulsion * dx / d2;
+        fy += _cell_masses[cell] * repulsion * dy / d2;
+      } else {
+        for (int q = 0; q < 4; q++) {
+          stack[top++] = _cell_children[cell] + q;
+        }
+      }
+    }
+
+    // Attraction along edges.
+    for (size_t e = _adj_offsets[i]; e < _adj_offsets[i + 1]; e++) {
+      const size_t j = size_t(_adj_indices[e]);
+      const float dx = _xs[j] - x;
+      const float dy = _ys[j] - y;
+      const float d = std::sqrt(dx * dx + dy * dy);
+      fx += d * dx / k;
+      fy += d * dy / k;
+    }
+
+    _fxs[i] = fx;
+    _fys[i] = fy;
+  }
+}
+
+void ForceLayout::Move() {
+  double energy = 0.0;
+  for (size_t i = 0; i < _xs.size(); i++) {
+    const float f2 = _fxs[i] * _fxs[i] + _fys[i] * _fys[i];
+    if (!(f2 > 0.0f) || !std::isfinite(f2)) {
+      continue;
+    }
+    const float scale = _step_length / std::sqrt(f2);
+    _xs[i] += scale * _fxs[i];
+    _ys[i] += scale * _fys[i];
+    energy += double(f2);
+  }
+
+  // Grow the step after 5 consecutive improvements, shrink otherwise.
+  if ((_iteration == 0) || (energy < _energy)) {
+    _progress++;
+    if (_progress >= 5) {
+      _progress = 0;
+      _step_length /= kCooling;
+    }
+  } else {
+    _progress = 0;
+    _step_length *= kCooling;
+  }
+  _energy = energy;
+
+  _iteration++;
+  if ((_iteration >= _option.max_iterations) ||
+      (_step_length < _option.tolerance * _option.edge_length)) {
+    _running = false;
+  }
+}
+
+bool ForceLayout::step(double budget_ms) {
+  const auto start = std::chrono::steady_clock::now();
+
+  const size_t num_nodes = _xs.size();
+  const size_t batch_size = kChunkSize * size_t(_option.num_threads) * 4;
+
+  auto elapsed_ms = [&start]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  while (_running) {
+    if (!_tree_ready) {
+      // Takes a while for large graphs. Yield before computing forces.
+      BuildTree();
+      _tree_ready = true;
+      if (elapsed_ms() >= budget_ms) {
+        break;
+      }
+    }
+
+    const size_t end = std::min(num_nodes, _next_body + batch_size);
+    const size_t begin = _next_body;
+    const size_t num_chunks = (end - begin + kChunkSize - 1) / kChunkSize;
+    parallel_for(num_chunks, _option.num_threads, [&](size_t c, int) {
+      const size_t b = begin + c * kChunkSize;
+      ComputeForces(b, std::min(end, b + kChunkSize));
+    });
+    _next_body = end;
+
+    if (_next_body == num_nodes) {
+      Move();
+      _next_body = 0;
+      _tree_ready = false;
+    }
+
+    if (elapsed_ms() >= budget_ms) {
+      break;
+    }
+  }
+
+  return _running;
+}
+
+}  // namespace nnview
@@ -0,0 +1,104 @@
+#ifndef NNVIEW_LAYOUT_FORCE_LAYOUT_HH_
+#define NNVIEW_LAYOUT_FORCE_LAYOUT_HH_
+
+#include <cstddef>
+#include <vector>
+
+#include "layout/layered-layout.hh"
+
+//
+// Force-directed layout(Fruchterman-Reingold forces with the adaptive step
+// length of Hu, "Efficient and high quality force-directed graph drawing").
+// Repulsion between all pairs is approximated with a Barnes-Hut quadtree in
+// O(n log n). Edges are treated as undirected.
+//
+// The layout is computed incrementally: `step` runs for a given time budget
+// and returns, so it can be driven from the frame loop without blocking the
+// UI. Positions are updated at the end of each iteration.
+//
+namespace nnview {
+
+struct ForceLayoutOption {
+  float edge_length = 256.0f;  // Ideal distance between linked nodes
+
+  // Barnes-Hut opening criterion. A quadtree cell is approximated by its
+  // center of mass when (cell size / distance) < theta. 0 = exact.
+  float theta = 1.0f;
+
+  int max_iterations = 300;
+
+  // Stop when the step length falls below `tolerance` * `edge_length`.
+  float tolerance = 0.01f;
+
+  // <= 0 : Use all hardware threads.
+  int num_threads = -1;
+};
+
+class ForceLayout {
+ public:
+  // Start the layout of `graph` from node centers (xs, ys).
+  void reset(const LayoutGraph &graph, const std::vector<float> &xs,
+             const std::vector<float> &ys, const ForceLayoutOption &option);
+
+  void clear();
+
+  // Run iterations for about `budget_ms` milliseconds. At least a part of an
+  // iteration is processed. Returns true while the layout is running.
+  bool step(double budget_ms);
+
+  bool running() const { return _running; }
+  int iteration() const { return _iteration; }
+
+  // Node centers of the last completed iteration.
+  const std::vector<float> &xs() const { return _xs; }
+  const std::vector<float> &ys() const { return _ys; }
+
+ private:
+  void BuildTree();
+  int Subdivide(int cell);
+  int Quadrant(int cell, int body) const;
+
+  // Accumulate forces of nodes in [begin, end).
+  void ComputeForces(size_t begin, size_t end);
+
+  // Move nodes along the forces and update the step length.
+  void Move();
+
+  ForceLayoutOption _option;
+  bool _running = false;
+  int _iteration = 0;
+  bool _tree_ready = false;  // Quadtree is built for the current iteration
+  size_t _next_body = 0;  // First node of which force is not computed yet
+
+  float _step_length = 0.0f;
+  double _energy = 0.0;
+  int _progress = 0;
+
+  // Undirected adjacency.
+  std::vector<size_t> _adj_offsets;
+  std::vector<int> _adj_indices;
+
+  // Node positions and forces(SoA).
+  std::vector<float> _xs;
+  std::vector<float> _ys;
+  std::vector<float> _fxs;
+  std::vector<float> _fys;
+
+  // Quadtree(SoA). Children of a cell are 4 consecutive cells.
+  std::vector<float> _cell_cxs;  // Center of the square
+  std::vector<float> _cell_cys;
+  std::vector<float> _cell_sizes;  // Width of the square
+  std::vector<float> _cell_mxs;    // Center of mass
+  std::vector<float> _cell_mys;
+  std::vector<float> _cell_masses;  // # of nodes
+  std::vector<int> _cell_children;  // First child, -1 = leaf
+  std::vector<int> _cell_bodies;    // First node in the leaf, -1 = empty
+
+  // Next node in the same leaf. Leaves at the maximum depth may hold
+  // multiple nodes.
+  std::vector<int> _body_nexts;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_LAYOUT_FORCE_LAYOUT_HH_
@@ -0,0 +1,537 @@
+#include "layout/layered-layout.hh"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "parallel.hh"
+
+namespace nnview {
+
+namespace {
+
+// Compressed adjacency list.
+struct Adjacency {
+  std::vector<size_t> offsets;  // size = num_nodes + 1
+  std::vector<int> indices;
+
+  size_t begin(int v) const { return offsets[size_t(v)]; }
+  size_t end(int v) const { return offsets[size_t(v) + 1]; }
+  size_t degree(int v) const { return end(v) - begin(v); }
+};
+
+// Build adjacency of `num_nodes` nodes from <from, to> pairs.
+// When `reverse` is true, adjacency of `to` is built instead.
+void BuildAdjacency(size_t num_nodes,
+                    const std::vector<std::pair<int, int>> &edges,
+                    bool reverse, Adjacency *adj) {
+  adj->offsets.assign(num_nodes + 1, 0);
+  for (const auto &e : edges) {
+    adj->offsets[size_t(reverse ? e.second : e.first) + 1]++;
+  }
+  for (size_t i = 0; i < num_nodes; i++) {
+    adj->offsets[i + 1] += adj->offsets[i];
+  }
+
+  adj->indices.resize(edges.size());
+  std::vector<size_t> cursor(adj->offsets.begin(), adj->offsets.end() - 1);
+  for (const auto &e : edges) {
+    const int from = reverse ? e.second : e.first;
+    const int to = reverse ? e.first : e.second;
+    adj->indices[cursor[size_t(from)]++] = to;
+  }
+}
+
+// Topological order of the nodes(Kahn's algorithm). When the remaining nodes
+// form cycles, the first remaining node is taken regardless of its in-edges,
+// which makes those in-edges back edges.
+void TopologicalRank(size_t num_nodes,
+                     const std::vector<std::pair<int, int>> &edges,
+                     std::vector<int> *rank) {
+  Adjacency succs;
+  BuildAdjacency(num_nodes, edges, /* reverse */ false, &succs);
+
+  std::vector<size_t> in_degrees(num_nodes, 0);
+  for (const auto &e : edges) {
+    in_degrees[size_t(e.second)]++;
+  }
+
+  rank->assign(num_nodes, -1);
+
+  std::vector<int> queue;
+  queue.reserve(num_nodes);
+  for (size_t i = 0; i < num_nodes; i++) {
+    if (in_degrees[i] == 0) {
+      queue.push_back(int(i));
+    }
+  }
+
+  size_t head = 0;
+  size_t next_forced = 0;
+  int num_ranked = 0;
+  while (size_t(num_ranked) < num_nodes) {
+    if (head == queue.size()) {
+      // Cycle. Force the first unranked node.
+      while ((*rank)[next_forced] >= 0 || in_degrees[next_forced] == 0) {
+        next_forced++;
+      }
+      in_degrees[next_forced] = 0;
+      queue.push_back(int(next_forced));
+    }
+
+    const int v = queue[head++];
+    (*rank)[size_t(v)] = num_ranked++;
+
+    for (size_t k = succs.begin(v); k < succs.end(v); k++) {
+      const size_t s = size_t(succs.indices[k]);
+      if (((*rank)[s] < 0) && (in_degrees[s] > 0)) {
+        in_degrees[s]--;
+        if (in_degrees[s] == 0) {
+          queue.push_back(int(s));
+        }
+      }
+    }
+  }
+}
+
+// Sort nodes of `layer` by `keys`, then update their positions.
+void SortLayer(const std::vector<float> &keys, std::vector<int> *layer,
+               std::vector<int> *positions) {
+  std::stable_sort(layer->begin(), layer->end(), [&keys](int a, int b) {
+    return keys[size_t(a)] < keys[size_t(b)];
+  });
+  for (size_t i = 0; i < layer->size(); i++) {
+    (*positions)[size_t((*layer)[i])] = int(i);
+  }
+}
+
+// # of crossings of edges between `upper` and the next layer.
+// Edges are sorted by the upper end, then inversions of the lower ends are
+// counted with a Fenwick tree(Barth, Mutzel and Juenger).
+size_t CountCrossings(const std::vector<int> &upper, size_t num_lower,
+                      const Adjacency &succs,
+                      const std::vector<int> &positions) {
+  std::vector<int> lower_ends;
+  std::vector<int> ends;
+  for (int v : upper) {
+    ends.clear();
+    for (size_t k = succs.begin(v); k < succs.end(v); k++) {
+      ends.push_back(positions[size_t(succs.indices[k])]);
+    }
+    std::sort(ends.begin(), ends.end());
+    lower_ends.insert(lower_ends.end(), ends.begin(), ends.end());
+  }
+
+  std::vector<size_t> tree(num_lower + 1, 0);
+  size_t num_crossings = 0;
+  for (size_t i = 0; i < lower_ends.size(); i++) {
+    // # of inserted ends <= lower_ends[i].
+    size_t num_le = 0;
+    for (size_t j = size_t(lower_ends[i]) + 1; j > 0; j -= (j & (~j + 1))) {
+      num_le += tree[j];
+    }
+    num_crossings += i - num_le;
+
+    for (size_t j = size_t(lower_ends[i]) + 1; j <= num_lower;
+         j += (j & (~j + 1))) {
+      tree[j]++;
+    }
+  }
+
+  return num_crossings;
+}
+
+// Place nodes of a layer as close as possible to `targets`(top y) while
+// keeping the order and `gap` between nodes, in the least squares sense.
+// Substituting z[i] = y[i] - (sum of heights and gaps before i) turns the
+// problem into isotonic regression, which is solved exactly by the pool
+// adjacent violators algorithm in linear time.
+void PlaceLayer(const std::vector<int> &layer,
+                const std::vector<float> &heights,
+                const std::vector<float> &targets, float gap,
+                std::vector<float> *ys) {
+  struct Block {
+    double sum;
+    size_t count;
+  };
+
+  std::vector<Block> blocks;
+  std::vector<size_t> block_ends;  // Exclusive end of each block
+  blocks.reserve(layer.size());
+  block_ends.reserve(layer.size());
+
+  double offset = 0.0;
+  for (size_t i = 0; i < layer.size(); i++) {
+    const size_t v = size_t(layer[i]);
+
+    blocks.push_back({double(targets[v]) - offset, 1});
+    block_ends.push_back(i + 1);
+    offset += double(heights[v]) + double(gap);
+
+    // Merge while the order is violated.
+    while (blocks.size() > 1) {
+      const Block &b = blocks[blocks.size() - 1];
+      const Block &a = blocks[blocks.size() - 2];
+      if (a.sum * double(b.count) <= b.sum * double(a.count)) {
+        break;
+      }
+      blocks[blocks.size() - 2] = {a.sum + b.sum, a.count + b.count};
+      block_ends[blocks.size() - 2] = block_ends[blocks.size() - 1];
+      blocks.pop_back();
+      block_ends.pop_back();
+    }
+  }
+
+  offset = 0.0;
+  size_t i = 0;
+  for (size_t b = 0; b < blocks.size(); b++) {
+    const double z = blocks[b].sum / double(blocks[b].count);
+    for (; i < block_ends[b]; i++) {
+      const size_t v = size_t(layer[i]);
+      (*ys)[v] = float(z + offset);
+      offset += double(heights[v]) + double(gap);
+    }
+  }
+}
+
+}  // namespace
+
+void layered_layout(const LayoutGraph &graph,
+                    const LayeredLayoutOption &option, std::vector<float> *xs,
+                    std::vector<float> *ys, std::vector<int> *layers) {
+  const size_t num_nodes = graph.num_nodes();
+  const int num_threads = get_num_threads(option.num_threads);
+
+  xs->assign(num_nodes, 0.0f);
+  ys->assign(num_nodes, 0.0f);
+  if (layers) {
+    layers->assign(num_nodes, 0);
+  }
+  if (num_nodes == 0) {
+    return;
+  }
+
+  //
+  // 1. Break cycles and assign layers.
+  //
+  std::vector<std::pair<int, int>> edges;
+  edges.reserve(graph.edges.size());
+  for (const auto &e : graph.edges) {
+    if ((e.first < 0) || (e.second < 0) || (size_t(e.first) >= num_nodes) ||
+        (size_t(e.second) >= num_nodes) || (e.first == e.second)) {
+      continue;
+    }
+    edges.push_back(e);
+  }
+
+  std::vector<int> rank;
+  TopologicalRank(num_nodes, edges, &rank);
+
+  // Reverse back edges so that every edge goes along the rank.
+  for (auto &e : edges) {
+    if (rank[size_t(e.first)] > rank[size_t(e.second)]) {
+      std::swap(e.first, e.second);
+    }
+  }
+
+  std::vector<int> order(num_nodes);
+  for (size_t i = 0; i < num_nodes; i++) {
+    order[size_t(rank[i])] = int(i);
+  }
+
+  std::vector<int> node_layers(num_nodes, 0);
+  {
+    Adjacency preds;
+    BuildAdjacency(num_nodes, edges, /* reverse */ true, &preds);
+
+    Adjacency succs;
+    BuildAdjacency(num_nodes, edges, /* reverse */ false, &succs);
+
+    // Longest path from sources.
+    for (int v : order) {
+      int l = 0;
+      for (size_t k = preds.begin(v); k < preds.end(v); k++) {
+        l = std::max(l, node_layers[size_t(preds.indices[k])] + 1);
+      }
+      node_layers[size_t(v)] = l;
+    }
+
+    // Pull sources(e.g. weights) next to their first consumer, otherwise they
+    // all end up in the first layer with long edges.
+    for (size_t v = 0; v < num_nodes; v++) {
+      if ((preds.degree(int(v)) > 0) || (succs.degree(int(v)) == 0)) {
+        continue;
+      }
+      int l = node_layers[size_t(succs.indices[succs.begin(int(v))])];
+      for (size_t k = succs.begin(int(v)); k < succs.end(int(v)); k++) {
+        l = std::min(l, node_layers[size_t(succs.indices[k])]);
+      }
+      node_layers[v] = std::max(0, l - 1);
+    }
+
+  }
+
+  if (layers) {
+    (*layers) = node_layers;
+  }
+
+  //
+  // 2. Split long edges with dummy nodes and order each layer.
+  //
+  std::vector<int> all_layers(node_layers);
+  std::vector<std::pair<int, int>> segments;
+  segments.reserve(edges.size());
+
+  // Visit edges in the order of their source, which gives a reasonable
+  // initial order of dummy nodes.
+  std::stable_sort(edges.begin(), edges.end(),
+                   [&node_layers](const std::pair<int, int> &a,
+                                  const std::pair<int, int> &b) {
+                     return node_layers[size_t(a.first)] <
+                            node_layers[size_t(b.first)];
+                   });
+
+  for (const auto &e : edges) {
+    if (node_layers[size_t(e.second)] - node_layers[size_t(e.first)] >
+        option.max_edge_span) {
+      continue;
+    }
+
+    int prev = e.first;
+    for (int l = node_layers[size_t(e.first)] + 1;
+         l < node_layers[size_t(e.second)]; l++) {
+      const int dummy = int(all_layers.size());
+      all_layers.push_back(l);
+      segments.emplace_back(prev, dummy);
+      prev = dummy;
+    }
+    segments.emplace_back(prev, e.second);
+  }
+
+  const size_t num_all_nodes = all_layers.size();
+
+  Adjacency preds;
+  BuildAdjacency(num_all_nodes, segments, /* reverse */ true, &preds);
+
+  Adjacency succs;
+  BuildAdjacency(num_all_nodes, segments, /* reverse */ false, &succs);
+
+  int num_layers = 0;
+  for (int l : all_layers) {
+    num_layers = std::max(num_layers, l + 1);
+  }
+
+  // Real nodes in topological order, then dummy nodes in creation order.
+  std::vector<std::vector<int>> layer_nodes(static_cast<size_t>(num_layers));
+  for (int v : order) {
+    layer_nodes[size_t(all_layers[size_t(v)])].push_back(v);
+  }
+  for (size_t v = num_nodes; v < num_all_nodes; v++) {
+    layer_nodes[size_t(all_layers[v])].push_back(int(v));
+  }
+
+  std::vector<int> positions(num_all_nodes, 0);
+  std::vector<float> keys(num_all_nodes, 0.0f);
+
+  // Initial order : A single forward sweep with the barycenter of preds.
+  for (size_t l = 0; l < layer_nodes.size(); l++) {
+    for (int v : layer_nodes[l]) {
+      if (preds.degree(v) == 0) {
+        keys[size_t(v)] = -1.0f;  // Sources first
+        continue;
+      }
+      float sum = 0.0f;
+      for (size_t k = preds.begin(v); k < preds.end(v); k++) {
+        sum += float(positions[size_t(preds.indices[k])]);
+      }
+      keys[size_t(v)] = sum / float(preds.degree(v));
+    }
+    SortLayer(keys, &layer_nodes[l], &positions);
+  }
+
+  std::vector<size_t> layer_crossings(layer_nodes.size(), 0);
+  auto count_all_crossings = [&]() {
+    parallel_for(layer_nodes.size(), num_threads, [&](size_t l, int) {
+      layer_crossings[l] =
+          (l + 1 < layer_nodes.size())
+              ? CountCrossings(layer_nodes[l], layer_nodes[l + 1].size(),
+                               succs, positions)
+              : 0;
+    });
+    size_t sum = 0;
+    for (size_t c : layer_crossings) {
+      sum += c;
+    }
+    return sum;
+  };
+
+  size_t best_crossings = count_all_crossings();
+  std::vector<int> best_positions(positions);
+
+  // Reorder layers by the barycenter of both neighbor layers. Neighbors of
+  // odd layers are in even layers and vice versa, so all layers of the same
+  // parity can be reordered concurrently.
+  for (int iter = 0; (iter < option.num_iterations) && (best_crossings > 0);
+       iter++) {
+    for (size_t parity = 0; parity < 2; parity++) {
+      const size_t num_items = (layer_nodes.size() + 1 - parity) / 2;
+      parallel_for(num_items, num_threads, [&](size_t i, int) {
+        const size_t l = i * 2 + parity;
+        for (int v : layer_nodes[l]) {
+          const size_t degree = preds.degree(v) + succs.degree(v);
+          if (degree == 0) {
+            keys[size_t(v)] = float(positions[size_t(v)]);
+            continue;
+          }
+          float sum = 0.0f;
+          for (size_t k = preds.begin(v); k < preds.end(v); k++) {
+            sum += float(positions[size_t(preds.indices[k])]);
+          }
+          for (size_t k = succs.begin(v); k < succs.end(v); k++) {
+            sum += float(positions[size_t(succs.indices[k])]);
+          }
+          keys[size_t(v)] = sum / float(degree);
+        }
+        SortLayer(keys, &layer_nodes[l], &positions);
+      });
+    }
+
+    const size_t num_crossings = count_all_crossings();
+    if (num_crossings < best_crossings) {
+      best_crossings = num_crossings;
+      best_positions = positions;
+    }
+  }
+
+  // Restore the best order.
+  positions.swap(best_positions);
+  for (auto &layer : layer_nodes) {
+    std::sort(layer.begin(), layer.end(), [&positions](int a, int b) {
+      return positions[size_t(a)] < positions[size_t(b)];
+    });
+  }
+
+  //
+  // 3. Assign coordinates.
+  //
+  std::vector<float> heights(num_all_nodes, 0.0f);
+  std::copy(graph.heights.begin(), graph.heights.end(), heights.begin());
+
+  std::vector<float> layer_xs(layer_nodes.size(), 0.0f);
+  {
+    float x = 0.0f;
+    for (size_t l = 0; l < layer_nodes.size(); l++) {
+      layer_xs[l] = x;
+      float width = 0.0f;
+      for (int v : layer_nodes[l]) {
+        if (size_t(v) < num_nodes) {
+          width = std::max(width, graph.widths[size_t(v)]);
+        }
+      }
+      x += width + option.layer_spacing;
+    }
+  }
+
+  // Start from layers packed around y = 0.
+  std::vector<float> all_ys(num_all_nodes, 0.0f);
+  for (const auto &layer : layer_nodes) {
+    float y = 0.0f;
+    for (int v : layer) {
+      all_ys[size_t(v)] = y;
+      y += heights[size_t(v)] + option.node_spacing;
+    }
+    const float shift = -0.5f * y;
+    for (int v : layer) {
+      all_ys[size_t(v)] += shift;
+    }
+  }
+
+  // Move nodes toward the barycenter of the centers of their neighbors.
+  // Same as the reordering, layers of the same parity are independent.
+  std::vector<float> targets(num_all_nodes, 0.0f);
+  for (int iter = 0; iter < option.num_iterations; iter++) {
+    for (size_t parity = 0; parity < 2; parity++) {
+      const size_t num_items = (layer_nodes.size() + 1 - parity) / 2;
+      parallel_for(num_items, num_threads, [&](size_t i, int) {
+        const size_t l = i * 2 + parity;
+        for (int v : layer_nodes[l]) {
+          const size_t degree = preds.degree(v) + succs.degree(v);
+          if (degree == 0) {
+            targets[size_t(v)] = all_ys[size_t(v)];
+            continue;
+          }
+          float sum = 0.0f;
+          for (size_t k = preds.begin(v); k < preds.end(v); k++) {
+            const size_t u = size_t(preds.indices[k]);
+            sum += all_ys[u] + 0.5f * heights[u];
+          }
+          for (size_t k = succs.begin(v); k < succs.end(v); k++) {
+            const size_t u = size_t(succs.indices[k]);
+            sum += all_ys[u] + 0.5f * heights[u];
+          }
+          targets[size_t(v)] =
+              sum / float(degree) - 0.5f * heights[size_t(v)];
+        }
+        PlaceLayer(layer_nodes[l], heights, targets, option.node_spacing,
+                   &all_ys);
+      });
+    }
+  }
+
+  float min_y = all_ys[0];
+  for (size_t v = 0; v < num_nodes; v++) {
+    min_y = std::min(min_y, all_ys[v]);
+  }
+
+  for (size_t v = 0; v < num_nodes; v++) {
+    (*xs)[v] = layer_xs[size_t(all_layers[v])];
+    (*ys)[v] = all_ys[v] - min_y;
+  }
+}
+
+size_t count_layout_crossings(const LayoutGraph &graph,
+                              const std::vector<int> &layers,
+                              const std::vector<float> &ys) {
+  const size_t num_nodes = graph.num_nodes();
+
+  std::vector<std::pair<int, int>> segments;
+  for (const auto &e : graph.edges) {
+    if ((e.first < 0) || (e.second < 0) || (size_t(e.first) >= num_nodes) ||
+        (size_t(e.second) >= num_nodes)) {
+      continue;
+    }
+    const int d = layers[size_t(e.second)] - layers[size_t(e.first)];
+    if (d == 1) {
+      segments.push_back(e);
+    } else if (d == -1) {
+      segments.emplace_back(e.second, e.first);
+    }
+  }
+
+  Adjacency succs;
+  BuildAdjacency(num_nodes, segments, /* reverse */ false, &succs);
+
+  int num_layers = 0;
+  for (int l : layers) {
+    num_layers = std::max(num_layers, l + 1);
+  }
+
+  std::vector<std::vector<int>> layer_nodes(static_cast<size_t>(num_layers));
+  for (size_t v = 0; v < num_nodes; v++) {
+    layer_nodes[size_t(layers[v])].push_back(int(v));
+  }
+
+  std::vector<int> positions(num_nodes, 0);
+  for (auto &layer : layer_nodes) {
+    SortLayer(ys, &layer, &positions);
+  }
+
+  size_t num_crossings = 0;
+  for (size_t l = 0; l + 1 < layer_nodes.size(); l++) {
+    num_crossings += CountCrossings(layer_nodes[l], layer_nodes[l + 1].size(),
+                                    succs, positions);
+  }
+
+  return num_crossings;
+}
+
+}  // namespace nnview
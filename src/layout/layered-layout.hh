@@ -0,0 +1,78 @@
+#ifndef NNVIEW_LAYOUT_LAYERED_LAYOUT_HH_
+#define NNVIEW_LAYOUT_LAYERED_LAYOUT_HH_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//
+// Sugiyama-style layered layout of a directed graph. Layers are placed from
+// left to right.
+//
+// 1. Layer assignment : Longest path from sources. Cycles are broken by
+//    reversing back edges. Sources(e.g. weights) are pulled next to their
+//    consumers.
+// 2. Crossing minimization : Edges spanning multiple layers are split with
+//    dummy nodes, then nodes are ordered by barycenter of their neighbors.
+//    Odd and even layers are reordered alternately, so layers of the same
+//    parity are processed in parallel.
+// 3. Coordinate assignment : Each node is placed close to the barycenter of
+//    its neighbors with the order and the spacing kept(isotonic regression).
+//
+namespace nnview {
+
+// Graph to layout. Nodes are boxes of (width, height).
+struct LayoutGraph {
+  std::vector<float> widths;
+  std::vector<float> heights;
+  std::vector<std::pair<int, int>> edges;  // <from, to>
+
+  size_t num_nodes() const { return widths.size(); }
+
+  void clear() {
+    widths.clear();
+    heights.clear();
+    edges.clear();
+  }
+
+  // Returns the index of the new node.
+  int add_node(float width, float height) {
+    widths.push_back(width);
+    heights.push_back(height);
+    return int(widths.size()) - 1;
+  }
+
+  void add_edge(int from, int to) { edges.emplace_back(from, to); }
+};
+
+struct LayeredLayoutOption {
+  float layer_spacing = 96.0f;  // Horizontal gap between layers
+  float node_spacing = 32.0f;   // Vertical gap between nodes in a layer
+
+  // # of sweeps for crossing minimization and coordinate assignment.
+  int num_iterations = 8;
+
+  // Edges spanning more layers than this are not split into dummy nodes and
+  // do not take part in the ordering. A few long skip connections would
+  // otherwise add millions of dummy nodes.
+  int max_edge_span = 64;
+
+  // <= 0 : Use all hardware threads.
+  int num_threads = -1;
+};
+
+// Compute the upper left position of each node.
+// `layers`(optional) receives the layer index of each node.
+void layered_layout(const LayoutGraph &graph,
+                    const LayeredLayoutOption &option, std::vector<float> *xs,
+                    std::vector<float> *ys, std::vector<int> *layers = nullptr);
+
+// # of edge crossings between adjacent layers of the layout. Edges spanning
+// multiple layers are not counted. For evaluation.
+size_t count_layout_crossings(const LayoutGraph &graph,
+                              const std::vector<int> &layers,
+                              const std::vector<float> &ys);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_LAYOUT_LAYERED_LAYOUT_HH_
@@ -0,0 +1,218 @@
+#include "log.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace nnview {
+
+std::atomic<int> g_log_levels[kNumLogModules] = {
+    {kDefaultLogLevel}, {kDefaultLogLevel}, {kDefaultLogLevel},
+    {kDefaultLogLevel}, {kDefaultLogLevel}};
+
+namespace {
+
+// The writer is woken when this many bytes are queued.
+constexpr size_t kLogFlushBytes = 64 * 1024;
+
+// Messages are written by the caller above this size, so a slow terminal
+// throttles logging instead of growing the queue.
+constexpr size_t kLogMaxQueuedBytes = 4 * 1024 * 1024;
+
+// Queued messages are written at least this often.
+constexpr int kLogFlushIntervalMs = 100;
+
+struct LogSink {
+  std::mutex mutex;  // Guards `queued` and `writer_started`.
+  std::condition_variable cv;
+  std::string queued;
+  bool writer_started = false;
+
+  // Held while writing, so that messages are written in order.
+  std::mutex write_mutex;
+};
+
+// Allocated once and intentionally leaked. The writer thread is detached and
+// may still use it at exit.
+LogSink *GetSink() {
+  static LogSink *sink = new LogSink();
+  return sink;
+}
+
+void Flush(LogSink *sink) {
+  std::lock_guard<std::mutex> write_lock(sink->write_mutex);
+
+  std::string buf;
+  {
+    std::lock_guard<std::mutex> lock(sink->mutex);
+    buf.swap(sink->queued);
+  }
+
+  if (!buf.empty()) {
+    fwrite(buf.data(), 1, buf.size(), stderr);
+    fflush(stderr);
+  }
+}
+
+void WriterMain(LogSink *sink) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(sink->mutex);
+      sink->cv.wait_for(
+          lock, std::chrono::milliseconds(kLogFlushIntervalMs),
+          [sink] { return sink->queued.size() >= kLogFlushBytes; });
+      if (sink->queued.empty()) {
+        continue;
+      }
+    }
+    Flush(sink);
+  }
+}
+
+void FlushAtExit() { log_flush(); }
+
+bool ParseLogLevel(const std::string &s, LogLevel *level) {
+  for (int i = 0; i < kNumLogLevels; i++) {
+    if (s.compare(get_log_level_name(LogLevel(i))) == 0) {
+      (*level) = LogLevel(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseLogModule(const std::string &s, LogModule *module) {
+  for (int i = 0; i < kNumLogModules; i++) {
+    if (s.compare(get_log_module_name(LogModule(i))) == 0) {
+      (*module) = LogModule(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+const char *get_log_level_name(LogLevel level) {
+  switch (level) {
+    case LOG_LEVEL_DEBUG:
+      return "debug";
+    case LOG_LEVEL_INFO:
+      return "info";
+    case LOG_LEVEL_WARN:
+      return "warn";
+    case LOG_LEVEL_ERROR:
+      return "error";
+    case LOG_LEVEL_OFF:
+      return "off";
+  }
+  return "";
+}
+
+const char *get_log_module_name(LogModule module) {
+  switch (module) {
+    case LOG_MODULE_IO:
+      return "io";
+    case LOG_MODULE_GRAPH:
+      return "graph";
+    case LOG_MODULE_GUI:
+      return "gui";
+    case LOG_MODULE_GL:
+      return "gl";
+    case LOG_MODULE_APP:
+      return "app";
+  }
+  return "";
+}
+
+void set_log_level(LogLevel level) {
+  for (int i = 0; i < kNumLogModules; i++) {
+    set_log_level(LogModule(i), level);
+  }
+}
+
+void set_log_level(LogModule module, LogLevel level) {
+  g_log_levels[module].store(int(level), std::memory_order_relaxed);
+}
+
+bool parse_log_levels(const std::string &spec, std::string *err) {
+  size_t begin = 0;
+  while (begin <= spec.size()) {
+    size_t end = spec.find(',', begin);
+    if (end == std::string::npos) {
+      end = spec.size();
+    }
+    const std::string item = spec.substr(begin, end - begin);
+    begin = end + 1;
+
+    if (item.empty()) {
+      continue;
+    }
+
+    LogLevel level;
+    const size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      if (!ParseLogLevel(item, &level)) {
+        (*err) = "Unknown log level : " + item;
+        return false;
+      }
+      set_log_level(level);
+      continue;
+    }
+
+    LogModule module;
+    if (!ParseLogModule(item.substr(0, eq), &module)) {
+      (*err) = "Unknown log module : " + item.substr(0, eq);
+      return false;
+    }
+    if (!ParseLogLevel(item.substr(eq + 1), &level)) {
+      (*err) = "Unknown log level : " + item.substr(eq + 1);
+      return false;
+    }
+    set_log_level(module, level);
+  }
+
+  return true;
+}
+
+void log_write(LogModule module, LogLevel level, const std::string &message) {
+  static const char kLevelChars[kNumLogLevels] = {'D', 'I', 'W', 'E', '-'};
+
+  LogSink *sink = GetSink();
+
+  bool flush_now = (level >= LOG_LEVEL_ERROR);
+  {
+    std::lock_guard<std::mutex> lock(sink->mutex);
+
+    if (!sink->writer_started) {
+      sink->writer_started = true;
+      std::atexit(FlushAtExit);
+      std::thread(WriterMain, sink).detach();
+    }
+
+    sink->queued += '[';
+    sink->queued += kLevelChars[level];
+    sink->queued += ' ';
+    sink->queued += get_log_module_name(module);
+    sink->queued += "] ";
+    sink->queued += message;
+    sink->queued += '\n';
+
+    if (sink->queued.size() >= kLogMaxQueuedBytes) {
+      flush_now = true;
+    } else if (sink->queued.size() >= kLogFlushBytes) {
+      sink->cv.notify_one();
+    }
+  }
+
+  if (flush_now) {
+    Flush(sink);
+  }
+}
+
+void log_flush() { Flush(GetSink()); }
+
+}  // namespace nnview
@@ -0,0 +1,111 @@
+#ifndef NNVIEW_LOG_HH_
+#define NNVIEW_LOG_HH_
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+//
+// Leveled logging.
+// A message below the level of its module is skipped without formatting.
+// Messages are appended to a buffer and written to stderr by a background
+// thread, so logging from loader threads does not wait for the terminal.
+// Errors are written immediately.
+//
+//   NNVIEW_LOG_DEBUG(IO) << "dim : " << shape.size();
+//
+namespace nnview {
+
+enum LogLevel {
+  LOG_LEVEL_DEBUG = 0,  // Per node/tensor messages.
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_OFF,
+};
+
+constexpr int kNumLogLevels = 5;
+
+enum LogModule {
+  LOG_MODULE_IO = 0,  // .weights files
+  LOG_MODULE_GRAPH,   // Graph JSON and its structure
+  LOG_MODULE_GUI,
+  LOG_MODULE_GL,
+  LOG_MODULE_APP,
+};
+
+constexpr int kNumLogModules = 5;
+
+// Default level of all modules.
+constexpr LogLevel kDefaultLogLevel = LOG_LEVEL_INFO;
+
+extern std::atomic<int> g_log_levels[kNumLogModules];
+
+inline bool log_enabled(LogModule module, LogLevel level) {
+  return int(level) >= g_log_levels[module].load(std::memory_order_relaxed);
+}
+
+const char *get_log_level_name(LogLevel level);
+
+const char *get_log_module_name(LogModule module);
+
+// Set the level of all modules.
+void set_log_level(LogLevel level);
+
+void set_log_level(LogModule module, LogLevel level);
+
+//
+// Set levels from `spec`, a comma separated list of `LEVEL` or
+// `MODULE=LEVEL`(e.g. "warn,io=debug"). Items are applied in order.
+// Returns false and sets `err` for an unknown module or level.
+//
+bool parse_log_levels(const std::string &spec, std::string *err);
+
+// Queue a message. A newline is appended.
+void log_write(LogModule module, LogLevel level, const std::string &message);
+
+// Write queued messages. Also called at exit.
+void log_flush();
+
+// Formats one message and queues it on destruction.
+class LogMessage {
+ public:
+  LogMessage(LogModule module, LogLevel level)
+      : _module(module), _level(level) {}
+
+  ~LogMessage() { log_write(_module, _level, _ss.str()); }
+
+  LogMessage(const LogMessage &) = delete;
+  LogMessage &operator=(const LogMessage &) = delete;
+
+  std::ostream &stream() { return _ss; }
+
+ private:
+  LogModule _module;
+  LogLevel _level;
+  std::ostringstream _ss;
+};
+
+// Makes both branches of NNVIEW_LOG `void`.
+struct LogVoidify {
+  void operator&(std::ostream &) {}
+};
+
+}  // namespace nnview
+
+// `module` is a suffix of LogModule(e.g. IO) and `level` of LogLevel.
+#define NNVIEW_LOG(module, level)                                         \
+  !::nnview::log_enabled(::nnview::LOG_MODULE_##module,                   \
+                         ::nnview::LOG_LEVEL_##level)                     \
+      ? (void)0                                                           \
+      : ::nnview::LogVoidify() &                                          \
+            ::nnview::LogMessage(::nnview::LOG_MODULE_##module,           \
+                                 ::nnview::LOG_LEVEL_##level)             \
+                .stream()
+
+#define NNVIEW_LOG_DEBUG(module) NNVIEW_LOG(module, DEBUG)
+#define NNVIEW_LOG_INFO(module) NNVIEW_LOG(module, INFO)
+#define NNVIEW_LOG_WARN(module) NNVIEW_LOG(module, WARN)
+#define NNVIEW_LOG_ERROR(module) NNVIEW_LOG(module, ERROR)
+
+#endif  // NNVIEW_LOG_HH_
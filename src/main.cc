@@ -69,6 +69,8 @@ SOFTWARE.
 #include "nnview_app.hh"
 #include "roboto_mono_embed.inc.h"
 #include "gui_component.hh"
+#include "log.hh"
+#include "trace.hh"
 
 static void gui_new_frame() {
   glfwPollEvents();
@@ -137,7 +139,7 @@ static bool ImGuiCombo(const char* label, int* current_item,
 #endif
 
 static void error_callback(int error, const char *description) {
-  std::cerr << "GLFW Error : " << error << ", " << description << std::endl;
+  NNVIEW_LOG_ERROR(GL) << "GLFW Error : " << error << ", " << description;
 }
 
 #if 0
@@ -156,6 +158,14 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 }
 #else
 
+static void save_trace(const std::string &filename) {
+  if (nnview::trace_write_json(filename)) {
+    NNVIEW_LOG_INFO(APP) << "Wrote trace : " << filename;
+  } else {
+    NNVIEW_LOG_ERROR(APP) << "Failed to write trace : " << filename;
+  }
+}
+
 static void key_callback(GLFWwindow *window, int key, int, int action,
                          int mods) {
   ImGuiIO &io = ImGui::GetIO();
@@ -164,7 +174,7 @@ static void key_callback(GLFWwindow *window, int key, int, int action,
   if (action == GLFW_RELEASE)
     io.KeysDown[key] = false;
 
-  std::cout << char(key) << "\n";
+  NNVIEW_LOG_DEBUG(APP) << "key " << key << ", action " << action;
 
   (void)mods; // Modifiers are not reliable across systems
   io.KeyCtrl =
@@ -178,6 +188,19 @@ static void key_callback(GLFWwindow *window, int key, int, int action,
   if (key == GLFW_KEY_Q && action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL)) {
     glfwSetWindowShouldClose(window, GLFW_TRUE);
   }
+
+  // F12: Start recording a trace, then write zones recorded so far.
+  if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+    nnview::app *app =
+        reinterpret_cast<nnview::app *>(glfwGetWindowUserPointer(window));
+    if (!nnview::trace_enabled()) {
+      nnview::trace_enable(true);
+      NNVIEW_LOG_INFO(APP)
+          << "Start recording trace. Press F12 again to write it.";
+    } else if (app) {
+      save_trace(app->trace_filename);
+    }
+  }
 }
 
 static void char_callback(GLFWwindow *, unsigned int c) {
@@ -243,7 +266,7 @@ static void initialize_glfw_opengl_window(GLFWwindow *&window) {
   }
 #else
   if (gl3wInit() != 0) {
-	std::cerr << "Failed to create OpenGL3 context.\n";
+	NNVIEW_LOG_ERROR(GL) << "Failed to create OpenGL3 context.";
 	exit(EXIT_FAILURE);
   }
   ImGui::CreateContext(); // imgui-node-editor's imgui specific
@@ -467,29 +490,64 @@ static void update_texture(GLuint texid, const nnview::Tensor& tensor) {
 #endif
 
 int main(int argc, char **argv) {
-  // TODO(LTE): Parse args.
-  (void)argc;
-  (void)argv;
+  std::string graph_filename;
+  std::string trace_filename;
+  nnview::GraphLoaderOption loader_option;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare("--no-mmap") == 0) {
+      loader_option.use_mmap = false;
+    } else if (arg.compare("--lazy") == 0) {
+      loader_option.lazy = true;
+    } else if ((arg.compare("--threads") == 0) && ((i + 1) < argc)) {
+      loader_option.num_threads = std::atoi(argv[++i]);
+    } else if ((arg.compare("--trace") == 0) && ((i + 1) < argc)) {
+      trace_filename = argv[++i];
+    } else if ((arg.compare("--log") == 0) && ((i + 1) < argc)) {
+      std::string err;
+      if (!nnview::parse_log_levels(argv[++i], &err)) {
+        std::cerr << err << "\n";
+        return EXIT_FAILURE;
+      }
+    } else if ((arg.size() > 2) && (arg.compare(0, 2, "--") == 0)) {
+      std::cerr << "Unknown option : " << arg << "\n";
+      return EXIT_FAILURE;
+    } else {
+      graph_filename = arg;
+    }
+  }
 
-  if (argc < 2) {
-    std::cerr << "Need model.json\n";
+  if (graph_filename.empty()) {
+    std::cerr << "Usage: nnview [--no-mmap] [--lazy] [--threads N] "
+                 "[--trace trace.json] [--log LEVELS] model.json\n";
     return EXIT_FAILURE;
   }
 
-  nnview::GUIContext gui_ctx;
+  // Record from startup so that loading is included.
+  nnview::trace_set_thread_name("main");
+  if (!trace_filename.empty()) {
+    nnview::trace_enable(true);
+  }
 
-  std::string graph_filename = argv[1];
+  nnview::GUIContext gui_ctx;
+  gui_ctx._use_mmap = loader_option.use_mmap;
+  gui_ctx._num_threads = loader_option.num_threads;
 
   {
-    bool ret = nnview::load_json_graph(graph_filename, &gui_ctx._graph);
+    bool ret = nnview::load_json_graph(graph_filename, &gui_ctx._graph,
+                                       loader_option, &gui_ctx._csr_graph);
     if (!ret) {
-      std::cerr << "Failed to read graph : " << graph_filename << "\n";
+      NNVIEW_LOG_ERROR(APP) << "Failed to read graph : " << graph_filename;
       return EXIT_FAILURE;
     }
   }
 
   GLFWwindow *window = nullptr;
   nnview::app app;
+  if (!trace_filename.empty()) {
+    app.trace_filename = trace_filename;
+  }
 
   initialize_glfw_opengl_window(window);
   // glfwSetWindowUserPointer(window, &gui_parameters);
@@ -508,7 +566,7 @@ int main(int argc, char **argv) {
   GLFWmonitor *monitor = glfwGetPrimaryMonitor();
   glfwGetMonitorContentScale(monitor, &xscale, &yscale);
 
-  std::cout << "scale = " << xscale << ", " << yscale << "\n";
+  NNVIEW_LOG_DEBUG(APP) << "scale = " << xscale << ", " << yscale;
 
   initialize_imgui(window);
   (void)ImGui::GetIO();
@@ -520,12 +578,15 @@ int main(int argc, char **argv) {
   gui_ctx.init_imnode_graph();
 
   while (!glfwWindowShouldClose(window)) {
+    NNVIEW_TRACE_SCOPE("frame");
+
     gui_new_frame();
     int display_w, display_h;
     gl_new_frame(window, background_color, &display_w, &display_h);
 
     gui_ctx.draw_imnodes();
     gui_ctx.draw_tensor();
+    gui_ctx.end_frame();
 
     //tensor_window(tensor_texid, tensor);
 
@@ -539,5 +600,9 @@ int main(int argc, char **argv) {
 
   deinitialize_gui_and_window(window);
 
+  if (nnview::trace_enabled()) {
+    save_trace(app.trace_filename);
+  }
+
   return EXIT_SUCCESS;
 }
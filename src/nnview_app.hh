@@ -25,6 +25,7 @@ SOFTWARE.
 #define NNVIEW_APP_H_
 
 #include <array>
+#include <string>
 
 namespace nnview {
 
@@ -47,6 +48,9 @@ class app {
 
   struct application_parameters gui_parameters;
 
+  // Chrome trace JSON written with F12 and at exit.
+  std::string trace_filename = "nnview-trace.json";
+
 };
 
 } // namespace nnview
@@ -0,0 +1,61 @@
+#ifndef NNVIEW_PARALLEL_HH_
+#define NNVIEW_PARALLEL_HH_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+//
+// Minimal thread pool helper.
+//
+namespace nnview {
+
+// Returns the number of worker threads to use when `num_threads` <= 0.
+inline int get_num_threads(int num_threads) {
+  if (num_threads > 0) {
+    return num_threads;
+  }
+  unsigned int n = std::thread::hardware_concurrency();
+  return (n == 0) ? 1 : int(n);
+}
+
+//
+// Calls `func(i, thread_id)` for i in [0, n) using `num_threads` workers.
+// Items are handed out one by one, so costly items(e.g. large files) do not
+// stall other workers. Runs on the calling thread when a single worker is
+// requested.
+//
+template <typename Func>
+void parallel_for(size_t n, int num_threads, Func func) {
+  const size_t num_workers =
+      std::min(size_t(get_num_threads(num_threads)), n);
+
+  if (num_workers <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      func(i, 0);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_index(0);
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < num_workers; t++) {
+    workers.emplace_back([&next_index, &func, n, t]() {
+      size_t i = 0;
+      while ((i = next_index++) < n) {
+        func(i, int(t));
+      }
+    });
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace nnview
+
+#endif  // NNVIEW_PARALLEL_HH_
@@ -0,0 +1,193 @@
+#include "spatial-grid.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nnview {
+
+static uint64_t CellKey(int cx, int cy) {
+  return (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+}
+
+SpatialGrid::SpatialGrid(float cell_size) { reset(cell_size); }
+
+void SpatialGrid::reset(float cell_size) {
+  clear();
+  _cell_size = std::max(1.0f, cell_size);
+  _inv_cell_size = 1.0f / _cell_size;
+}
+
+void SpatialGrid::clear() {
+  _items.clear();
+  _cells.clear();
+  _visit_stamps.clear();
+  _stamp = 0;
+}
+
+int SpatialGrid::CellCoord(float v) const {
+  // Clamp to keep far away(or non-finite) coordinates in `int` range.
+  const float kLimit = float(1 << 30);
+  float c = std::floor(v * _inv_cell_size);
+  if (!(c > -kLimit)) c = -kLimit;
+  if (c > kLimit) c = kLimit;
+  return int(c);
+}
+
+void SpatialGrid::Insert(int idx, const int c0[2], const int c1[2]) {
+  for (int cy = c0[1]; cy <= c1[1]; cy++) {
+    for (int cx = c0[0]; cx <= c1[0]; cx++) {
+      _cells[CellKey(cx, cy)].push_back(idx);
+    }
+  }
+}
+
+void SpatialGrid::Erase(int idx, const int c0[2], const int c1[2]) {
+  for (int cy = c0[1]; cy <= c1[1]; cy++) {
+    for (int cx = c0[0]; cx <= c1[0]; cx++) {
+      auto it = _cells.find(CellKey(cx, cy));
+      if (it == _cells.end()) {
+        continue;
+      }
+
+      std::vector<int> &cell = it->second;
+      auto pos = std::find(cell.begin(), cell.end(), idx);
+      if (pos != cell.end()) {
+        // Order in a cell does not matter.
+        (*pos) = cell.back();
+        cell.pop_back();
+      }
+
+      if (cell.empty()) {
+        _cells.erase(it);
+      }
+    }
+  }
+}
+
+void SpatialGrid::update(int idx, float min_x, float min_y, float max_x,
+                         float max_y) {
+  if (idx < 0) {
+    return;
+  }
+
+  if (size_t(idx) >= _items.size()) {
+    _items.resize(size_t(idx) + 1);
+    _visit_stamps.resize(_items.size(), 0);
+  }
+
+  Item &item = _items[size_t(idx)];
+
+  const int c0[2] = {CellCoord(std::min(min_x, max_x)),
+                     CellCoord(std::min(min_y, max_y))};
+  const int c1[2] = {CellCoord(std::max(min_x, max_x)),
+                     CellCoord(std::max(min_y, max_y))};
+
+  if (item.valid) {
+    if ((item.c0[0] != c0[0]) || (item.c0[1] != c0[1]) ||
+        (item.c1[0] != c1[0]) || (item.c1[1] != c1[1])) {
+      Erase(idx, item.c0, item.c1);
+      Insert(idx, c0, c1);
+    }
+  } else {
+    Insert(idx, c0, c1);
+  }
+
+  item.bmin[0] = std::min(min_x, max_x);
+  item.bmin[1] = std::min(min_y, max_y);
+  item.bmax[0] = std::max(min_x, max_x);
+  item.bmax[1] = std::max(min_y, max_y);
+  item.c0[0] = c0[0];
+  item.c0[1] = c0[1];
+  item.c1[0] = c1[0];
+  item.c1[1] = c1[1];
+  item.valid = true;
+}
+
+void SpatialGrid::remove(int idx) {
+  if (!contains(idx)) {
+    return;
+  }
+
+  Item &item = _items[size_t(idx)];
+  Erase(idx, item.c0, item.c1);
+  item.valid = false;
+}
+
+void SpatialGrid::query(float min_x, float min_y, float max_x, float max_y,
+                        std::vector<int> *result) const {
+  if (_cells.empty()) {
+    return;
+  }
+
+  _stamp++;
+  if (_stamp == 0) {
+    // Wrapped around.
+    std::fill(_visit_stamps.begin(), _visit_stamps.end(), 0);
+    _stamp = 1;
+  }
+
+  auto visit = [&](const std::vector<int> &cell) {
+    for (int idx : cell) {
+      const Item &item = _items[size_t(idx)];
+      if (_visit_stamps[size_t(idx)] == _stamp) {
+        continue;
+      }
+      _visit_stamps[size_t(idx)] = _stamp;
+
+      if ((item.bmin[0] <= max_x) && (min_x <= item.bmax[0]) &&
+          (item.bmin[1] <= max_y) && (min_y <= item.bmax[1])) {
+        result->push_back(idx);
+      }
+    }
+  };
+
+  const int c0x = CellCoord(min_x);
+  const int c0y = CellCoord(min_y);
+  const int c1x = CellCoord(max_x);
+  const int c1y = CellCoord(max_y);
+
+  const double num_query_cells =
+      (double(c1x) - double(c0x) + 1.0) * (double(c1y) - double(c0y) + 1.0);
+
+  if (num_query_cells > double(_cells.size())) {
+    // Query region is larger than the occupied area(e.g. zoomed out).
+    // Visit non-empty cells instead of every cell in the region.
+    for (const auto &it : _cells) {
+      const int cx = int(uint32_t(it.first >> 32));
+      const int cy = int(uint32_t(it.first & 0xffffffffu));
+      if ((cx >= c0x) && (cx <= c1x) && (cy >= c0y) && (cy <= c1y)) {
+        visit(it.second);
+      }
+    }
+    return;
+  }
+
+  for (int cy = c0y; cy <= c1y; cy++) {
+    for (int cx = c0x; cx <= c1x; cx++) {
+      auto it = _cells.find(CellKey(cx, cy));
+      if (it != _cells.end()) {
+        visit(it->second);
+      }
+    }
+  }
+}
+
+int SpatialGrid::pick(float x, float y) const {
+  auto it = _cells.find(CellKey(CellCoord(x), CellCoord(y)));
+  if (it == _cells.end()) {
+    return -1;
+  }
+
+  int picked = -1;
+  for (int idx : it->second) {
+    const Item &item = _items[size_t(idx)];
+    if ((x >= item.bmin[0]) && (x <= item.bmax[0]) && (y >= item.bmin[1]) &&
+        (y <= item.bmax[1])) {
+      picked = std::max(picked, idx);
+    }
+  }
+
+  return picked;
+}
+
+}  // namespace nnview
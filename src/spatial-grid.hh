@@ -0,0 +1,77 @@
+#ifndef NNVIEW_SPATIAL_GRID_HH_
+#define NNVIEW_SPATIAL_GRID_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//
+// Uniform grid over axis-aligned rectangles(e.g. nodes on the graph canvas).
+// Each item is registered to every cell its rectangle overlaps, so region and
+// point queries only visit items near the query.
+// Moving an item only touches the cells it leaves or enters, so the grid can
+// be updated incrementally while nodes are dragged.
+//
+namespace nnview {
+
+class SpatialGrid {
+ public:
+  explicit SpatialGrid(float cell_size = 512.0f);
+
+  // Remove all items and change the cell size.
+  void reset(float cell_size);
+
+  void clear();
+
+  // Insert item `idx`(>= 0) with rect [min, max], or move it if it already
+  // exists.
+  void update(int idx, float min_x, float min_y, float max_x, float max_y);
+
+  void remove(int idx);
+
+  bool contains(int idx) const {
+    return (idx >= 0) && (size_t(idx) < _items.size()) &&
+           _items[size_t(idx)].valid;
+  }
+
+  // Append items overlapping with rect [min, max] to `result`. Each item is
+  // reported once, in no particular order.
+  void query(float min_x, float min_y, float max_x, float max_y,
+             std::vector<int> *result) const;
+
+  // Returns the largest index of the items containing point (x, y), or -1.
+  // Items are drawn in index order, so this is the top-most item.
+  int pick(float x, float y) const;
+
+ private:
+  struct Item {
+    float bmin[2];
+    float bmax[2];
+
+    // Cell range [c0, c1] the item is registered to.
+    int c0[2];
+    int c1[2];
+
+    bool valid = false;
+  };
+
+  int CellCoord(float v) const;
+
+  void Insert(int idx, const int c0[2], const int c1[2]);
+  void Erase(int idx, const int c0[2], const int c1[2]);
+
+  float _cell_size;
+  float _inv_cell_size;
+
+  std::vector<Item> _items;
+  std::unordered_map<uint64_t, std::vector<int>> _cells;
+
+  // Used to report each item once in `query`.
+  mutable std::vector<uint32_t> _visit_stamps;
+  mutable uint32_t _stamp = 0;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_SPATIAL_GRID_HH_
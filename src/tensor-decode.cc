@@ -0,0 +1,103 @@
+#include "tensor-decode.hh"
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nnview {
+
+static void DecodeFloat16(const uint8_t *src, size_t count, float *dst) {
+  size_t i = 0;
+
+#if defined(__F16C__)
+  for (; (i + 8) <= count; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  for (; (i + 4) <= count; i += 4) {
+    uint16x4_t h = vld1_u16(reinterpret_cast<const uint16_t *>(src + 2 * i));
+    vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(h)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    uint16_t h;
+    memcpy(&h, src + 2 * i, sizeof(uint16_t));
+    dst[i] = half_to_float(h);
+  }
+}
+
+static void DecodeBFloat16(const uint8_t *src, size_t count, float *dst) {
+  size_t i = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+  const __m128i zero = _mm_setzero_si128();
+  for (; (i + 8) <= count; i += 8) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+    // bfloat16 is the upper 16 bits of float32.
+    __m128i lo = _mm_unpacklo_epi16(zero, b);
+    __m128i hi = _mm_unpackhi_epi16(zero, b);
+    _mm_storeu_ps(dst + i, _mm_castsi128_ps(lo));
+    _mm_storeu_ps(dst + i + 4, _mm_castsi128_ps(hi));
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  for (; (i + 4) <= count; i += 4) {
+    uint16x4_t b = vld1_u16(reinterpret_cast<const uint16_t *>(src + 2 * i));
+    vst1q_f32(dst + i, vreinterpretq_f32_u32(vshll_n_u16(b, 16)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    uint16_t b;
+    memcpy(&b, src + 2 * i, sizeof(uint16_t));
+    dst[i] = bfloat16_to_float(b);
+  }
+}
+
+static void DecodeInt8(const uint8_t *src, size_t count, float *dst) {
+  // Simple enough for compilers to auto-vectorize.
+  for (size_t i = 0; i < count; i++) {
+    dst[i] = float(int8_t(src[i]));
+  }
+}
+
+// `offset` is an item index, since odd index starts from the upper 4 bits.
+static void DecodeInt4(const uint8_t *src, size_t offset, size_t count,
+                       float *dst) {
+  for (size_t i = 0; i < count; i++) {
+    const size_t idx = offset + i;
+    const uint8_t b = src[idx / 2];
+    const uint8_t nibble = (idx & 1) ? uint8_t(b >> 4) : uint8_t(b & 0xf);
+    dst[i] = float(int(nibble ^ 0x8) - 8);
+  }
+}
+
+void decode_tensor_values(const Tensor &tensor, size_t offset, size_t count,
+                          float *dst) {
+  switch (tensor.dtype) {
+    case DATA_TYPE_FLOAT32:
+      memcpy(dst, tensor.data + offset * sizeof(float), count * sizeof(float));
+      break;
+    case DATA_TYPE_FLOAT16:
+      DecodeFloat16(tensor.data + offset * sizeof(uint16_t), count, dst);
+      break;
+    case DATA_TYPE_BFLOAT16:
+      DecodeBFloat16(tensor.data + offset * sizeof(uint16_t), count, dst);
+      break;
+    case DATA_TYPE_INT8:
+      DecodeInt8(tensor.data + offset, count, dst);
+      break;
+    case DATA_TYPE_INT4:
+      DecodeInt4(tensor.data, offset, count, dst);
+      break;
+  }
+}
+
+}  // namespace nnview
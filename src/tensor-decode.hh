@@ -0,0 +1,41 @@
+#ifndef NNVIEW_TENSOR_DECODE_HH_
+#define NNVIEW_TENSOR_DECODE_HH_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "datatypes.h"
+
+//
+// Bulk conversion of Tensor payload(any `DataType`) to float32.
+// Used by statistics and colormapping to decode data on the fly, block by
+// block, instead of keeping a float32 copy of the whole tensor.
+//
+namespace nnview {
+
+// Recommended number of items per block. Fits in L1 cache.
+constexpr size_t kDecodeBlockSize = 4096;
+
+// Decode `count` items starting from item index `offset` to `dst`.
+// `tensor` must be loaded and [offset, offset + count) must be in range.
+void decode_tensor_values(const Tensor &tensor, size_t offset, size_t count,
+                          float *dst);
+
+//
+// Calls `func(const float *values, size_t offset, size_t count)` for each
+// decoded block of item range [begin, end).
+//
+template <typename Func>
+void for_each_tensor_block(const Tensor &tensor, size_t begin, size_t end,
+                           Func func) {
+  float buf[kDecodeBlockSize];
+  for (size_t offset = begin; offset < end; offset += kDecodeBlockSize) {
+    const size_t count = std::min(kDecodeBlockSize, end - offset);
+    decode_tensor_values(tensor, offset, count, buf);
+    func(static_cast<const float *>(buf), offset, count);
+  }
+}
+
+}  // namespace nnview
+
+#endif  // NNVIEW_TENSOR_DECODE_HH_
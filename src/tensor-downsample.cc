@@ -0,0 +1,234 @@
+#include "tensor-downsample.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NNVIEW_DOWNSAMPLE_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NNVIEW_DOWNSAMPLE_NEON
+#endif
+
+namespace nnview {
+
+namespace {
+
+//
+// Reduction ops.
+// `pre` is applied to each input, `reduce` combines two values and `post`
+// is applied to the reduced value of 4 inputs.
+//
+// Min/max reductions return NaN if either input is NaN. std::min/max and
+// _mm_min/max_ps return one operand depending on the argument order, so
+// NaN is checked explicitly to get the same result in the SIMD loop and the
+// scalar tail.
+//
+
+inline float Min(float a, float b) {
+  return (a < b || std::isnan(a)) ? a : b;
+}
+
+inline float Max(float a, float b) {
+  return (a > b || std::isnan(a)) ? a : b;
+}
+
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+typedef __m128 VFloat;
+
+inline VFloat VAbs(VFloat x) {
+  return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+// Lanes of `mask` select `a`, others select `b`.
+inline VFloat VSelect(VFloat mask, VFloat a, VFloat b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// _mm_min/max_ps return `b` if either lane is NaN, so only a NaN in `a`
+// needs to be selected.
+inline VFloat VMin(VFloat a, VFloat b) {
+  return VSelect(_mm_cmpunord_ps(a, a), a, _mm_min_ps(a, b));
+}
+
+inline VFloat VMax(VFloat a, VFloat b) {
+  return VSelect(_mm_cmpunord_ps(a, a), a, _mm_max_ps(a, b));
+}
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+typedef float32x4_t VFloat;
+
+inline VFloat VAbs(VFloat x) { return vabsq_f32(x); }
+
+// FMIN/FMAX already return NaN if either lane is NaN.
+inline VFloat VMin(VFloat a, VFloat b) { return vminq_f32(a, b); }
+
+inline VFloat VMax(VFloat a, VFloat b) { return vmaxq_f32(a, b); }
+#endif
+
+struct MeanOp {
+  static float pre(float x) { return x; }
+  static float reduce(float a, float b) { return a + b; }
+  static float post(float x) { return x * 0.25f; }
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return _mm_add_ps(a, b); }
+  static VFloat post(VFloat x) { return _mm_mul_ps(x, _mm_set1_ps(0.25f)); }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return vaddq_f32(a, b); }
+  static VFloat post(VFloat x) { return vmulq_n_f32(x, 0.25f); }
+#endif
+};
+
+struct MinOp {
+  static float pre(float x) { return x; }
+  static float reduce(float a, float b) { return Min(a, b); }
+  static float post(float x) { return x; }
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return VMin(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return VMin(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#endif
+};
+
+struct MaxOp {
+  static float pre(float x) { return x; }
+  static float reduce(float a, float b) { return Max(a, b); }
+  static float post(float x) { return x; }
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return VMax(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) { return VMax(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#endif
+};
+
+struct AbsMaxOp {
+  static float pre(float x) { return std::fabs(x); }
+  static float reduce(float a, float b) { return Max(a, b); }
+  static float post(float x) { return x; }
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  static VFloat pre(VFloat x) { return VAbs(x); }
+  static VFloat reduce(VFloat a, VFloat b) { return VMax(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  static VFloat pre(VFloat x) { return VAbs(x); }
+  static VFloat reduce(VFloat a, VFloat b) { return VMax(a, b); }
+  static VFloat post(VFloat x) { return x; }
+#endif
+};
+
+struct MaxMagnitudeOp {
+  static float pre(float x) { return x; }
+  static float reduce(float a, float b) {
+    return (std::fabs(a) >= std::fabs(b) || std::isnan(a)) ? a : b;
+  }
+  static float post(float x) { return x; }
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) {
+    const VFloat mask =
+        _mm_or_ps(_mm_cmpge_ps(VAbs(a), VAbs(b)), _mm_cmpunord_ps(a, a));
+    return VSelect(mask, a, b);
+  }
+  static VFloat post(VFloat x) { return x; }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  static VFloat pre(VFloat x) { return x; }
+  static VFloat reduce(VFloat a, VFloat b) {
+    const uint32x4_t mask =
+        vorrq_u32(vcgeq_f32(VAbs(a), VAbs(b)), vmvnq_u32(vceqq_f32(a, a)));
+    return vbslq_f32(mask, a, b);
+  }
+  static VFloat post(VFloat x) { return x; }
+#endif
+};
+
+template <typename Op>
+void DownsampleRows(const float *row0, const float *row1, int src_width,
+                    float *dst) {
+  // Odd height: reduce the row with itself.
+  if (!row1) {
+    row1 = row0;
+  }
+
+  int i = 0;
+
+#if defined(NNVIEW_DOWNSAMPLE_SSE2)
+  // 8 inputs x 2 rows -> 4 outputs.
+  for (; (i + 8) <= src_width; i += 8) {
+    const VFloat v0 = Op::reduce(Op::pre(_mm_loadu_ps(row0 + i)),
+                                 Op::pre(_mm_loadu_ps(row1 + i)));
+    const VFloat v1 = Op::reduce(Op::pre(_mm_loadu_ps(row0 + i + 4)),
+                                 Op::pre(_mm_loadu_ps(row1 + i + 4)));
+    const VFloat even = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+    const VFloat odd = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(dst + i / 2, Op::post(Op::reduce(even, odd)));
+  }
+#elif defined(NNVIEW_DOWNSAMPLE_NEON)
+  // 8 inputs x 2 rows -> 4 outputs. vld2 deinterleaves even/odd columns.
+  for (; (i + 8) <= src_width; i += 8) {
+    const float32x4x2_t a = vld2q_f32(row0 + i);
+    const float32x4x2_t b = vld2q_f32(row1 + i);
+    const VFloat v0 = Op::reduce(Op::pre(a.val[0]), Op::pre(b.val[0]));
+    const VFloat v1 = Op::reduce(Op::pre(a.val[1]), Op::pre(b.val[1]));
+    vst1q_f32(dst + i / 2, Op::post(Op::reduce(v0, v1)));
+  }
+#endif
+
+  for (; i < src_width; i += 2) {
+    // Odd width: reduce the last column with itself.
+    const int i1 = std::min(i + 1, src_width - 1);
+    const float v0 = Op::reduce(Op::pre(row0[i]), Op::pre(row1[i]));
+    const float v1 = Op::reduce(Op::pre(row0[i1]), Op::pre(row1[i1]));
+    dst[i / 2] = Op::post(Op::reduce(v0, v1));
+  }
+}
+
+}  // namespace
+
+const char *get_downsample_mode_name(DownsampleMode mode) {
+  switch (mode) {
+    case DOWNSAMPLE_MEAN:
+      return "mean";
+    case DOWNSAMPLE_MIN:
+      return "min";
+    case DOWNSAMPLE_MAX:
+      return "max";
+    case DOWNSAMPLE_ABS_MAX:
+      return "abs max";
+    case DOWNSAMPLE_MAX_MAGNITUDE:
+      return "max magnitude";
+  }
+  return "unknown";
+}
+
+void downsample_rows(const float *row0, const float *row1, int src_width,
+                     DownsampleMode mode, float *dst) {
+  switch (mode) {
+    case DOWNSAMPLE_MEAN:
+      DownsampleRows<MeanOp>(row0, row1, src_width, dst);
+      return;
+    case DOWNSAMPLE_MIN:
+      DownsampleRows<MinOp>(row0, row1, src_width, dst);
+      return;
+    case DOWNSAMPLE_MAX:
+      DownsampleRows<MaxOp>(row0, row1, src_width, dst);
+      return;
+    case DOWNSAMPLE_ABS_MAX:
+      DownsampleRows<AbsMaxOp>(row0, row1, src_width, dst);
+      return;
+    case DOWNSAMPLE_MAX_MAGNITUDE:
+      DownsampleRows<MaxMagnitudeOp>(row0, row1, src_width, dst);
+      return;
+  }
+}
+
+}  // namespace nnview
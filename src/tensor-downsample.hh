@@ -0,0 +1,35 @@
+#ifndef NNVIEW_TENSOR_DOWNSAMPLE_HH_
+#define NNVIEW_TENSOR_DOWNSAMPLE_HH_
+
+//
+// 2x2 downsampling kernels for tensor pyramids.
+// Averaging hides outliers when a large matrix is displayed at small scale,
+// so extrema preserving reductions are also provided.
+//
+namespace nnview {
+
+enum DownsampleMode {
+  DOWNSAMPLE_MEAN = 0,
+  DOWNSAMPLE_MIN,
+  DOWNSAMPLE_MAX,
+  DOWNSAMPLE_ABS_MAX,        // max(|x|)
+  DOWNSAMPLE_MAX_MAGNITUDE,  // x with the largest |x|(sign is kept)
+};
+
+constexpr int kNumDownsampleModes = 5;
+
+const char *get_downsample_mode_name(DownsampleMode mode);
+
+//
+// Reduce 2x2 blocks of two rows of `src_width` values to
+// (src_width + 1) / 2 values in `dst`.
+// `row1` may be nullptr for the last row of odd height. The last column of
+// odd width is reduced with available values only.
+// NaN propagates: a 2x2 block containing NaN reduces to NaN in every mode.
+//
+void downsample_rows(const float *row0, const float *row1, int src_width,
+                     DownsampleMode mode, float *dst);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_TENSOR_DOWNSAMPLE_HH_
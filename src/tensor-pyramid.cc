@@ -0,0 +1,144 @@
+#include "tensor-pyramid.hh"
+#include "parallel.hh"
+#include "tensor-decode.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace nnview {
+
+namespace {
+
+//
+// 2x2 downsample. `read_row(y, buf)` returns a pointer to row `y` of the
+// source level; `buf`(src_width floats) may be used as storage.
+//
+template <typename RowFunc>
+void DownsampleLevel(int src_width, int src_height, RowFunc read_row,
+                     DownsampleMode mode, int dst_height, float *dst,
+                     int num_threads) {
+  const int dst_width = (src_width + 1) / 2;
+
+  const size_t num_workers = size_t(get_num_threads(num_threads));
+  std::vector<std::vector<float>> bufs(num_workers * 2);
+  for (auto &buf : bufs) {
+    buf.resize(size_t(src_width));
+  }
+
+  parallel_for(size_t(dst_height), num_threads, [&](size_t y, int thread_id) {
+    const int sy = int(y) * 2;
+    const float *row0 = read_row(sy, bufs[size_t(thread_id) * 2].data());
+    const float *row1 =
+        (sy + 1 < src_height)
+            ? read_row(sy + 1, bufs[size_t(thread_id) * 2 + 1].data())
+            : nullptr;
+
+    downsample_rows(row0, row1, src_width, mode,
+                    dst + y * size_t(dst_width));
+  });
+}
+
+}  // namespace
+
+bool get_tensor_image_size(const Tensor &tensor, int *width, int *height) {
+  if (tensor.shape.empty()) {
+    return false;
+  }
+
+  // 1D tensor is a single row.
+  const size_t rows =
+      (tensor.shape.size() > 1) ? size_t(std::max(0, tensor.shape[0])) : 1;
+  size_t cols = 1;
+  for (size_t i = (tensor.shape.size() > 1) ? 1 : 0; i < tensor.shape.size();
+       i++) {
+    cols *= size_t(std::max(0, tensor.shape[i]));
+    if (cols > size_t(std::numeric_limits<int>::max())) {
+      return false;
+    }
+  }
+
+  if ((rows == 0) || (cols == 0)) {
+    return false;
+  }
+
+  (*width) = int(cols);
+  (*height) = int(rows);
+  return true;
+}
+
+void TensorPyramid::clear() {
+  _mode = DOWNSAMPLE_MEAN;
+  _tensor = nullptr;
+  _levels.clear();
+}
+
+void TensorPyramid::build(const Tensor *tensor, DownsampleMode mode,
+                          int num_threads) {
+  clear();
+
+  Level level0;
+  if (!tensor || !tensor->is_loaded() ||
+      !get_tensor_image_size(*tensor, &level0.width, &level0.height)) {
+    return;
+  }
+
+  _tensor = tensor;
+  _mode = mode;
+
+  _levels.push_back(level0);
+
+  while (std::max(_levels.back().width, _levels.back().height) >
+         kTensorThumbnailSize) {
+    const int src_level = int(_levels.size()) - 1;
+
+    Level level;
+    level.width = (_levels.back().width + 1) / 2;
+    level.height = (_levels.back().height + 1) / 2;
+    level.values.resize(size_t(level.width) * size_t(level.height));
+
+    const int src_width = _levels.back().width;
+    const int src_height = _levels.back().height;
+
+    if (src_level == 0) {
+      // Decode rows of the tensor.
+      DownsampleLevel(
+          src_width, src_height,
+          [tensor, src_width](int y, float *buf) -> const float * {
+            decode_tensor_values(*tensor, size_t(y) * size_t(src_width),
+                                 size_t(src_width), buf);
+            return buf;
+          },
+          mode, level.height, level.values.data(), num_threads);
+    } else {
+      const float *src = _levels.back().values.data();
+      DownsampleLevel(
+          src_width, src_height,
+          [src, src_width](int y, float *buf) -> const float * {
+            (void)buf;
+            return src + size_t(y) * size_t(src_width);
+          },
+          mode, level.height, level.values.data(), num_threads);
+    }
+
+    _levels.push_back(std::move(level));
+  }
+}
+
+void TensorPyramid::read_region(int level, int x, int y, int w, int h,
+                                float *dst) const {
+  const Level &l = _levels[size_t(level)];
+
+  for (int j = 0; j < h; j++) {
+    const size_t src_offset = size_t(y + j) * size_t(l.width) + size_t(x);
+    float *row = dst + size_t(j) * size_t(w);
+    if (level == 0) {
+      decode_tensor_values(*_tensor, src_offset, size_t(w), row);
+    } else {
+      std::memcpy(row, l.values.data() + src_offset, sizeof(float) * size_t(w));
+    }
+  }
+}
+
+}  // namespace nnview
@@ -0,0 +1,69 @@
+#ifndef NNVIEW_TENSOR_PYRAMID_HH_
+#define NNVIEW_TENSOR_PYRAMID_HH_
+
+#include <vector>
+
+#include "datatypes.h"
+#include "tensor-downsample.hh"
+
+//
+// Mipmap-like pyramid of a Tensor for displaying arbitrarily large
+// matrices. A Tensor is displayed as a 2D matrix(see `get_tensor_image_size`).
+// Level 0 is the tensor itself(decoded on demand). Level N + 1 is a 2x2
+// downsample of level N(see `DownsampleMode`), and levels are built until a
+// level fits in a thumbnail.
+// Display code reads tiles of `kTensorTileSize` texels from the level that
+// matches the zoom factor, so GPU memory does not depend on the tensor size.
+// The last level is used as the thumbnail of the tensor.
+//
+namespace nnview {
+
+constexpr int kTensorTileSize = 512;
+constexpr int kTensorThumbnailSize = 64;
+
+//
+// Size of the 2D matrix a Tensor is displayed as. N-D tensor is displayed as
+// shape[0] rows x prod(shape[1:]) columns, and 1D tensor as a single row.
+// Returns false when the tensor has no items or a side does not fit in int.
+//
+bool get_tensor_image_size(const Tensor &tensor, int *width, int *height);
+
+class TensorPyramid {
+ public:
+  // Build downsampled levels of `tensor`(must be loaded) with `mode`
+  // reduction. `tensor` must be alive while the pyramid is used.
+  // The pyramid is left empty when `get_tensor_image_size` fails.
+  void build(const Tensor *tensor, DownsampleMode mode = DOWNSAMPLE_MEAN,
+             int num_threads = -1);
+
+  void clear();
+
+  bool empty() const { return _tensor == nullptr; }
+
+  const Tensor *tensor() const { return _tensor; }
+
+  DownsampleMode mode() const { return _mode; }
+
+  int num_levels() const { return int(_levels.size()); }
+  int width(int level) const { return _levels[size_t(level)].width; }
+  int height(int level) const { return _levels[size_t(level)].height; }
+
+  // Read texels [x, x + w) x [y, y + h) of `level` to `dst`(w * h floats,
+  // row major).
+  void read_region(int level, int x, int y, int w, int h, float *dst) const;
+
+ private:
+  struct Level {
+    int width = 0;
+    int height = 0;
+    std::vector<float> values;  // empty for level 0
+  };
+
+  const Tensor *_tensor = nullptr;
+  DownsampleMode _mode = DOWNSAMPLE_MEAN;
+  std::vector<Level> _levels;
+};
+
+}  // namespace nnview
+
+#endif  // NNVIEW_TENSOR_PYRAMID_HH_
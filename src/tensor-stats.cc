@@ -0,0 +1,334 @@
+#include "tensor-stats.hh"
+#include "parallel.hh"
+#include "tensor-decode.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nnview {
+
+namespace {
+
+// Partial result of the first pass over a block.
+struct BlockAccum {
+  float min_value = FLT_MAX;
+  float max_value = -FLT_MAX;
+  double sum = 0.0;
+  size_t count = 0;  // finite
+  size_t nan_count = 0;
+  size_t num_processed = 0;  // # of items processed by SIMD path
+};
+
+// min/max/sum/counts of v[0, n). SIMD path processes the largest multiple of
+// vector width and leaves the tail to the scalar path.
+void ReduceSIMD(const float *v, size_t n, BlockAccum *acc) {
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 pos_big = _mm256_set1_ps(FLT_MAX);
+  const __m256 neg_big = _mm256_set1_ps(-FLT_MAX);
+  __m256 vmin = pos_big;
+  __m256 vmax = neg_big;
+  __m256 vsum = zero;
+  __m256i vcount = _mm256_setzero_si256();
+  __m256i vnan = _mm256_setzero_si256();
+
+  for (; (i + 8) <= n; i += 8) {
+    const __m256 x = _mm256_loadu_ps(v + i);
+    // x - x is 0 for finite value, NaN for Inf/NaN.
+    const __m256 finite = _mm256_cmp_ps(_mm256_sub_ps(x, x), zero, _CMP_EQ_OQ);
+    const __m256 nan = _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+    vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(pos_big, x, finite));
+    vmax = _mm256_max_ps(vmax, _mm256_blendv_ps(neg_big, x, finite));
+    vsum = _mm256_add_ps(vsum, _mm256_and_ps(x, finite));
+    // mask is -1 for true lanes.
+    vcount = _mm256_sub_epi32(vcount, _mm256_castps_si256(finite));
+    vnan = _mm256_sub_epi32(vnan, _mm256_castps_si256(nan));
+  }
+
+  alignas(32) float fmin[8], fmax[8], fsum[8];
+  alignas(32) int32_t icount[8], inan[8];
+  _mm256_store_ps(fmin, vmin);
+  _mm256_store_ps(fmax, vmax);
+  _mm256_store_ps(fsum, vsum);
+  std::memcpy(icount, &vcount, sizeof(vcount));
+  std::memcpy(inan, &vnan, sizeof(vnan));
+  for (int k = 0; k < 8; k++) {
+    acc->min_value = std::min(acc->min_value, fmin[k]);
+    acc->max_value = std::max(acc->max_value, fmax[k]);
+    acc->sum += double(fsum[k]);
+    acc->count += size_t(icount[k]);
+    acc->nan_count += size_t(inan[k]);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 pos_big = _mm_set1_ps(FLT_MAX);
+  const __m128 neg_big = _mm_set1_ps(-FLT_MAX);
+  __m128 vmin = pos_big;
+  __m128 vmax = neg_big;
+  __m128 vsum = zero;
+  __m128i vcount = _mm_setzero_si128();
+  __m128i vnan = _mm_setzero_si128();
+
+  for (; (i + 4) <= n; i += 4) {
+    const __m128 x = _mm_loadu_ps(v + i);
+    // x - x is 0 for finite value, NaN for Inf/NaN.
+    const __m128 finite = _mm_cmpeq_ps(_mm_sub_ps(x, x), zero);
+    const __m128 nan = _mm_cmpunord_ps(x, x);
+    vmin = _mm_min_ps(vmin, _mm_or_ps(_mm_and_ps(finite, x),
+                                      _mm_andnot_ps(finite, pos_big)));
+    vmax = _mm_max_ps(vmax, _mm_or_ps(_mm_and_ps(finite, x),
+                                      _mm_andnot_ps(finite, neg_big)));
+    vsum = _mm_add_ps(vsum, _mm_and_ps(x, finite));
+    // mask is -1 for true lanes.
+    vcount = _mm_sub_epi32(vcount, _mm_castps_si128(finite));
+    vnan = _mm_sub_epi32(vnan, _mm_castps_si128(nan));
+  }
+
+  alignas(16) float fmin[4], fmax[4], fsum[4];
+  alignas(16) int32_t icount[4], inan[4];
+  _mm_store_ps(fmin, vmin);
+  _mm_store_ps(fmax, vmax);
+  _mm_store_ps(fsum, vsum);
+  std::memcpy(icount, &vcount, sizeof(vcount));
+  std::memcpy(inan, &vnan, sizeof(vnan));
+  for (int k = 0; k < 4; k++) {
+    acc->min_value = std::min(acc->min_value, fmin[k]);
+    acc->max_value = std::max(acc->max_value, fmax[k]);
+    acc->sum += double(fsum[k]);
+    acc->count += size_t(icount[k]);
+    acc->nan_count += size_t(inan[k]);
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t pos_big = vdupq_n_f32(FLT_MAX);
+  const float32x4_t neg_big = vdupq_n_f32(-FLT_MAX);
+  float32x4_t vmin = pos_big;
+  float32x4_t vmax = neg_big;
+  float32x4_t vsum = zero;
+  uint32x4_t vcount = vdupq_n_u32(0);
+  uint32x4_t vnan = vdupq_n_u32(0);
+
+  for (; (i + 4) <= n; i += 4) {
+    const float32x4_t x = vld1q_f32(v + i);
+    // x - x is 0 for finite value, NaN for Inf/NaN.
+    const uint32x4_t finite = vceqq_f32(vsubq_f32(x, x), zero);
+    const uint32x4_t nan = vmvnq_u32(vceqq_f32(x, x));
+    vmin = vminq_f32(vmin, vbslq_f32(finite, x, pos_big));
+    vmax = vmaxq_f32(vmax, vbslq_f32(finite, x, neg_big));
+    vsum = vaddq_f32(vsum, vreinterpretq_f32_u32(vandq_u32(
+                               vreinterpretq_u32_f32(x), finite)));
+    // mask is 0xffffffff(-1) for true lanes.
+    vcount = vsubq_u32(vcount, finite);
+    vnan = vsubq_u32(vnan, nan);
+  }
+
+  acc->min_value = std::min(acc->min_value, vminvq_f32(vmin));
+  acc->max_value = std::max(acc->max_value, vmaxvq_f32(vmax));
+  acc->sum += double(vaddvq_f32(vsum));
+  acc->count += size_t(vaddvq_u32(vcount));
+  acc->nan_count += size_t(vaddvq_u32(vnan));
+#else
+  (void)v;
+  (void)n;
+  (void)acc;
+#endif
+
+  acc->num_processed = i;
+}
+
+// Sum of squared deviation from `mean` over finite values of v[0, n).
+double SumSquaredDeviation(const float *v, size_t n, float mean) {
+  size_t i = 0;
+  double ssd = 0.0;
+
+#if defined(__AVX2__)
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 vmean = _mm256_set1_ps(mean);
+  __m256 vssd = zero;
+  for (; (i + 8) <= n; i += 8) {
+    const __m256 x = _mm256_loadu_ps(v + i);
+    const __m256 finite = _mm256_cmp_ps(_mm256_sub_ps(x, x), zero, _CMP_EQ_OQ);
+    const __m256 d = _mm256_and_ps(_mm256_sub_ps(x, vmean), finite);
+    vssd = _mm256_add_ps(vssd, _mm256_mul_ps(d, d));
+  }
+  alignas(32) float f[8];
+  _mm256_store_ps(f, vssd);
+  for (int k = 0; k < 8; k++) {
+    ssd += double(f[k]);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 vmean = _mm_set1_ps(mean);
+  __m128 vssd = zero;
+  for (; (i + 4) <= n; i += 4) {
+    const __m128 x = _mm_loadu_ps(v + i);
+    const __m128 finite = _mm_cmpeq_ps(_mm_sub_ps(x, x), zero);
+    const __m128 d = _mm_and_ps(_mm_sub_ps(x, vmean), finite);
+    vssd = _mm_add_ps(vssd, _mm_mul_ps(d, d));
+  }
+  alignas(16) float f[4];
+  _mm_store_ps(f, vssd);
+  for (int k = 0; k < 4; k++) {
+    ssd += double(f[k]);
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t vmean = vdupq_n_f32(mean);
+  float32x4_t vssd = zero;
+  for (; (i + 4) <= n; i += 4) {
+    const float32x4_t x = vld1q_f32(v + i);
+    const uint32x4_t finite = vceqq_f32(vsubq_f32(x, x), zero);
+    const float32x4_t d = vreinterpretq_f32_u32(
+        vandq_u32(vreinterpretq_u32_f32(vsubq_f32(x, vmean)), finite));
+    vssd = vmlaq_f32(vssd, d, d);
+  }
+  ssd += double(vaddvq_f32(vssd));
+#endif
+
+  for (; i < n; i++) {
+    if (std::isfinite(v[i])) {
+      const double d = double(v[i]) - double(mean);
+      ssd += d * d;
+    }
+  }
+
+  return ssd;
+}
+
+// Statistics of a block. Float SIMD lanes accumulate at most `n` values, so
+// `n` must be small(e.g. kDecodeBlockSize) to bound the rounding error.
+TensorStats ComputeBlockStats(const float *values, size_t n) {
+  BlockAccum acc;
+  ReduceSIMD(values, n, &acc);
+
+  for (size_t i = acc.num_processed; i < n; i++) {
+    const float x = values[i];
+    if (std::isfinite(x)) {
+      acc.min_value = std::min(acc.min_value, x);
+      acc.max_value = std::max(acc.max_value, x);
+      acc.sum += double(x);
+      acc.count++;
+    } else if (std::isnan(x)) {
+      acc.nan_count++;
+    }
+  }
+
+  TensorStats stats;
+  stats.count = acc.count;
+  stats.nan_count = acc.nan_count;
+  stats.inf_count = n - acc.count - acc.nan_count;
+
+  if (acc.count > 0) {
+    stats.min_value = acc.min_value;
+    stats.max_value = acc.max_value;
+    stats.mean = acc.sum / double(acc.count);
+    // 2nd pass runs over the block which is still in cache.
+    stats.variance = SumSquaredDeviation(values, n, float(stats.mean)) /
+                     double(acc.count);
+  }
+
+  return stats;
+}
+
+}  // namespace
+
+TensorStats compute_stats(const float *values, size_t n) {
+  // Blocks are combined in double, so the error does not grow with `n`.
+  TensorStats stats;
+  for (size_t offset = 0; offset < n; offset += kDecodeBlockSize) {
+    const size_t count = std::min(kDecodeBlockSize, n - offset);
+    stats = merge_stats(stats, ComputeBlockStats(values + offset, count));
+  }
+  return stats;
+}
+
+TensorStats merge_stats(const TensorStats &a, const TensorStats &b) {
+  if (a.count == 0) {
+    TensorStats r = b;
+    r.nan_count += a.nan_count;
+    r.inf_count += a.inf_count;
+    return r;
+  }
+
+  if (b.count == 0) {
+    TensorStats r = a;
+    r.nan_count += b.nan_count;
+    r.inf_count += b.inf_count;
+    return r;
+  }
+
+  // Chan et al. parallel variance.
+  TensorStats r;
+  r.count = a.count + b.count;
+  r.nan_count = a.nan_count + b.nan_count;
+  r.inf_count = a.inf_count + b.inf_count;
+  r.min_value = std::min(a.min_value, b.min_value);
+  r.max_value = std::max(a.max_value, b.max_value);
+
+  const double na = double(a.count);
+  const double nb = double(b.count);
+  const double n = double(r.count);
+  const double delta = b.mean - a.mean;
+  r.mean = a.mean + delta * (nb / n);
+  const double m2 =
+      a.variance * na + b.variance * nb + delta * delta * (na * nb / n);
+  r.variance = m2 / n;
+
+  return r;
+}
+
+TensorStats compute_tensor_stats(const Tensor &tensor, int num_threads) {
+  const size_t n = tensor.num_items();
+  if ((n == 0) || !tensor.is_loaded()) {
+    return TensorStats();
+  }
+
+  // At least 64 blocks per task to amortize threading cost.
+  const size_t num_workers = size_t(get_num_threads(num_threads));
+  const size_t min_chunk = kDecodeBlockSize * 64;
+  size_t chunk = std::max(min_chunk, (n + num_workers * 4 - 1) /
+                                         (num_workers * 4));
+  chunk = ((chunk + kDecodeBlockSize - 1) / kDecodeBlockSize) *
+          kDecodeBlockSize;
+
+  const size_t num_chunks = (n + chunk - 1) / chunk;
+  std::vector<TensorStats> partials(num_chunks);
+
+  parallel_for(num_chunks, num_threads, [&](size_t c, int thread_id) {
+    (void)thread_id;
+    const size_t begin = c * chunk;
+    const size_t end = std::min(n, begin + chunk);
+
+    TensorStats stats;
+    for_each_tensor_block(
+        tensor, begin, end,
+        [&stats](const float *values, size_t offset, size_t count) {
+          (void)offset;
+          stats = merge_stats(stats, compute_stats(values, count));
+        });
+    partials[c] = stats;
+  });
+
+  // Merge in order for deterministic result.
+  TensorStats stats;
+  for (const auto &partial : partials) {
+    stats = merge_stats(stats, partial);
+  }
+
+  return stats;
+}
+
+}  // namespace nnview
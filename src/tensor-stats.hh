@@ -0,0 +1,45 @@
+#ifndef NNVIEW_TENSOR_STATS_HH_
+#define NNVIEW_TENSOR_STATS_HH_
+
+#include <cstddef>
+
+#include "datatypes.h"
+
+//
+// Statistics of Tensor values.
+// min/max/mean/variance are computed over finite values only. NaN and Inf
+// are counted separately.
+//
+namespace nnview {
+
+struct TensorStats {
+  float min_value = 0.0f;
+  float max_value = 0.0f;
+  double mean = 0.0;
+  double variance = 0.0;  // population variance
+
+  size_t count = 0;  // # of finite values
+  size_t nan_count = 0;
+  size_t inf_count = 0;
+};
+
+//
+// Compute statistics of `n` float values(SIMD). Values are processed in
+// blocks of `kDecodeBlockSize`, whose 2nd pass(variance) reads the block
+// while it is still in cache. Blocks are merged with `merge_stats`.
+//
+TensorStats compute_stats(const float *values, size_t n);
+
+// Merge statistics of two disjoint sets of values.
+TensorStats merge_stats(const TensorStats &a, const TensorStats &b);
+
+//
+// Compute statistics of all items of `tensor` using `num_threads` workers
+// (<= 0 : all hardware threads). Data is decoded block by block, so any
+// `DataType` is supported without float32 copy of the whole tensor.
+//
+TensorStats compute_tensor_stats(const Tensor &tensor, int num_threads = -1);
+
+}  // namespace nnview
+
+#endif  // NNVIEW_TENSOR_STATS_HH_
@@ -0,0 +1,202 @@
+#include "trace.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace nnview {
+
+std::atomic<bool> g_trace_enabled(false);
+
+namespace {
+
+// Zones kept per thread. Further zones are counted as dropped.
+constexpr size_t kMaxEventsPerThread = size_t(1) << 20;
+
+struct TraceEvent {
+  const char *name;
+  std::string detail;
+  uint64_t begin_ns;
+  uint64_t end_ns;
+};
+
+// Events of a thread. Appended only by the owner thread. `mutex` is taken
+// against export, so it is not contended while recording.
+struct ThreadBuffer {
+  std::string name;
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+  size_t num_dropped = 0;
+};
+
+// Buffers of all threads which have recorded zones, in creation order.
+// Buffers are never freed since threads may exit before the trace is
+// exported.
+struct TraceRegistry {
+  std::mutex mutex;
+  std::vector<ThreadBuffer *> buffers;
+};
+
+// Allocated once and intentionally leaked, so that threads still recording
+// at exit never see a destroyed registry.
+TraceRegistry *GetRegistry() {
+  static TraceRegistry *registry = new TraceRegistry();
+  return registry;
+}
+
+thread_local ThreadBuffer *t_buffer = nullptr;
+
+ThreadBuffer *GetThreadBuffer() {
+  if (!t_buffer) {
+    TraceRegistry *registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    t_buffer = new ThreadBuffer();
+    registry->buffers.push_back(t_buffer);
+  }
+  return t_buffer;
+}
+
+void WriteEscaped(FILE *fp, const std::string &s) {
+  for (char c : s) {
+    if ((c == '"') || (c == '\\')) {
+      fputc('\\', fp);
+      fputc(c, fp);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      fprintf(fp, "\\u%04x", unsigned(static_cast<unsigned char>(c)));
+    } else {
+      fputc(c, fp);
+    }
+  }
+}
+
+}  // namespace
+
+void trace_enable(bool enable) {
+  trace_now_ns();  // Start the clock
+  g_trace_enabled.store(enable, std::memory_order_relaxed);
+}
+
+void trace_clear() {
+  TraceRegistry *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (ThreadBuffer *buffer : registry->buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->events.clear();
+    buffer->num_dropped = 0;
+  }
+}
+
+void trace_set_thread_name(const char *name) {
+  ThreadBuffer *buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  buffer->name = name;
+}
+
+uint64_t trace_now_ns() {
+  using Clock = std::chrono::steady_clock;
+  static const Clock::time_point base = Clock::now();
+  return uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - base)
+          .count());
+}
+
+void trace_record(const char *name, const std::string &detail,
+                  uint64_t begin_ns, uint64_t end_ns) {
+  ThreadBuffer *buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  if (buffer->events.size() >= kMaxEventsPerThread) {
+    buffer->num_dropped++;
+    return;
+  }
+  buffer->events.push_back({name, detail, begin_ns, end_ns});
+}
+
+bool trace_write_json(const std::string &filename) {
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (!fp) {
+    return false;
+  }
+
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+  bool first = true;
+  size_t num_dropped = 0;
+
+  // `parallel_for` spawns threads per call, so unnamed threads are packed
+  // into rows(tid) whose previous thread has finished. Named threads get
+  // their own row.
+  std::vector<uint64_t> row_end_ns;
+
+  TraceRegistry *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (ThreadBuffer *buffer : registry->buffers) {
+    std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+
+    num_dropped += buffer->num_dropped;
+
+    if (buffer->events.empty() && buffer->name.empty()) {
+      continue;
+    }
+
+    uint64_t begin_ns = UINT64_MAX;
+    uint64_t end_ns = 0;
+    for (const TraceEvent &event : buffer->events) {
+      begin_ns = std::min(begin_ns, event.begin_ns);
+      end_ns = std::max(end_ns, event.end_ns);
+    }
+
+    size_t row = row_end_ns.size();
+    if (buffer->name.empty()) {
+      for (size_t r = 0; r < row_end_ns.size(); r++) {
+        if (row_end_ns[r] <= begin_ns) {
+          row = r;
+          break;
+        }
+      }
+    }
+    if (row == row_end_ns.size()) {
+      row_end_ns.push_back(0);
+    }
+    // Named rows are never shared.
+    row_end_ns[row] = buffer->name.empty() ? end_ns : UINT64_MAX;
+
+    const int tid = int(row) + 1;
+
+    if (!buffer->name.empty()) {
+      fprintf(fp,
+              "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+              "\"tid\": %d, \"args\": {\"name\": \"",
+              first ? "" : ",\n", tid);
+      WriteEscaped(fp, buffer->name);
+      fprintf(fp, "\"}}");
+      first = false;
+    }
+
+    // Complete events. Timestamps are in microseconds.
+    for (const TraceEvent &event : buffer->events) {
+      fprintf(fp,
+              "%s{\"name\": \"%s\", \"cat\": \"nnview\", \"ph\": \"X\", "
+              "\"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+              first ? "" : ",\n", event.name, tid,
+              double(event.begin_ns) * 1.0e-3,
+              double(event.end_ns - event.begin_ns) * 1.0e-3);
+      if (!event.detail.empty()) {
+        fprintf(fp, ", \"args\": {\"detail\": \"");
+        WriteEscaped(fp, event.detail);
+        fprintf(fp, "\"}");
+      }
+      fprintf(fp, "}");
+      first = false;
+    }
+  }
+
+  fprintf(fp, "\n], \"otherData\": {\"dropped_events\": %zu}}\n",
+          num_dropped);
+
+  const bool ok = !ferror(fp);
+  return (fclose(fp) == 0) && ok;
+}
+
+}  // namespace nnview
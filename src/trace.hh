@@ -0,0 +1,93 @@
+#ifndef NNVIEW_TRACE_HH_
+#define NNVIEW_TRACE_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//
+// Scoped-zone tracer. Zones are recorded to a buffer of each thread and
+// exported as Chrome trace event JSON, which can be opened with
+// chrome://tracing or https://ui.perfetto.dev.
+//
+// Recording is disabled by default. A disabled zone costs a relaxed atomic
+// load, so zones can be left in release builds.
+//
+//   void load() {
+//     NNVIEW_TRACE_SCOPE("load");
+//     ...
+//   }
+//
+namespace nnview {
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled() {
+  return g_trace_enabled.load(std::memory_order_relaxed);
+}
+
+// Start/stop recording. Recorded zones are kept until `trace_clear`.
+void trace_enable(bool enable);
+
+void trace_clear();
+
+// Name of the calling thread shown in the trace viewer.
+void trace_set_thread_name(const char *name);
+
+// Nanoseconds since the first call.
+uint64_t trace_now_ns();
+
+// `name` must be a string literal(or have a static lifetime).
+void trace_record(const char *name, const std::string &detail,
+                  uint64_t begin_ns, uint64_t end_ns);
+
+//
+// Write zones recorded so far as Chrome trace JSON. Zones can be recorded
+// while writing. Returns false when the file cannot be written.
+//
+bool trace_write_json(const std::string &filename);
+
+class TraceScope {
+ public:
+  explicit TraceScope(const char *name) : TraceScope(name, nullptr) {}
+
+  // `detail`(e.g. filename) is shown as the argument of the zone. It is only
+  // copied when recording.
+  TraceScope(const char *name, const std::string *detail)
+      : _name(trace_enabled() ? name : nullptr), _detail(detail) {
+    if (_name) {
+      _begin_ns = trace_now_ns();
+    }
+  }
+
+  ~TraceScope() {
+    if (_name) {
+      trace_record(_name, _detail ? (*_detail) : std::string(), _begin_ns,
+                   trace_now_ns());
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  const char *_name;  // nullptr = not recording
+  const std::string *_detail;
+  uint64_t _begin_ns = 0;
+};
+
+}  // namespace nnview
+
+#define NNVIEW_TRACE_CONCAT_(a, b) a##b
+#define NNVIEW_TRACE_CONCAT(a, b) NNVIEW_TRACE_CONCAT_(a, b)
+
+// Record the enclosing scope as a zone.
+#define NNVIEW_TRACE_SCOPE(name) \
+  ::nnview::TraceScope NNVIEW_TRACE_CONCAT(nnview_trace_scope_, __LINE__)(name)
+
+// Same as NNVIEW_TRACE_SCOPE with a detail string(std::string).
+#define NNVIEW_TRACE_SCOPE_DETAIL(name, detail)                            \
+  ::nnview::TraceScope NNVIEW_TRACE_CONCAT(nnview_trace_scope_, __LINE__)( \
+      name, &(detail))
+
+#endif  // NNVIEW_TRACE_HH_